@@ -0,0 +1,246 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "burst.h"
+#include "ffsb_tg.h"
+#include "util.h"
+
+struct burst *burst_alloc(uint64_t on_nsec, uint64_t off_nsec, int random,
+			  int independent)
+{
+	struct burst *b = ffsb_malloc(sizeof(*b));
+
+	memset(b, 0, sizeof(*b));
+	b->on_nsec = on_nsec;
+	b->off_nsec = off_nsec;
+	b->random = random;
+	b->independent = independent;
+	b->results = ffsb_malloc(sizeof(*b->results));
+	init_ffsb_op_results(b->results);
+	return b;
+}
+
+void burst_free(struct burst *b)
+{
+	free(b->results);
+	free(b);
+}
+
+void burst_print_config(struct burst *b)
+{
+	printf("\t bursts           = %.3lf msec on, %.3lf msec off "
+	       "(%.1lf%% duty)%s%s\n", b->on_nsec / 1000000.0,
+	       b->off_nsec / 1000000.0,
+	       100.0 * b->on_nsec / (b->on_nsec + b->off_nsec),
+	       b->random ? ", random" : "",
+	       b->independent ? ", independent" : "");
+}
+
+uint64_t burst_length(struct burst *b, randdata_t *rd, int on)
+{
+	uint64_t mean = on ? b->on_nsec : b->off_nsec;
+	struct oplog *saved = rd->log;
+	uint64_t ret;
+
+	if (!b->random)
+		return mean;
+
+	/* not part of the op stream, keep it out of the oplog */
+	rd->log = NULL;
+	ret = -log(1.0 - getdrandom(rd)) * mean;
+	rd->log = saved;
+	return ret;
+}
+
+/* Dirty and under writeback memory in KB, -1 if it can't be read */
+static int64_t dirty_kb(void)
+{
+	FILE *fp = fopen("/proc/meminfo", "r");
+	char line[256];
+	long long kb;
+	int64_t ret = 0, found = 0;
+
+	if (!fp)
+		return -1;
+	while (fgets(line, sizeof(line), fp)) {
+		if (sscanf(line, "Dirty: %lld", &kb) == 1 ||
+		    sscanf(line, "Writeback: %lld", &kb) == 1) {
+			ret += kb;
+			found++;
+		}
+	}
+	fclose(fp);
+	return found ? ret : -1;
+}
+
+static uint64_t results_ops(ffsb_op_results_t *r)
+{
+	uint64_t ops = 0;
+	int i;
+
+	for (i = 0; i < FFSB_NUMOPS; i++)
+		ops += r->op_weight[i];
+	return ops;
+}
+
+/* Counters go back to zero when the warmup ends */
+static uint64_t since(uint64_t cur, uint64_t last)
+{
+	return (cur >= last) ? cur - last : cur;
+}
+
+static void burst_report(struct burst *b, unsigned num, double at,
+			 int measured, uint64_t len, uint64_t drain,
+			 int64_t recover, int64_t rise,
+			 ffsb_op_results_t *first, ffsb_op_results_t *last)
+{
+	ffsb_op_results_t *r = b->results;
+	ffsb_hist_t *lat = ffsb_malloc(sizeof(*lat));
+	uint64_t ops = since(results_ops(last), results_ops(first));
+	uint64_t rbytes = since(last->read_bytes, first->read_bytes);
+	uint64_t wbytes = since(last->write_bytes, first->write_bytes);
+	double secs = len / 1000000000.0;
+	char buf[256], buf2[256];
+
+	ffsb_hist_diff(lat, &last->burst_lat, &first->burst_lat);
+
+	/* still printed, but only counted if it began in the
+	 * measurement window
+	 */
+	if (measured) {
+		r->bursts++;
+		r->burst_usec += len / 1000;
+		r->burst_ops += ops;
+		r->burst_bytes += rbytes + wbytes;
+		ffsb_hist_add(&r->burst_drain, drain / 1000);
+		if (recover >= 0)
+			ffsb_hist_add(&r->burst_recover, recover / 1000);
+		else if (recover == -1 && rise >= 0)
+			r->burst_unrecovered++;
+	}
+
+	printf("tg %u burst %u at %.1lf sec: %.3lf sec, %.1lf ops/sec, "
+	       "read %s/sec, write %s/sec, latency avg %.3lf p99 %.3lf "
+	       "msec, drain %.3lf msec", tg_get_tgnum(b->tg), num, at, secs,
+	       ops / secs, ffsb_printsize(buf, rbytes / secs, 256),
+	       ffsb_printsize(buf2, wbytes / secs, 256),
+	       ffsb_hist_mean(lat) / 1000.0,
+	       ffsb_hist_percentile(lat, 99.0) / 1000.0, drain / 1000000.0);
+	if (rise >= 0)
+		printf(", dirty +%s", ffsb_printsize(buf, rise * 1024.0,
+						     256));
+	if (recover >= 0)
+		printf(", recovered in %.3lf sec", recover / 1000000000.0);
+	else if (recover == -1 && rise >= 0)
+		printf(", not recovered");
+	printf("\n");
+	fflush(stdout);
+	free(lat);
+}
+
+static void *burst_run(void *data)
+{
+	struct burst *b = data;
+	ffsb_op_results_t *first, *last;
+	uint64_t start = ffsb_clock_nsec();
+	uint64_t on, end, drain;
+	int64_t dirty, base, peak, recover;
+	unsigned num = 0;
+	int measured;
+
+	first = ffsb_malloc(sizeof(*first));
+	last = ffsb_malloc(sizeof(*last));
+
+	b->next_on = start;
+	while (tg_wait_until(b->tg, b->next_on)) {
+		init_ffsb_op_results(first);
+		tg_collect_results(b->tg, first);
+		base = peak = dirty_kb();
+
+		on = ffsb_clock_nsec();
+		end = on + burst_length(b, &b->rd, 1);
+		measured = (tg_get_window(b->tg) == FFSB_WINDOW_MEASURE);
+		__sync_synchronize();
+		b->on = 1;
+		if (!tg_wait_until(b->tg, end))
+			break;
+
+		/* the next start goes out before the threads stop, so
+		 * they know how long to sleep
+		 */
+		b->next_on = end + burst_length(b, &b->rd, 0);
+		__sync_synchronize();
+		b->on = 0;
+		__sync_synchronize();
+		while (b->inflight &&
+		       tg_get_flagval(b->tg) != tg_get_stopval(b->tg))
+			ffsb_sleep_until(ffsb_clock_nsec() + BURST_TICK_NSEC);
+		drain = ffsb_clock_nsec() - end;
+
+		init_ffsb_op_results(last);
+		tg_collect_results(b->tg, last);
+
+		/* dirty data left by the burst keeps writeback busy
+		 * after it, until the next burst at the latest
+		 */
+		recover = -1;
+		while (base >= 0 && ffsb_clock_nsec() < b->next_on &&
+		       tg_get_flagval(b->tg) != tg_get_stopval(b->tg)) {
+			dirty = dirty_kb();
+			peak = max(peak, dirty);
+			if (dirty <= base + BURST_DIRTY_SLACK_KB) {
+				recover = ffsb_clock_nsec() - end;
+				break;
+			}
+			ffsb_sleep_until(min(b->next_on, ffsb_clock_nsec() +
+					     BURST_DIRTY_NSEC));
+		}
+		/* cut short by the end of the run, not the next burst */
+		if (recover < 0 && ffsb_clock_nsec() < b->next_on)
+			recover = -2;
+
+		burst_report(b, ++num, (on - start) / 1000000000.0,
+			     measured, end - on, drain, recover,
+			     base >= 0 ? peak - base : -1, first, last);
+	}
+
+	free(first);
+	free(last);
+	return NULL;
+}
+
+void burst_start(struct burst *b, struct ffsb_tg *tg)
+{
+	b->tg = tg;
+	if (b->independent)
+		return;
+	init_random(&b->rd, 0);
+	pthread_create(&b->thread, NULL, burst_run, b);
+}
+
+void burst_stop(struct burst *b)
+{
+	if (b->independent)
+		return;
+	pthread_join(b->thread, NULL);
+	destroy_random(&b->rd);
+}
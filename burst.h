@@ -0,0 +1,96 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef _BURST_H_
+#define _BURST_H_
+
+#include <pthread.h>
+#include <inttypes.h>
+
+#include "rand.h"
+#include "ffsb_op.h"
+
+struct ffsb_tg;
+
+/* On/off traffic.  A threadgroup with bursts runs flat out for
+ * on_nsec, then sits idle for off_nsec, over and over.  With random
+ * set each length is drawn from an exponential distribution with
+ * that mean instead.
+ *
+ * Normally the tg's threads burst together: a controller thread
+ * turns them on and off, and at the end of every burst waits for the
+ * ops still in flight (the drain) and for dirty memory to fall back
+ * to where it was when the burst began (the recovery), then prints
+ * that burst's results.  With independent set each thread keeps its
+ * own phase, starting at a random point in the cycle, and only the
+ * totals are reported.
+ */
+#define BURST_TICK_NSEC		100000ULL	/* polling while draining */
+#define BURST_DIRTY_NSEC	10000000ULL	/* polling while recovering */
+#define BURST_DIRTY_SLACK_KB	1024
+
+struct burst {
+	uint64_t on_nsec;
+	uint64_t off_nsec;
+	int random;
+	int independent;
+
+	/* Together: whether the threads may issue ops, when the next
+	 * burst starts, and how many ops are in flight
+	 */
+	volatile int on;
+	volatile uint64_t next_on;
+	int inflight;
+
+	/* The controller's per-burst totals, added to the tg's */
+	ffsb_op_results_t *results;
+
+	struct ffsb_tg *tg;
+	randdata_t rd;
+	pthread_t thread;
+};
+
+/* A thread's own phase when the bursts are independent, in nsecs.
+ * ops and bytes are its totals when the burst began.  A burst that
+ * began in the warmup lost those totals when the warmup ended, so it
+ * is left out.
+ */
+struct burst_phase {
+	uint64_t on;
+	uint64_t off;
+	uint64_t ops;
+	uint64_t bytes;
+	uint64_t last_end;
+	int warmup;
+};
+
+struct burst *burst_alloc(uint64_t on_nsec, uint64_t off_nsec, int random,
+			  int independent);
+void burst_free(struct burst *);
+void burst_print_config(struct burst *);
+
+/* The length of the next burst (on) or idle period, in nsecs */
+uint64_t burst_length(struct burst *, randdata_t *rd, int on);
+
+/* Called by tg_run() once its threads are going, and after they've
+ * been told to stop.  Only start a controller when the threads burst
+ * together.
+ */
+void burst_start(struct burst *, struct ffsb_tg *);
+void burst_stop(struct burst *);
+
+#endif /* _BURST_H_ */
@@ -29,6 +29,7 @@
 #include "ffsb_op.h"
 #include "ffsb_tg.h"
 #include "ffsb_fs.h"
+#include "steady.h"
 
 /*
  * The main thread wakes up once in so many seconds to check elapsed
@@ -37,6 +38,27 @@
 
 #define FFSB_TG_WAIT_TIME (1)
 
+/* A run can also stop once a given amount of work is done: total ops,
+ * total bytes read and written, or ops of one kind, whichever comes
+ * first.  0 is no limit.
+ */
+typedef struct ffsb_stop {
+	int set;
+	uint64_t ops;
+	uint64_t bytes;
+	uint64_t op[FFSB_NUMOPS];
+} ffsb_stop_t;
+
+/* sweep=<option>:<value>,<value>,...  The profile is run once for
+ * every combination of the values of all the sweeps, on the same
+ * fileset, the first sweep given varying slowest.
+ */
+typedef struct ffsb_sweep {
+	char *option;
+	char **values;
+	unsigned num_values;
+} ffsb_sweep_t;
+
 #define MARK printf("MARK FUNC: %s() @ %s:%d\n", __FUNCTION__, __FILE__, __LINE__);
 
 struct results {
@@ -56,10 +78,32 @@ typedef struct profile_config {
 	struct config_options *global;
 	struct container *fs_container;
 	struct container *tg_container;
+	struct container *phase_container;
 } profile_config_t;
 
+/* A run is one or more phases, each with its own threadgroups, run
+ * one after the other on the same filesystems.  A profile without
+ * [phase] sections is a single phase with the top level threadgroups.
+ */
+typedef struct ffsb_phase {
+	char *name;			/* NULL if it wasn't given one */
+	unsigned time;
+	unsigned warmup;		/* secs before and after time */
+	unsigned cooldown;		/* that aren't measured */
+	ffsb_stop_t stop;
+	ffsb_steady_t steady;
+
+	unsigned num_threadgroups;
+	int num_totalthreads;
+	struct ffsb_tg *groups;
+} ffsb_phase_t;
+
 typedef struct ffsb_config {
 	unsigned time;
+	unsigned warmup;
+	unsigned cooldown;
+	ffsb_stop_t stop;
+	ffsb_steady_t steady;
 
 	unsigned num_filesys;
 	unsigned num_threadgroups;
@@ -69,6 +113,22 @@ typedef struct ffsb_config {
 	struct ffsb_tg *groups;
 	struct ffsb_fs *filesystems;
 
+	/* time, the threadgroups and the thread count above are the
+	 * current phase's, see fc_set_phase()
+	 */
+	unsigned num_phases;
+	struct ffsb_phase *phases;
+
+	/* Runs of the whole profile, more than one when sweeping, and
+	 * whether to drop the caches before each and re-age the
+	 * filesystems in between
+	 */
+	unsigned num_runs;
+	unsigned num_sweeps;
+	ffsb_sweep_t *sweeps;
+	int sweep_drop_caches;
+	int sweep_reage;
+
 	struct profile_config *profile_conf;
 	char *callout;			/* we will try and exec this */
 
@@ -99,6 +159,12 @@ struct ffsb_tg *fc_get_tg(ffsb_config_t *fc, unsigned num);
 /* get a particular filesystem object */
 struct ffsb_fs *fc_get_fs(ffsb_config_t *fc, unsigned num);
 
+/* Makes phase num the current one */
+void fc_set_phase(ffsb_config_t *fc, unsigned num);
+
+/* Frees every phase's threadgroups, and the phases */
+void fc_free_phases(ffsb_config_t *fc);
+
 void fc_set_callout(ffsb_config_t *fc, char *callout);
 char *fc_get_callout(ffsb_config_t *fc);
 
@@ -0,0 +1,54 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include "ffsb_bucket.h"
+#include "util.h"
+
+void ffsb_bucket_init(ffsb_bucket_t *b, double rate, uint64_t burst_nsec)
+{
+	b->rate = rate;
+	b->burst = burst_nsec;
+	b->tat = 0;
+}
+
+uint64_t ffsb_bucket_take(ffsb_bucket_t *b, uint64_t amount)
+{
+	uint64_t cost, tat, base;
+
+	if (!b->rate)
+		return 0;
+	cost = amount * 1000000000.0 / b->rate;
+	do {
+		tat = b->tat;
+		base = max(tat, ffsb_clock_nsec());
+	} while (!__sync_bool_compare_and_swap(&b->tat, tat, base + cost));
+
+	return (base > b->burst) ? base - b->burst : 0;
+}
+
+void ffsb_bucket_charge(ffsb_bucket_t *b, uint64_t amount)
+{
+	if (amount)
+		ffsb_bucket_take(b, amount);
+}
+
+uint64_t ffsb_bucket_ready(ffsb_bucket_t *b)
+{
+	uint64_t tat = b->tat;
+
+	return (tat > b->burst) ? tat - b->burst : 0;
+}
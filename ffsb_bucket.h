@@ -0,0 +1,50 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef _FFSB_BUCKET_H_
+#define _FFSB_BUCKET_H_
+
+#include <inttypes.h>
+
+/* Rate limiter shared by the threads of a threadgroup.
+ *
+ * It's a token bucket kept as GCRA: the only state is the time at
+ * which the bucket would be empty again if nothing more were taken
+ * (tat), moved forward with compare-and-swap, so threads never take
+ * a lock.  Taking n units moves tat on by n / rate seconds; a thread
+ * may go ahead while tat is no more than burst nsecs in the future.
+ */
+typedef struct ffsb_bucket {
+	double rate;		/* units per second, 0 is no limit */
+	uint64_t burst;		/* nsecs */
+	uint64_t tat;		/* CLOCK_MONOTONIC nsecs */
+} ffsb_bucket_t;
+
+void ffsb_bucket_init(ffsb_bucket_t *, double rate, uint64_t burst_nsec);
+
+/* Takes amount units and returns when the caller may go ahead */
+uint64_t ffsb_bucket_take(ffsb_bucket_t *, uint64_t amount);
+
+/* Takes amount units after the fact, the debt holds back whoever
+ * comes next
+ */
+void ffsb_bucket_charge(ffsb_bucket_t *, uint64_t amount);
+
+/* When the bucket lets the next caller go ahead, without taking */
+uint64_t ffsb_bucket_ready(ffsb_bucket_t *);
+
+#endif /* _FFSB_BUCKET_H_ */
@@ -0,0 +1,452 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "ffsb_dist.h"
+#include "util.h"
+
+/* Terms of the zeta sum added up exactly, Euler-Maclaurin does the
+ * rest to well under 1e-6
+ */
+#define ZETA_EXACT 16
+
+static double zeta(uint64_t n, double theta)
+{
+	double sum = 0, a = ZETA_EXACT, b = n;
+	uint64_t i;
+
+	for (i = 1; i <= n && i < ZETA_EXACT; i++)
+		sum += pow(i, -theta);
+	if (n < ZETA_EXACT)
+		return sum;
+
+	/* sum of x^-theta over [a, b] */
+	sum += (pow(b, 1 - theta) - pow(a, 1 - theta)) / (1 - theta);
+	sum += (pow(a, -theta) + pow(b, -theta)) / 2;
+	sum += theta * (pow(a, -theta - 1) - pow(b, -theta - 1)) / 12;
+	return sum;
+}
+
+void ffsb_zipf_init(ffsb_zipf_t *z, double theta)
+{
+	memset(z, 0, sizeof(ffsb_zipf_t));
+	z->theta = theta;
+}
+
+uint64_t ffsb_zipf_pick(ffsb_zipf_t *z, randdata_t *rd, uint64_t n)
+{
+	double theta = z->theta;
+	double zeta2 = 1 + pow(0.5, theta);
+	double u, uz;
+	uint64_t ret;
+
+	if (n < 2)
+		return 0;
+
+	if (n != z->n) {
+		z->n = n;
+		z->zetan = zeta(n, theta);
+		z->eta = (1 - pow(2.0 / n, 1 - theta)) / (1 - zeta2 / z->zetan);
+	}
+
+	u = getdrandom(rd);
+	uz = u * z->zetan;
+	if (uz < 1)
+		return 0;
+	if (uz < zeta2)
+		return 1;
+	ret = n * pow(z->eta * u - z->eta + 1, 1 / (1 - theta));
+	return ret < n ? ret : n - 1;
+}
+
+static char *pop_names[] = {
+	"uniform",
+	"zipf",
+	"hotspot",
+	"exponential",
+	"sequential",
+	NULL
+};
+
+int ffsb_popularity_type(char *name)
+{
+	int i;
+
+	for (i = 0; pop_names[i]; i++)
+		if (!strcmp(name, pop_names[i]))
+			return i;
+	return -1;
+}
+
+char *ffsb_popularity_name(int type)
+{
+	return pop_names[type];
+}
+
+uint64_t ffsb_popularity_pick(ffsb_popularity_t *pop, randdata_t *rd,
+			      uint64_t n)
+{
+	uint64_t hot, ret;
+	double mean;
+
+	switch (pop->type) {
+	case FFSB_POP_ZIPF:
+		return ffsb_zipf_pick(&pop->zipf, rd, n);
+	case FFSB_POP_HOTSPOT:
+		hot = n * pop->hot_files / 100;
+		if (hot == 0)
+			hot = 1;
+		if (hot >= n)
+			return getllrandom(rd, n);
+		if (getrandom(rd, 100) < pop->hot_ops)
+			return getllrandom(rd, hot);
+		return hot + getllrandom(rd, n - hot);
+	case FFSB_POP_EXPONENTIAL:
+		/* redraw the tail past n, rarely more than once */
+		mean = n * pop->exp_mean / 100;
+		do
+			ret = -log(1 - getdrandom(rd)) * mean;
+		while (ret >= n);
+		return ret;
+	case FFSB_POP_SEQUENTIAL:
+		return pop->cursor++ % n;
+	default:
+		return getllrandom(rd, n);
+	}
+}
+
+static char *off_names[] = {
+	"default",
+	"zipf",
+	"hotregion",
+	"streams",
+	"strided",
+	NULL
+};
+
+int ffsb_offsets_type(char *name)
+{
+	int i;
+
+	for (i = 0; off_names[i]; i++)
+		if (!strcmp(name, off_names[i]))
+			return i;
+	return -1;
+}
+
+char *ffsb_offsets_name(int type)
+{
+	return off_names[type];
+}
+
+void ffsb_offsets_start(ffsb_offsets_t *o, randdata_t *rd, uint64_t filesize,
+			uint32_t blocksize)
+{
+	uint64_t range = filesize - blocksize + 1;
+	unsigned i;
+
+	o->next = 0;
+	if (o->type == FFSB_OFF_STREAMS)
+		for (i = 0; i < o->streams; i++)
+			o->pos[i] = getllrandom(rd, range);
+	else if (o->type == FFSB_OFF_STRIDED)
+		o->pos[0] = getllrandom(rd, range);
+}
+
+uint64_t ffsb_offsets_next(ffsb_offsets_t *o, randdata_t *rd, uint64_t filesize,
+			   uint32_t blocksize, int align)
+{
+	uint64_t blocks = filesize / blocksize;
+	uint64_t range = filesize - blocksize + 1;
+	uint64_t hot, ret, step;
+	int64_t jitter;
+
+	switch (o->type) {
+	case FFSB_OFF_ZIPF:
+		ret = ffsb_zipf_pick(&o->zipf, rd, blocks) * blocksize;
+		break;
+	case FFSB_OFF_HOTREGION:
+		hot = range * o->hot_region / 100;
+		if (hot == 0)
+			hot = 1;
+		if (hot >= range)
+			ret = getllrandom(rd, range);
+		else if (getdrandom(rd) * 100 < o->hot_ops)
+			ret = getllrandom(rd, hot);
+		else
+			ret = hot + getllrandom(rd, range - hot);
+		break;
+	case FFSB_OFF_STREAMS:
+		ret = o->pos[o->next];
+		o->pos[o->next] = (ret + blocksize < range) ?
+			ret + blocksize : 0;
+		o->next = (o->next + 1) % o->streams;
+		break;
+	case FFSB_OFF_STRIDED:
+		ret = o->pos[0];
+		step = blocksize + o->stride;
+		if (o->jitter) {
+			jitter = getllrandom(rd, 2 * o->jitter + 1) - o->jitter;
+			if (jitter < 0 && -jitter > step)
+				jitter = -step;
+			step += jitter;
+		}
+		o->pos[0] = (ret + step) % range;
+		break;
+	default:
+		ret = getllrandom(rd, range);
+		break;
+	}
+
+	if (align)
+		ret &= ~4095ULL;
+	return ret;
+}
+
+void ffsb_offsets_print(char *name, ffsb_offsets_t *o)
+{
+	printf("\t %-16s = %s", name, ffsb_offsets_name(o->type));
+	switch (o->type) {
+	case FFSB_OFF_ZIPF:
+		printf(" (theta %.2lf)", o->zipf.theta);
+		break;
+	case FFSB_OFF_HOTREGION:
+		printf(" (%u%% of blocks to the first %u%% of the file)",
+		       o->hot_ops, o->hot_region);
+		break;
+	case FFSB_OFF_STREAMS:
+		printf(" (%u streams)", o->streams);
+		break;
+	case FFSB_OFF_STRIDED:
+		printf(" (stride %llu, jitter %llu)",
+		       (unsigned long long)o->stride,
+		       (unsigned long long)o->jitter);
+		break;
+	}
+	printf("\n");
+}
+
+static char *size_names[] = {
+	"fixed",
+	"weighted",
+	"uniform",
+	"lognormal",
+	"bimodal",
+	NULL
+};
+
+int ffsb_sizedist_type(char *name)
+{
+	int i;
+
+	for (i = 0; size_names[i]; i++)
+		if (!strcmp(name, size_names[i]))
+			return i;
+	return -1;
+}
+
+/* Box-Muller, one of the pair is enough */
+static double normal(randdata_t *rd)
+{
+	double u1 = 1.0 - getdrandom(rd);
+	double u2 = getdrandom(rd);
+
+	return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+uint64_t ffsb_sizedist_pick(ffsb_sizedist_t *sd, randdata_t *rd)
+{
+	uint64_t size, floor = sd->align ? sd->align : 1;
+	double d;
+	unsigned i;
+	int num;
+
+	switch (sd->type) {
+	case FFSB_SIZE_WEIGHTED:
+		num = getrandom(rd, sd->sum_weights);
+		for (i = 0; num >= sd->weights[i]; i++)
+			num -= sd->weights[i];
+		size = sd->sizes[i];
+		break;
+	case FFSB_SIZE_UNIFORM:
+		size = sd->min + getllrandom(rd, sd->max - sd->min + 1);
+		break;
+	case FFSB_SIZE_LOGNORMAL:
+		d = sd->median * exp(sd->sigma * normal(rd));
+		size = (d >= sd->max) ? sd->max : (uint64_t)d;
+		break;
+	case FFSB_SIZE_BIMODAL:
+		size = (getrandom(rd, 100) < sd->percent) ? sd->min : sd->max;
+		break;
+	default:
+		return sd->max;
+	}
+
+	size -= size % floor;
+	return (size < floor) ? floor : size;
+}
+
+void ffsb_sizedist_print(char *name, ffsb_sizedist_t *sd)
+{
+	char buf[256], buf2[256];
+	unsigned i;
+
+	printf("\t %-16s = %s", name, size_names[sd->type]);
+	switch (sd->type) {
+	case FFSB_SIZE_WEIGHTED:
+		printf("\n");
+		for (i = 0; i < sd->num_weights; i++)
+			printf("\t\t %s\t%.2lf%%\n",
+			       ffsb_printsize(buf, sd->sizes[i], 256),
+			       100.0 * sd->weights[i] / sd->sum_weights);
+		return;
+	case FFSB_SIZE_UNIFORM:
+		printf(" (%s to %s)", ffsb_printsize(buf, sd->min, 256),
+		       ffsb_printsize(buf2, sd->max, 256));
+		break;
+	case FFSB_SIZE_LOGNORMAL:
+		printf(" (median %s, sigma %.2lf, at most %s)",
+		       ffsb_printsize(buf, sd->median, 256), sd->sigma,
+		       ffsb_printsize(buf2, sd->max, 256));
+		break;
+	case FFSB_SIZE_BIMODAL:
+		printf(" (%s %u%% of the time, else %s)",
+		       ffsb_printsize(buf, sd->min, 256), sd->percent,
+		       ffsb_printsize(buf2, sd->max, 256));
+		break;
+	}
+	printf("\n");
+}
+
+static char *think_names[] = {
+	"none",
+	"fixed",
+	"exponential",
+	"uniform",
+	"lognormal",
+	"empirical",
+	NULL
+};
+
+int ffsb_thinktime_type(char *name)
+{
+	int i;
+
+	for (i = 0; think_names[i]; i++)
+		if (!strcmp(name, think_names[i]))
+			return i;
+	return -1;
+}
+
+void ffsb_thinktime_load(ffsb_thinktime_t *tt, char *path)
+{
+	unsigned alloced = 1024;
+	char line[256], *end;
+	uint64_t usec;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (!f) {
+		perror(path);
+		exit(1);
+	}
+
+	tt->path = ffsb_strdup(path);
+	tt->num_samples = 0;
+	tt->samples = ffsb_malloc(alloced * sizeof(uint64_t));
+	while (fgets(line, sizeof(line), f)) {
+		end = strchr(line, '#');
+		if (end)
+			*end = '\0';
+		usec = strtoull(line, &end, 10);
+		if (end == line)
+			continue;
+		if (tt->num_samples == alloced) {
+			alloced *= 2;
+			tt->samples = ffsb_realloc(tt->samples,
+						   alloced * sizeof(uint64_t));
+		}
+		tt->samples[tt->num_samples++] = usec;
+	}
+	fclose(f);
+
+	if (!tt->num_samples) {
+		printf("Error: no think time samples in %s\n", path);
+		exit(1);
+	}
+}
+
+uint64_t ffsb_thinktime_pick(ffsb_thinktime_t *tt, randdata_t *rd)
+{
+	switch (tt->type) {
+	case FFSB_THINK_FIXED:
+		return tt->a;
+	case FFSB_THINK_EXPONENTIAL:
+		return -tt->a * log(1.0 - getdrandom(rd));
+	case FFSB_THINK_UNIFORM:
+		return tt->a + getdrandom(rd) * (tt->b - tt->a);
+	case FFSB_THINK_LOGNORMAL:
+		return tt->a * exp(tt->sigma * normal(rd));
+	case FFSB_THINK_EMPIRICAL:
+		return tt->samples[getrandom(rd, tt->num_samples)];
+	}
+	return 0;
+}
+
+void ffsb_thinktime_print(ffsb_thinktime_t *tt)
+{
+	printf("\t think_time       = %s", think_names[tt->type]);
+	switch (tt->type) {
+	case FFSB_THINK_FIXED:
+		printf(" (%.0lf usec)", tt->a);
+		break;
+	case FFSB_THINK_EXPONENTIAL:
+		printf(" (mean %.0lf usec)", tt->a);
+		break;
+	case FFSB_THINK_UNIFORM:
+		printf(" (%.0lf to %.0lf usec)", tt->a, tt->b);
+		break;
+	case FFSB_THINK_LOGNORMAL:
+		printf(" (median %.0lf usec, sigma %.2lf)", tt->a, tt->sigma);
+		break;
+	case FFSB_THINK_EMPIRICAL:
+		printf(" (%u samples from %s)", tt->num_samples, tt->path);
+		break;
+	}
+	printf("\n");
+}
+
+void ffsb_popularity_print(ffsb_popularity_t *pop)
+{
+	printf("\t file_popularity  = %s", ffsb_popularity_name(pop->type));
+	switch (pop->type) {
+	case FFSB_POP_ZIPF:
+		printf(" (theta %.2lf)", pop->zipf.theta);
+		break;
+	case FFSB_POP_HOTSPOT:
+		printf(" (%u%% of picks to %u%% of files)", pop->hot_ops,
+		       pop->hot_files);
+		break;
+	case FFSB_POP_EXPONENTIAL:
+		printf(" (mean %.2lf%% of files)", pop->exp_mean);
+		break;
+	}
+	printf("\n");
+}
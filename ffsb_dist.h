@@ -0,0 +1,194 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef _FFSB_DIST_H_
+#define _FFSB_DIST_H_
+
+#include <inttypes.h>
+
+#include "rand.h"
+
+/* Zipf over [0, n), rank 0 the most popular, using Gray et al's
+ * "Quickly generating billion-record synthetic databases" method.
+ * The normalization constant is approximated in O(1) (Euler-Maclaurin
+ * past the first terms), so n may change from one pick to the next,
+ * e.g. as files are created.  0 < theta < 1.
+ */
+typedef struct ffsb_zipf {
+	double theta;
+
+	/* cached for the last n */
+	uint64_t n;
+	double zetan;
+	double eta;
+} ffsb_zipf_t;
+
+void ffsb_zipf_init(ffsb_zipf_t *, double theta);
+uint64_t ffsb_zipf_pick(ffsb_zipf_t *, randdata_t *, uint64_t n);
+
+/* How choose_file() picks among a fileset's files.  Ranks are file
+ * numbers, so with the skewed distributions the first files created
+ * are the hottest.
+ */
+#define FFSB_POP_UNIFORM     0
+#define FFSB_POP_ZIPF        1
+#define FFSB_POP_HOTSPOT     2
+#define FFSB_POP_EXPONENTIAL 3
+#define FFSB_POP_SEQUENTIAL  4
+
+#define FFSB_POP_DEFAULT_ZIPF_THETA 0.99
+#define FFSB_POP_DEFAULT_HOT_OPS    80
+#define FFSB_POP_DEFAULT_HOT_FILES  20
+#define FFSB_POP_DEFAULT_EXP_MEAN   10.0
+
+typedef struct ffsb_popularity {
+	int type;
+	ffsb_zipf_t zipf;
+	uint32_t hot_ops;	/* percent of picks going to... */
+	uint32_t hot_files;	/* ...this percent of the files */
+	double exp_mean;	/* percent of the files */
+
+	/* sequential, next file to hand out */
+	uint64_t cursor;
+} ffsb_popularity_t;
+
+/* Returns the type for a name, -1 if there's no such distribution */
+int ffsb_popularity_type(char *name);
+char *ffsb_popularity_name(int type);
+
+uint64_t ffsb_popularity_pick(ffsb_popularity_t *, randdata_t *, uint64_t n);
+void ffsb_popularity_print(ffsb_popularity_t *);
+
+/* Where in a file the read and write ops put their blocks.  default
+ * is their usual behavior (read_random/write_random or sequential
+ * from a random point).  The others place each block of an op:
+ *
+ * zipf      - over the file's blocks, the first blocks the hottest
+ * hotregion - hot_ops percent of blocks in the first hot_region
+ *             percent of the file, the rest uniformly after it
+ * streams   - streams sequential streams from random points, taking
+ *             turns block by block, wrapping at the end of the file
+ * strided   - from a random point, each block stride bytes past the
+ *             end of the last, give or take up to jitter bytes
+ */
+#define FFSB_OFF_DEFAULT   0
+#define FFSB_OFF_ZIPF      1
+#define FFSB_OFF_HOTREGION 2
+#define FFSB_OFF_STREAMS   3
+#define FFSB_OFF_STRIDED   4
+
+#define FFSB_OFF_DEFAULT_STREAMS 4
+#define FFSB_OFF_MAX_STREAMS     64
+
+typedef struct ffsb_offsets {
+	int type;
+	ffsb_zipf_t zipf;
+	uint32_t hot_ops;	/* percent */
+	uint32_t hot_region;	/* percent */
+	uint32_t streams;
+	uint64_t stride;
+	uint64_t jitter;
+
+	/* state for the op in progress */
+	uint64_t pos[FFSB_OFF_MAX_STREAMS];
+	unsigned next;
+} ffsb_offsets_t;
+
+int ffsb_offsets_type(char *name);
+char *ffsb_offsets_name(int type);
+
+/* Called once per op, then _next() for each block.  Offsets leave
+ * room for a whole block, and are 4k aligned if align is set.
+ */
+void ffsb_offsets_start(ffsb_offsets_t *, randdata_t *, uint64_t filesize,
+			uint32_t blocksize);
+uint64_t ffsb_offsets_next(ffsb_offsets_t *, randdata_t *, uint64_t filesize,
+			   uint32_t blocksize, int align);
+void ffsb_offsets_print(char *name, ffsb_offsets_t *);
+
+/* Sizes of ops and of the syscalls within them.  fixed always gives
+ * max, the rest draw a size on every pick:
+ *
+ * weighted  - from a list of sizes with integer weights
+ * uniform   - uniformly between min and max
+ * lognormal - median * e^(sigma * N(0,1)), cut off at max
+ * bimodal   - min percent of the time, otherwise max
+ *
+ * Sizes are rounded down to a multiple of align, and are never less
+ * than align (or 1).
+ */
+#define FFSB_SIZE_FIXED     0
+#define FFSB_SIZE_WEIGHTED  1
+#define FFSB_SIZE_UNIFORM   2
+#define FFSB_SIZE_LOGNORMAL 3
+#define FFSB_SIZE_BIMODAL   4
+
+typedef struct ffsb_sizedist {
+	int type;
+	uint64_t min;
+	uint64_t max;
+	uint64_t median;
+	double sigma;
+	uint32_t percent;
+	uint32_t align;
+
+	unsigned num_weights;
+	unsigned sum_weights;
+	uint64_t *sizes;
+	unsigned *weights;
+} ffsb_sizedist_t;
+
+int ffsb_sizedist_type(char *name);
+uint64_t ffsb_sizedist_pick(ffsb_sizedist_t *, randdata_t *);
+void ffsb_sizedist_print(char *name, ffsb_sizedist_t *);
+
+/* How long a thread waits after each op, in usecs:
+ *
+ * fixed       - always a
+ * exponential - mean a, as between independent arrivals
+ * uniform     - between a and b
+ * lognormal   - median a * e^(sigma * N(0,1))
+ * empirical   - one of the samples read from a file
+ */
+#define FFSB_THINK_NONE        0
+#define FFSB_THINK_FIXED       1
+#define FFSB_THINK_EXPONENTIAL 2
+#define FFSB_THINK_UNIFORM     3
+#define FFSB_THINK_LOGNORMAL   4
+#define FFSB_THINK_EMPIRICAL   5
+
+typedef struct ffsb_thinktime {
+	int type;
+	double a;
+	double b;
+	double sigma;
+
+	uint64_t *samples;
+	unsigned num_samples;
+	char *path;
+} ffsb_thinktime_t;
+
+int ffsb_thinktime_type(char *name);
+
+/* Reads the samples for an empirical think time, one number of
+ * usecs per line, '#' starts a comment.  Exits on error.
+ */
+void ffsb_thinktime_load(ffsb_thinktime_t *, char *path);
+uint64_t ffsb_thinktime_pick(ffsb_thinktime_t *, randdata_t *);
+void ffsb_thinktime_print(ffsb_thinktime_t *);
+
+#endif /* _FFSB_DIST_H_ */
@@ -62,10 +62,13 @@ void destroy_ffsb_config(ffsb_config_t *fc)
 	for (i = 0; i < fc->num_filesys; i++)
 		destroy_ffsb_fs(&fc->filesystems[i]);
 
-	for (i = 0; i < fc->num_threadgroups; i++)
-		destroy_ffsb_tg(&fc->groups[i]);
-
-	free(fc->groups);
+	if (fc->phases) {
+		fc_free_phases(fc);
+	} else {
+		for (i = 0; i < fc->num_threadgroups; i++)
+			destroy_ffsb_tg(&fc->groups[i]);
+		free(fc->groups);
+	}
 	free(fc->filesystems);
 }
 
@@ -99,6 +102,36 @@ void fc_set_num_totalthreads(ffsb_config_t *fc, int num)
 	fc->num_totalthreads = num;
 }
 
+void fc_set_phase(ffsb_config_t *fc, unsigned num)
+{
+	ffsb_phase_t *ph;
+
+	assert(num < fc->num_phases);
+	ph = &fc->phases[num];
+	fc->time = ph->time;
+	fc->warmup = ph->warmup;
+	fc->cooldown = ph->cooldown;
+	fc->stop = ph->stop;
+	fc->steady = ph->steady;
+	fc->num_threadgroups = ph->num_threadgroups;
+	fc->num_totalthreads = ph->num_totalthreads;
+	fc->groups = ph->groups;
+}
+
+void fc_free_phases(ffsb_config_t *fc)
+{
+	int i, j;
+
+	for (i = 0; i < fc->num_phases; i++) {
+		for (j = 0; j < fc->phases[i].num_threadgroups; j++)
+			destroy_ffsb_tg(&fc->phases[i].groups[j]);
+		free(fc->phases[i].groups);
+	}
+	free(fc->phases);
+	fc->phases = NULL;
+	fc->groups = NULL;
+}
+
 void fc_set_callout(ffsb_config_t *fc, char *callout)
 {
 	if (fc->callout)
@@ -25,6 +25,10 @@
 #include "ffsb_fs.h"
 #include "util.h"
 #include "fh.h"
+#include "verify.h"
+#include "lsmops.h"
+#include "pageops.h"
+#include "objops.h"
 
 /* First zero out struct, set num_dirs, and strdups basedir */
 void init_ffsb_fs(ffsb_fs_t *fs, char *basedir, uint32_t num_data_dirs,
@@ -38,6 +42,13 @@ void init_ffsb_fs(ffsb_fs_t *fs, char *basedir, uint32_t num_data_dirs,
 	fs->create_blocksize = FFSB_FS_DEFAULT_CREATE_BLOCKSIZE;
 	fs->age_blocksize = FFSB_FS_DEFAULT_AGE_BLOCKSIZE;
 	fs->age_fs = 0;
+	fs->lsm_sst_size = FFSB_FS_DEFAULT_LSM_SST_SIZE;
+	fs->lsm_fanout = FFSB_FS_DEFAULT_LSM_FANOUT;
+	fs->lsm_l0_files = FFSB_FS_DEFAULT_LSM_L0_FILES;
+	fs->lsm_levels = FFSB_FS_DEFAULT_LSM_LEVELS;
+	fs->page_files = FFSB_FS_DEFAULT_PAGE_FILES;
+	fs->page_file_size = FFSB_FS_DEFAULT_PAGE_FILE_SIZE;
+	fs->obj_levels = FFSB_FS_DEFAULT_OBJ_LEVELS;
 }
 
 /*
@@ -50,6 +61,9 @@ void destroy_ffsb_fs(ffsb_fs_t *fs)
 	destroy_filelist(&fs->files);
 	destroy_filelist(&fs->fill);
 	destroy_filelist(&fs->meta);
+	lsm_destroy(fs);
+	page_destroy(fs);
+	obj_destroy(fs);
 }
 
 void clone_ffsb_fs(ffsb_fs_t *target, ffsb_fs_t *orig)
@@ -78,6 +92,16 @@ void clone_ffsb_fs(ffsb_fs_t *target, ffsb_fs_t *orig)
 	target->age_blocksize = orig->age_blocksize;
 
 	memcpy(target->op_data, orig->op_data, sizeof(void *) * FFSB_NUMOPS);
+	memcpy(target->op_used, orig->op_used, sizeof(int) * FFSB_NUMOPS);
+
+	target->lsm_sst_size = orig->lsm_sst_size;
+	target->lsm_fanout = orig->lsm_fanout;
+	target->lsm_l0_files = orig->lsm_l0_files;
+	target->lsm_levels = orig->lsm_levels;
+	target->page_files = orig->page_files;
+	target->page_file_size = orig->page_file_size;
+	target->obj_levels = orig->obj_levels;
+	target->num_objects = orig->num_objects;
 }
 
 static void add_files(ffsb_fs_t *fs, struct benchfiles *bf, int num,
@@ -130,6 +154,10 @@ static void add_files(ffsb_fs_t *fs, struct benchfiles *bf, int num,
 		else
 			size = minsize + getllrandom(&rd, maxsize - minsize);
 
+		/* verify only deals in whole blocks */
+		if (fs_get_verify(fs))
+			size &= ~(uint64_t)(VERIFY_BLOCKSIZE - 1);
+
 		cur = add_file(bf, size, &rd);
 		fd = fhopencreate(cur->name, NULL, fs);
 		writefile_helper(fd, size, blocksize, buf, NULL, fs);
@@ -419,6 +447,14 @@ static void age_fs(ffsb_fs_t *fs, double utilization)
 	pthread_join(thread, NULL);
 }
 
+void fs_reage(ffsb_fs_t *fs)
+{
+	if (!fs->age_fs)
+		return;
+	fs->start_fsutil = getfsutil(fs->basedir);
+	age_fs(fs, fs->desired_fsutil);
+}
+
 void fs_set_create_blocksize(ffsb_fs_t *fs, uint32_t blocksize)
 {
 	fs->create_blocksize = blocksize;
@@ -493,6 +529,19 @@ void fs_set_alignio(ffsb_fs_t *fs, int aio)
 		fs->flags &= ~0 & ~FFSB_FS_ALIGNIO4K;
 }
 
+int fs_get_verify(ffsb_fs_t *fs)
+{
+	return fs->flags & FFSB_FS_VERIFY;
+}
+
+void fs_set_verify(ffsb_fs_t *fs, int verify)
+{
+	if (verify)
+		fs->flags |= FFSB_FS_VERIFY;
+	else
+		fs->flags &= ~0 & ~FFSB_FS_VERIFY;
+}
+
 int fs_get_reuse_fs(ffsb_fs_t *fs)
 {
 	return fs->flags & FFSB_FS_REUSE_FS;
@@ -549,6 +598,16 @@ void fs_set_opdata(ffsb_fs_t *fs, void *data, unsigned opnum)
 	fs->op_data[opnum] = data;
 }
 
+void fs_set_op_used(ffsb_fs_t *fs, unsigned opnum)
+{
+	fs->op_used[opnum] = 1;
+}
+
+int fs_get_op_used(ffsb_fs_t *fs, unsigned opnum)
+{
+	return fs->op_used[opnum];
+}
+
 void *fs_get_opdata(ffsb_fs_t *fs, unsigned opnum)
 {
 	return fs->op_data[opnum];
@@ -579,6 +638,27 @@ double fs_get_desired_fsutil(ffsb_fs_t *fs)
 	return fs->desired_fsutil;
 }
 
+static int fs_uses_lsm(ffsb_fs_t *fs)
+{
+	return fs->op_used[ops_find_op("lsm_flush")] ||
+		fs->op_used[ops_find_op("lsm_compact")] ||
+		fs->op_used[ops_find_op("lsm_get")];
+}
+
+static int fs_uses_pages(ffsb_fs_t *fs)
+{
+	return fs->op_used[ops_find_op("page_read")] ||
+		fs->op_used[ops_find_op("page_write")] ||
+		fs->op_used[ops_find_op("checkpoint")];
+}
+
+static int fs_uses_objects(ffsb_fs_t *fs)
+{
+	return fs->op_used[ops_find_op("obj_put")] ||
+		fs->op_used[ops_find_op("obj_get")] ||
+		fs->op_used[ops_find_op("obj_delete")];
+}
+
 void fs_print_config(ffsb_fs_t *fs)
 {
 	char buf[256];
@@ -600,9 +680,11 @@ void fs_print_config(ffsb_fs_t *fs)
 				(float)fs->sum_weights) * 100);
 	}
 	else {
-		printf("\t min file size    = %llu\t(%s)\n", fs->minfilesize,
+		printf("\t min file size    = %llu\t(%s)\n",
+		       (unsigned long long)fs->minfilesize,
 		       ffsb_printsize(buf, fs->minfilesize, 256));
-		printf("\t max file size    = %llu\t(%s)\n", fs->maxfilesize,
+		printf("\t max file size    = %llu\t(%s)\n",
+		       (unsigned long long)fs->maxfilesize,
 		       ffsb_printsize(buf, fs->maxfilesize, 256));
 	}
 	printf("\t directio         = %s\n", (fs->flags & FFSB_FS_DIRECTIO) ?
@@ -611,6 +693,26 @@ void fs_print_config(ffsb_fs_t *fs)
 	       "on" : "off");
 	printf("\t bufferedio       = %s\n", (fs->flags & FFSB_FS_LIBCIO) ?
 	       "on" : "off");
+	printf("\t verify           = %s\n", (fs->flags & FFSB_FS_VERIFY) ?
+	       "on" : "off");
+	if (fs_uses_lsm(fs)) {
+		printf("\t lsm sst size     = %llu\t(%s)\n",
+		       (unsigned long long)fs->lsm_sst_size,
+		       ffsb_printsize(buf, fs->lsm_sst_size, 256));
+		printf("\t lsm fanout       = %u\n", fs->lsm_fanout);
+		printf("\t lsm l0 files     = %u\n", fs->lsm_l0_files);
+		printf("\t lsm levels       = %u\n", fs->lsm_levels);
+	}
+	if (fs_uses_pages(fs)) {
+		printf("\t page files       = %u\n", fs->page_files);
+		printf("\t page file size   = %llu\t(%s)\n",
+		       (unsigned long long)fs->page_file_size,
+		       ffsb_printsize(buf, fs->page_file_size, 256));
+	}
+	if (fs_uses_objects(fs)) {
+		printf("\t object levels    = %u\n", fs->obj_levels);
+		printf("\t starting objects = %u\n", fs->num_objects);
+	}
 	printf("\t\n");
 	printf("\t aging is %s\n", (fs->age_fs) ? "on" : "off");
 	printf("\t current utilization = %.2f\%\n", getfsutil(fs->basedir)*100);
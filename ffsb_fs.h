@@ -31,6 +31,9 @@
 #define AGE_BASE   "fill"
 
 struct ffsb_tg;
+struct lsm_tree;
+struct page_store;
+struct obj_store;
 
 typedef struct size_weight {
 	uint64_t size;
@@ -71,6 +74,7 @@ typedef struct ffsb_fs {
 #define FFSB_FS_ALIGNIO4K  (1 << 1)
 #define FFSB_FS_LIBCIO     (1 << 2)
 #define FFSB_FS_REUSE_FS   (1 << 3)
+#define FFSB_FS_VERIFY     (1 << 4)
 
 	/* These pararmeters pertain to files in the files and fill
 	 * dirs.  Meta dir only contains directories, starting with 0.
@@ -114,6 +118,41 @@ typedef struct ffsb_fs {
 	unsigned num_weights;
 	unsigned sum_weights;
 
+	/* Set by the parser for each op some threadgroup may run on
+	 * this fs, so ops keeping their own files only set up when
+	 * they're actually used
+	 */
+	int op_used[FFSB_NUMOPS];
+
+	/* LSM-tree shape for the lsm ops, see lsmops.h */
+	uint64_t lsm_sst_size;
+	uint32_t lsm_fanout;
+	uint32_t lsm_l0_files;
+	uint32_t lsm_levels;
+#define FFSB_FS_DEFAULT_LSM_SST_SIZE (4 * 1024 * 1024)
+#define FFSB_FS_DEFAULT_LSM_FANOUT   10
+#define FFSB_FS_DEFAULT_LSM_L0_FILES 4
+#define FFSB_FS_DEFAULT_LSM_LEVELS   4
+#define FFSB_FS_MAX_LSM_LEVELS       8
+	struct lsm_tree *lsm;
+
+	/* Data files for the page ops, see pageops.h */
+	uint32_t page_files;
+	uint64_t page_file_size;
+#define FFSB_FS_DEFAULT_PAGE_FILES     1
+#define FFSB_FS_DEFAULT_PAGE_FILE_SIZE (256 * 1024 * 1024)
+	struct page_store *pages;
+
+	/* Object store for the obj ops, see objops.h */
+	uint32_t obj_levels;
+	uint32_t num_objects;
+#define FFSB_FS_DEFAULT_OBJ_LEVELS 2
+#define FFSB_FS_MAX_OBJ_LEVELS     4
+	struct obj_store *objects;
+
+	/* replay op, traces replayed on this fs */
+	struct replay_trace *replays;
+
 } ffsb_fs_t;
 
 /* Set up the structure, zeros everything out and dups the basedir
@@ -136,6 +175,12 @@ void destroy_ffsb_fs(ffsb_fs_t *fs);
  */
 void *construct_ffsb_fs(void *ffsb_fs_ptr);
 
+/* Ages a constructed filesystem back up to its desired utilization,
+ * if it is aged at all, between runs on the same fileset.  The ops
+ * are left set up for aging, ops_setup_bench() has to follow.
+ */
+void fs_reage(ffsb_fs_t *fs);
+
 /* Shallow clone, original should simply be discarded (not destroyed).
  * Generally should only be used by parser to write into the config
  * object
@@ -151,6 +196,8 @@ int fs_get_alignio(ffsb_fs_t *fs);
 void fs_set_alignio(ffsb_fs_t *fs, int aio);
 int fs_get_libcio(ffsb_fs_t *fs);
 void fs_set_libcio(ffsb_fs_t *fs, int lio);
+int fs_get_verify(ffsb_fs_t *fs);
+void fs_set_verify(ffsb_fs_t *fs, int verify);
 int fs_get_reuse_fs(ffsb_fs_t *fs);
 void fs_set_reuse_fs(ffsb_fs_t *fs, int rfs);
 
@@ -163,6 +210,8 @@ struct ffsb_tg *fs_get_aging_tg(ffsb_fs_t *fs);
 int fs_get_agefs(ffsb_fs_t *fs);
 
 void fs_set_opdata(ffsb_fs_t *fs, void *data, unsigned opnum);
+void fs_set_op_used(ffsb_fs_t *fs, unsigned opnum);
+int fs_get_op_used(ffsb_fs_t *fs, unsigned opnum);
 void *fs_get_opdata(ffsb_fs_t *fs, unsigned opnum);
 void fs_set_min_filesize(ffsb_fs_t *fs, uint64_t size);
 void fs_set_max_filesize(ffsb_fs_t *fs, uint64_t size);
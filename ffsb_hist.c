@@ -0,0 +1,118 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include <string.h>
+
+#include "ffsb_hist.h"
+
+static unsigned hist_index(uint64_t value)
+{
+	unsigned msb;
+
+	if (value < FFSB_HIST_SUB)
+		return value;
+
+	msb = 63 - __builtin_clzll(value);
+	return (msb - FFSB_HIST_SUB_BITS + 1) * FFSB_HIST_SUB +
+		((value >> (msb - FFSB_HIST_SUB_BITS)) & (FFSB_HIST_SUB - 1));
+}
+
+/* Largest value that lands in bucket idx */
+static uint64_t hist_value(unsigned idx)
+{
+	unsigned shift;
+
+	if (idx < FFSB_HIST_SUB)
+		return idx;
+
+	shift = idx / FFSB_HIST_SUB - 1;
+	return ((uint64_t)(FFSB_HIST_SUB + idx % FFSB_HIST_SUB) << shift) +
+		((1ULL << shift) - 1);
+}
+
+void ffsb_hist_init(ffsb_hist_t *h)
+{
+	memset(h, 0, sizeof(ffsb_hist_t));
+}
+
+void ffsb_hist_add(ffsb_hist_t *h, uint64_t value)
+{
+	h->buckets[hist_index(value)]++;
+	h->count++;
+	h->sum += value;
+	if (value > h->max)
+		h->max = value;
+}
+
+void ffsb_hist_merge(ffsb_hist_t *target, ffsb_hist_t *src)
+{
+	unsigned i;
+
+	if (src->count == 0)
+		return;
+
+	for (i = 0; i < FFSB_HIST_BUCKETS; i++)
+		target->buckets[i] += src->buckets[i];
+	target->count += src->count;
+	target->sum += src->sum;
+	if (src->max > target->max)
+		target->max = src->max;
+}
+
+void ffsb_hist_diff(ffsb_hist_t *d, ffsb_hist_t *cur, ffsb_hist_t *last)
+{
+	unsigned i;
+
+	if (cur->count < last->count) {
+		memcpy(d, cur, sizeof(*d));
+		return;
+	}
+	for (i = 0; i < FFSB_HIST_BUCKETS; i++)
+		d->buckets[i] = cur->buckets[i] - last->buckets[i];
+	d->count = cur->count - last->count;
+	d->sum = cur->sum - last->sum;
+	d->max = cur->max;
+}
+
+uint64_t ffsb_hist_percentile(ffsb_hist_t *h, double pct)
+{
+	uint64_t rank, seen = 0;
+	unsigned i;
+
+	if (h->count == 0)
+		return 0;
+
+	rank = (uint64_t)(pct / 100.0 * h->count + 0.5);
+	if (rank < 1)
+		rank = 1;
+
+	for (i = 0; i < FFSB_HIST_BUCKETS; i++) {
+		seen += h->buckets[i];
+		if (seen >= rank)
+			break;
+	}
+
+	/* The top bucket is as wide as 3% of the value, but we
+	 * know the real maximum
+	 */
+	return hist_value(i) < h->max ? hist_value(i) : h->max;
+}
+
+double ffsb_hist_mean(ffsb_hist_t *h)
+{
+	return h->count ? (double)h->sum / h->count : 0;
+}
@@ -0,0 +1,55 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef _FFSB_HIST_H_
+#define _FFSB_HIST_H_
+
+#include <inttypes.h>
+
+/* Log-linear latency histogram.
+ *
+ * Values below FFSB_HIST_SUB are counted exactly, above that every
+ * power of two is split into FFSB_HIST_SUB equal buckets, so any
+ * percentile is within about 3% of the real value.  It's fixed size
+ * and merging two is just adding the buckets, which lets it live in
+ * the per-thread results.  Values are in usecs.
+ */
+#define FFSB_HIST_SUB_BITS 5
+#define FFSB_HIST_SUB      (1 << FFSB_HIST_SUB_BITS)
+#define FFSB_HIST_BUCKETS  ((64 - FFSB_HIST_SUB_BITS + 1) * FFSB_HIST_SUB)
+
+typedef struct ffsb_hist {
+	uint64_t count;
+	uint64_t sum;
+	uint64_t max;
+	uint64_t buckets[FFSB_HIST_BUCKETS];
+} ffsb_hist_t;
+
+void ffsb_hist_init(ffsb_hist_t *);
+void ffsb_hist_add(ffsb_hist_t *, uint64_t value);
+void ffsb_hist_merge(ffsb_hist_t *target, ffsb_hist_t *src);
+
+/* The samples added to cur since it was last, into d.  If cur was
+ * reset in between, d is all of cur.
+ */
+void ffsb_hist_diff(ffsb_hist_t *d, ffsb_hist_t *cur, ffsb_hist_t *last);
+
+/* Smallest value at or above pct percent of the samples, 0 if empty */
+uint64_t ffsb_hist_percentile(ffsb_hist_t *, double pct);
+double ffsb_hist_mean(ffsb_hist_t *);
+
+#endif /* _FFSB_HIST_H_ */
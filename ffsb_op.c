@@ -22,6 +22,13 @@
 #include "ffsb_op.h"
 #include "fileops.h"
 #include "metaops.h"
+#include "lockops.h"
+#include "scanops.h"
+#include "lsmops.h"
+#include "pageops.h"
+#include "objops.h"
+#include "streamops.h"
+#include "replayops.h"
 
 ffsb_op_t ffsb_op_list[] =
 {{0, "read", ffsb_readfile, READ, fop_bench, NULL},
@@ -39,6 +46,33 @@ ffsb_op_t ffsb_op_list[] =
  {12, "write_fsync", ffsb_writefile_fsync, WRITE, fop_bench, NULL},
  {13, "create_fsync", ffsb_createfile_fsync, WRITE, fop_bench, fop_age},
  {14, "append_fsync", ffsb_appendfile_fsync, WRITE, fop_bench, fop_age},
+ {15, "create_tmpfile", ffsb_createfile_tmpfile, WRITE, fop_bench, fop_age},
+ {16, "create_tmpfile_fsync", ffsb_createfile_tmpfile_fsync, WRITE, fop_bench,
+  fop_age},
+ {17, "lock", ffsb_lock, NA, fop_bench, NULL, ffsb_lock_print_exl},
+ {18, "flock", ffsb_flock, NA, fop_bench, NULL, ffsb_lock_print_exl},
+ {19, "rmw", ffsb_rmw, WRITE, fop_bench, NULL},
+ {20, "rmw_fdatasync", ffsb_rmw_fdatasync, WRITE, fop_bench, NULL},
+ {21, "scan", ffsb_scan, READ, fop_bench, NULL, ffsb_scan_print_exl},
+ {22, "lsm_flush", ffsb_lsm_flush, WRITE, lsm_bench, NULL,
+  ffsb_lsm_flush_print_exl},
+ {23, "lsm_compact", ffsb_lsm_compact, WRITE, lsm_bench, NULL,
+  ffsb_lsm_compact_print_exl},
+ {24, "lsm_get", ffsb_lsm_get, READ, lsm_bench, NULL, ffsb_lsm_get_print_exl},
+ {25, "page_read", ffsb_page_read, READ, page_bench, NULL,
+  ffsb_page_print_exl},
+ {26, "page_write", ffsb_page_write, WRITE, page_bench, NULL,
+  ffsb_page_print_exl},
+ {27, "checkpoint", ffsb_checkpoint, WRITE, page_bench, NULL,
+  ffsb_checkpoint_print_exl},
+ {28, "obj_put", ffsb_obj_put, WRITE, obj_bench, NULL, ffsb_obj_print_exl},
+ {29, "obj_get", ffsb_obj_get, READ, obj_bench, NULL, ffsb_obj_print_exl},
+ {30, "obj_delete", ffsb_obj_delete, NA, obj_bench, NULL, ffsb_obj_print_exl},
+ {31, "stream_read", ffsb_stream_read, READ, fop_bench, NULL,
+  ffsb_stream_print_exl},
+ {32, "stream_write", ffsb_stream_write, WRITE, fop_bench, NULL,
+  ffsb_stream_print_exl},
+ {33, "replay", ffsb_replay, NA, replay_bench, NULL, ffsb_replay_print_exl},
 };
 
 void init_ffsb_op_results(ffsb_op_results_t *results)
@@ -88,20 +122,30 @@ static void print_op_results(unsigned int op_num, ffsb_op_results_t *results,
 			 op_pcnt, weight_pcnt, runtime, buf);
 }
 
-#if 0
-static void print_op_throughput(unsigned int op_num, ffsb_op_results_t *results,
-				double runtime)
+static int print_op_throughput(unsigned int op_num, ffsb_op_results_t *results,
+			       double runtime)
 {
-	if (ffsb_op_list[op_num].op_exl_print_fn != NULL)
-		ffsb_op_list[op_num].op_exl_print_fn(results, runtime, op_num);
+	if (ffsb_op_list[op_num].op_exl_print_fn == NULL)
+		return 0;
+	ffsb_op_list[op_num].op_exl_print_fn(results, runtime, op_num);
+	return 1;
+}
+
+static void print_arrival_hist(char *name, ffsb_hist_t *h)
+{
+	printf("  %-20s avg %.3lf p50 %.3lf p99 %.3lf p99.9 %.3lf "
+	       "max %.3lf msec\n", name, ffsb_hist_mean(h) / 1000.0,
+	       ffsb_hist_percentile(h, 50.0) / 1000.0,
+	       ffsb_hist_percentile(h, 99.0) / 1000.0,
+	       ffsb_hist_percentile(h, 99.9) / 1000.0, h->max / 1000.0);
 }
-#endif
 
 void print_results(struct ffsb_op_results *results, double runtime)
 {
 	int i;
 	uint64_t total_ops = 0;
 	uint64_t total_weight = 0;
+	int extra = 0;
 	char buf[256];
 
 	for (i = 0; i < FFSB_NUMOPS ; i++) {
@@ -117,6 +161,12 @@ void print_results(struct ffsb_op_results *results, double runtime)
 					 total_weight);
 	printf("-\n%.2lf Transactions per Second\n\n", (double)total_ops / runtime);
 
+	for (i = 0; i < FFSB_NUMOPS ; i++)
+		if (results->ops[i] != 0)
+			extra += print_op_throughput(i, results, runtime);
+	if (extra)
+		printf("\n");
+
 	if (results->write_bytes || results->read_bytes)
 		printf("Throughput Results\n===================\n");
 	if (results->read_bytes) {
@@ -127,6 +177,60 @@ void print_results(struct ffsb_op_results *results, double runtime)
 		ffsb_printsize(buf, results->write_bytes / runtime, 256);
 		printf("Write Throughput: %s/sec\n", buf);
 	}
+	if (results->verify_blocks)
+		printf("Verified %llu blocks, %llu errors\n",
+		       (unsigned long long)results->verify_blocks,
+		       (unsigned long long)results->verify_errors);
+	if (results->arrival_response.count) {
+		printf("Open loop: %llu ops, %llu arrivals still queued at "
+		       "the end\n",
+		       (unsigned long long)results->arrival_response.count,
+		       (unsigned long long)results->arrival_pending);
+		print_arrival_hist("response (from due)",
+				   &results->arrival_response);
+		print_arrival_hist("service", &results->arrival_service);
+		print_arrival_hist("start lag", &results->arrival_lag);
+	}
+	if (results->throttle_usec)
+		printf("Throttled: %.2lf sec held back by the rate limits\n",
+		       results->throttle_usec / 1000000.0);
+	if (results->bursts) {
+		double secs = results->burst_usec / 1000000.0;
+
+		printf("Bursts: %llu, avg %.3lf sec on, %.1lf ops/sec and "
+		       "%s/sec while on%s\n",
+		       (unsigned long long)results->bursts,
+		       secs / results->bursts, results->burst_ops / secs,
+		       ffsb_printsize(buf, results->burst_bytes / secs, 256),
+		       results->burst_threads ? " (per thread)" : "");
+		print_arrival_hist("op latency", &results->burst_lat);
+		print_arrival_hist("drain", &results->burst_drain);
+		if (results->burst_recover.count)
+			print_arrival_hist("dirty recovery",
+					   &results->burst_recover);
+		if (results->burst_unrecovered)
+			printf("  %llu bursts hadn't recovered when the next "
+			       "began\n",
+			       (unsigned long long)results->burst_unrecovered);
+	}
+	if (results->think_actual.count) {
+		ffsb_hist_t *h = &results->think_actual;
+		double requested = (double)results->think_requested_usec /
+			h->count;
+
+		printf("Think time: %llu waits, requested avg %.1lf usec, "
+		       "actual avg %.1lf usec",
+		       (unsigned long long)h->count, requested,
+		       ffsb_hist_mean(h));
+		if (requested)
+			printf(" (%+.1lf%%)",
+			       100.0 * (ffsb_hist_mean(h) - requested) /
+			       requested);
+		printf(", overshoot p99 %llu max %llu usec\n",
+		       (unsigned long long)
+		       ffsb_hist_percentile(&results->think_over, 99.0),
+		       (unsigned long long)results->think_over.max);
+	}
 }
 
 
@@ -161,14 +265,54 @@ int ops_find_op(char *opname)
 
 void add_results(struct ffsb_op_results *target, struct ffsb_op_results *src)
 {
-	int i;
+	int i, j;
 	target->read_bytes += src->read_bytes;
 	target->write_bytes += src->write_bytes;
+	target->scan_files += src->scan_files;
+	target->scan_dirs += src->scan_dirs;
+	target->scan_usec += src->scan_usec;
+	target->lsm_compact_usec += src->lsm_compact_usec;
+	ffsb_hist_merge(&target->lsm_get_lat, &src->lsm_get_lat);
+	target->checkpoint_usec += src->checkpoint_usec;
+	for (i = 0; i < 2; i++)
+		for (j = 0; j < 2; j++)
+			ffsb_hist_merge(&target->page_lat[i][j],
+					&src->page_lat[i][j]);
+	for (i = 0; i < 3; i++)
+		ffsb_hist_merge(&target->obj_lat[i], &src->obj_lat[i]);
+	for (i = 0; i < 2; i++)
+		ffsb_hist_merge(&target->stream_late[i],
+				&src->stream_late[i]);
+	target->replay_errors += src->replay_errors;
+	target->replay_done += src->replay_done;
+	if (src->replay_done_usec > target->replay_done_usec)
+		target->replay_done_usec = src->replay_done_usec;
+	target->think_requested_usec += src->think_requested_usec;
+	ffsb_hist_merge(&target->think_actual, &src->think_actual);
+	ffsb_hist_merge(&target->think_over, &src->think_over);
+	ffsb_hist_merge(&target->arrival_response, &src->arrival_response);
+	ffsb_hist_merge(&target->arrival_service, &src->arrival_service);
+	ffsb_hist_merge(&target->arrival_lag, &src->arrival_lag);
+	target->arrival_pending += src->arrival_pending;
+	target->throttle_usec += src->throttle_usec;
+	target->bursts += src->bursts;
+	target->burst_usec += src->burst_usec;
+	target->burst_ops += src->burst_ops;
+	target->burst_bytes += src->burst_bytes;
+	target->burst_threads += src->burst_threads;
+	ffsb_hist_merge(&target->burst_lat, &src->burst_lat);
+	ffsb_hist_merge(&target->burst_drain, &src->burst_drain);
+	ffsb_hist_merge(&target->burst_recover, &src->burst_recover);
+	target->burst_unrecovered += src->burst_unrecovered;
+	target->verify_blocks += src->verify_blocks;
+	target->verify_errors += src->verify_errors;
 
 	for (i = 0; i < FFSB_NUMOPS; i++) {
 		target->ops[i] += src->ops[i];
 		target->op_weight[i] += src->op_weight[i];
 		target->bytes[i] += src->bytes[i];
+		target->lock_contended[i] += src->lock_contended[i];
+		target->lock_wait_usec[i] += src->lock_wait_usec[i];
 	}
 }
 
@@ -22,6 +22,8 @@
 #include <sys/types.h>
 #include <inttypes.h>
 
+#include "ffsb_hist.h"
+
 struct ffsb_op_results;
 struct ffsb_thread;
 struct ffsb_fs;
@@ -59,6 +61,9 @@ typedef struct ffsb_op {
 	 */
 	ffsb_op_fs_fn op_bench;
 	ffsb_op_fs_fn op_age;
+
+	/* Optional, prints op specific results after the main table */
+	ffsb_op_print_fn op_exl_print_fn;
 } ffsb_op_t;
 
 /* List of all operations, located in ffsb_op.c */
@@ -67,7 +72,7 @@ extern ffsb_op_t ffsb_op_list[];
 /* This *must* be updated when a new operation is added or one is
  * removed several other structures use it for statically sized arrays
  */
-#define FFSB_NUMOPS (15)
+#define FFSB_NUMOPS (34)
 
 /* Returns index of an op.
  * Returns -1 if opname isn't found, and its case sensitive :)
@@ -82,6 +87,86 @@ typedef struct ffsb_op_results {
 
 	uint64_t read_bytes;
 	uint64_t write_bytes;
+
+	/* Lock ops: how many acquisitions had to wait for another
+	 * holder, and the total time spent acquiring, in usecs
+	 */
+	uint64_t lock_contended[FFSB_NUMOPS];
+	uint64_t lock_wait_usec[FFSB_NUMOPS];
+
+	/* Scan op: entries visited and total time spent walking */
+	uint64_t scan_files;
+	uint64_t scan_dirs;
+	uint64_t scan_usec;
+
+	/* LSM ops: time spent compacting, in usecs, and lookup latency */
+	uint64_t lsm_compact_usec;
+	ffsb_hist_t lsm_get_lat;
+
+	/* Page ops: read [0] and write [1] latency, outside [0] and
+	 * during [1] checkpoints, and time spent checkpointing
+	 */
+	ffsb_hist_t page_lat[2][2];
+	uint64_t checkpoint_usec;
+
+	/* Object ops: put [0], get [1] and delete [2] latency */
+	ffsb_hist_t obj_lat[3];
+
+	/* Stream ops: how late each chunk that missed its deadline
+	 * was, for reads [0] and writes [1]
+	 */
+	ffsb_hist_t stream_late[2];
+
+	/* Replay op: calls that failed, threads that got to the end of
+	 * their trace and when the last one did, in usecs
+	 */
+	uint64_t replay_errors;
+	unsigned replay_done;
+	uint64_t replay_done_usec;
+
+	/* Think time: what was asked for in total, how long each wait
+	 * really took and by how much it overshot, in usecs
+	 */
+	uint64_t think_requested_usec;
+	ffsb_hist_t think_actual;
+	ffsb_hist_t think_over;
+
+	/* Open loop: time from when each op was due to when it
+	 * finished, from when it really started to when it finished,
+	 * and how late it started, in usecs.  Plus arrivals that were
+	 * due by the end but never started.
+	 */
+	ffsb_hist_t arrival_response;
+	ffsb_hist_t arrival_service;
+	ffsb_hist_t arrival_lag;
+	uint64_t arrival_pending;
+
+	/* Time spent held back by the tg's ops and bandwidth limits,
+	 * in usecs
+	 */
+	uint64_t throttle_usec;
+
+	/* Bursts: how many ran to the end, their total length in usecs
+	 * and the ops and bytes done in them.  burst_threads is how
+	 * many threads kept their own phase, 0 if they burst together.
+	 * Latency of the ops, and time from the end of each burst to
+	 * its last op finishing and to dirty memory getting back to
+	 * where it was when it began, in usecs.  Plus bursts that
+	 * hadn't recovered by the time the next one started.
+	 */
+	uint64_t bursts;
+	uint64_t burst_usec;
+	uint64_t burst_ops;
+	uint64_t burst_bytes;
+	unsigned burst_threads;
+	ffsb_hist_t burst_lat;
+	ffsb_hist_t burst_drain;
+	ffsb_hist_t burst_recover;
+	uint64_t burst_unrecovered;
+
+	/* verify mode: blocks checked on read, and how many were bad */
+	uint64_t verify_blocks;
+	uint64_t verify_errors;
 } ffsb_op_results_t;
 
 void init_ffsb_op_results(struct ffsb_op_results *);
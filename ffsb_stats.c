@@ -13,6 +13,13 @@ char *syscall_names[] = {
 	"unlink",
 	"close",
 	"stat",
+	"link",
+	"lock",
+	"fdatasync",
+	"rmw",
+	"fsync",
+	"rename",
+	"mkdir",
 };
 
 /* yuck, just for the parser anyway.. */
@@ -47,7 +47,14 @@ typedef enum { SYS_OPEN = 0,
 	       SYS_LSEEK,
 	       SYS_UNLINK,
 	       SYS_CLOSE,
-	       SYS_STAT
+	       SYS_STAT,
+	       SYS_LINK,
+	       SYS_LOCK,
+	       SYS_FDATASYNC,
+	       SYS_RMW,
+	       SYS_FSYNC,
+	       SYS_RENAME,
+	       SYS_MKDIR
 } syscall_t;
 
 /* ASCII versions of the syscall names */
@@ -57,7 +64,7 @@ extern char *syscall_names[];
 int ffsb_stats_str2syscall(char *, syscall_t *);
 
 /* Keep it in sync with syscall_t */
-#define FFSB_NUM_SYSCALLS (8UL)
+#define FFSB_NUM_SYSCALLS (15UL)
 
 /* What stats to collect, shared among all threads  */
 typedef struct ffsb_stats_config {
@@ -16,12 +16,19 @@
  *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
  */
 #include <string.h>
+#include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
 #include <pthread.h>
+#include <math.h>
 
 #include "ffsb_tg.h"
 #include "util.h"
+#include "replayops.h"
+#include "oplog.h"
+#include "schedule.h"
+#include "burst.h"
+#include "ramp.h"
 
 void init_ffsb_tg(ffsb_tg_t *tg, unsigned num_threads, unsigned tg_num)
 {
@@ -33,6 +40,8 @@ void init_ffsb_tg(ffsb_tg_t *tg, unsigned num_threads, unsigned tg_num)
 	tg->num_threads = num_threads;
 
 	tg->bindfs = -1; /* default is not bound */
+	pthread_mutex_init(&tg->active_lock, NULL);
+	pthread_cond_init(&tg->active_cond, NULL);
 
 	tg->thread_bufsize = 0;
 	for (i = 0 ; i < num_threads ; i++)
@@ -45,8 +54,22 @@ void destroy_ffsb_tg(ffsb_tg_t *tg)
 	for (i = 0; i < tg->num_threads; i++)
 		destroy_ffsb_thread(tg->threads + i);
 	free(tg->threads);
+	pthread_cond_destroy(&tg->active_cond);
+	pthread_mutex_destroy(&tg->active_lock);
+	if (tg->replay)
+		replay_free(tg->replay);
+	if (tg->schedule)
+		schedule_free(tg->schedule);
+	if (tg->burst)
+		burst_free(tg->burst);
+	if (tg->ramp)
+		ramp_free(tg->ramp);
+	free(tg->think.samples);
+	free(tg->think.path);
 	if (tg_needs_stats(tg))
 		ffsb_statsc_destroy(&tg->fsc);
+	if (tg->arrival_rate)
+		pthread_mutex_destroy(&tg->arrival_lock);
 }
 
 void *tg_run(void *data)
@@ -69,6 +92,9 @@ void *tg_run(void *data)
 	tg->fc = params->fc;
 	tg->flagval = -1;
 	tg->stopval = 1;
+	tg->active_threads = tg->num_threads;
+	if (tg->ramp)
+		tg->active_threads = min(tg->ramp->start, tg->num_threads);
 
 	/* spawn threads */
 	for (i = 0; i < tg->num_threads; i++) {
@@ -79,13 +105,33 @@ void *tg_run(void *data)
 	if (params->tg_barrier)
 		ffsb_barrier_wait(params->tg_barrier);
 
+	if (tg->schedule)
+		schedule_start(tg->schedule, tg);
+	if (tg->burst)
+		burst_start(tg->burst, tg);
+	if (tg->ramp)
+		ramp_start(tg->ramp, tg);
+
 	/* wait for termination condition to be true */
 	do {
-		ffsb_sleep(params->wait_time);
+		if (params->wait_time)
+			ffsb_sleep(params->wait_time);
+		else
+			ffsb_milli_sleep(FFSB_TG_POLL_MSEC);
 	} while (params->poll_fn(params->poll_data) == 0);
 
-	/* set flag value */
+	/* set flag value, and wake the parked threads to see it */
+	pthread_mutex_lock(&tg->active_lock);
 	tg->flagval = tg->stopval;
+	pthread_cond_broadcast(&tg->active_cond);
+	pthread_mutex_unlock(&tg->active_lock);
+
+	if (tg->schedule)
+		schedule_stop(tg->schedule);
+	if (tg->burst)
+		burst_stop(tg->burst);
+	if (tg->ramp)
+		ramp_stop(tg->ramp);
 
 	/* wait on theads to finish */
 	for (i = 0; i < tg->num_threads; i++)
@@ -97,15 +143,44 @@ void *tg_run(void *data)
 /* Needs to set params->opnum and params->fs */
 void tg_get_op(ffsb_tg_t *tg, randdata_t *rd, tg_op_params_t *params)
 {
-	unsigned curop;
+	struct oplog *log = rd->log;
+	struct sched_weights *sw;
+	unsigned *weights;
+	unsigned curop, sum;
 	int num;
 	int fsnum;
 
-	num = 1 + getrandom(rd, tg->sum_weights);
+	/* The op and fs are logged as such, not as the numbers that
+	 * picked them
+	 */
+	if (oplog_replaying(log)) {
+		curop = oplog_get(log, OPLOG_OP);
+		fsnum = oplog_get(log, OPLOG_FS);
+		if (curop >= FFSB_NUMOPS || fsnum >= tg->fc->num_filesys) {
+			printf("Error: oplog doesn't match this profile\n");
+			exit(1);
+		}
+		params->opnum = curop;
+		params->fs = fc_get_fs(tg->fc, fsnum);
+		return;
+	}
+	rd->log = NULL;
+
+	/* a schedule may swap the weights at any time */
+	sw = tg->sched_weights;
+	if (sw) {
+		weights = sw->weights;
+		sum = sw->sum;
+	} else {
+		weights = tg->op_weights;
+		sum = tg->sum_weights;
+	}
+
+	num = 1 + getrandom(rd, sum);
 	curop = 0;
 
-	while (tg->op_weights[curop] < num) {
-		num -= tg->op_weights[curop];
+	while (weights[curop] < num) {
+		num -= weights[curop];
 		curop++;
 	}
 
@@ -119,6 +194,10 @@ void tg_get_op(ffsb_tg_t *tg, randdata_t *rd, tg_op_params_t *params)
 		fsnum = getrandom(rd, tg->fc->num_filesys);
 
 	params->fs = fc_get_fs(tg->fc, fsnum);
+
+	rd->log = log;
+	oplog_put(log, OPLOG_OP, curop);
+	oplog_put(log, OPLOG_FS, fsnum);
 }
 
 void tg_set_op_weight(ffsb_tg_t *tg, char *opname, unsigned weight)
@@ -150,11 +229,21 @@ unsigned tg_get_numthreads(ffsb_tg_t *tg)
 	return tg->num_threads;
 }
 
+unsigned tg_get_tgnum(ffsb_tg_t *tg)
+{
+	return tg->tg_num;
+}
+
 static void update_bufsize(ffsb_tg_t *tg)
 {
 	int i;
 	uint32_t newmax = max(tg->read_blocksize, tg->write_blocksize);
 
+	newmax = max(newmax, tg->rmw_recordsize);
+	newmax = max(newmax, tg->page_size);
+	if (tg->replay)
+		newmax = max(newmax, replay_max_iosize(tg->replay));
+
 	if (newmax == max(newmax, tg->thread_bufsize))
 		for (i = 0; i < tg->num_threads ; i++)
 			ft_alter_bufsize(tg->threads + i, newmax);
@@ -252,6 +341,316 @@ uint32_t tg_get_write_blocksize(ffsb_tg_t *tg)
 	return tg->write_blocksize;
 }
 
+void tg_set_lock_range_size(ffsb_tg_t *tg, uint64_t size)
+{
+	tg->lock_range_size = size;
+}
+
+void tg_set_lock_overlap(ffsb_tg_t *tg, uint32_t percent)
+{
+	tg->lock_overlap = percent;
+}
+
+void tg_set_lock_write_percent(ffsb_tg_t *tg, uint32_t percent)
+{
+	tg->lock_write_percent = percent;
+}
+
+void tg_set_lock_io(ffsb_tg_t *tg, int lock_io)
+{
+	tg->lock_io = lock_io;
+}
+
+uint64_t tg_get_lock_range_size(ffsb_tg_t *tg)
+{
+	return tg->lock_range_size;
+}
+
+uint32_t tg_get_lock_overlap(ffsb_tg_t *tg)
+{
+	return tg->lock_overlap;
+}
+
+uint32_t tg_get_lock_write_percent(ffsb_tg_t *tg)
+{
+	return tg->lock_write_percent;
+}
+
+int tg_get_lock_io(ffsb_tg_t *tg)
+{
+	return tg->lock_io;
+}
+
+void tg_set_rmw_recordsize(ffsb_tg_t *tg, uint32_t size)
+{
+	tg->rmw_recordsize = size;
+	update_bufsize(tg);
+}
+
+void tg_set_rmw_records(ffsb_tg_t *tg, uint32_t records)
+{
+	tg->rmw_records = records;
+}
+
+uint32_t tg_get_rmw_recordsize(ffsb_tg_t *tg)
+{
+	return tg->rmw_recordsize;
+}
+
+uint32_t tg_get_rmw_records(ffsb_tg_t *tg)
+{
+	return tg->rmw_records;
+}
+
+void tg_set_scan_threads(ffsb_tg_t *tg, uint32_t threads)
+{
+	tg->scan_threads = threads;
+}
+
+uint32_t tg_get_scan_threads(ffsb_tg_t *tg)
+{
+	return tg->scan_threads;
+}
+
+void tg_set_page_size(ffsb_tg_t *tg, uint32_t size)
+{
+	tg->page_size = size;
+	update_bufsize(tg);
+}
+
+uint32_t tg_get_page_size(ffsb_tg_t *tg)
+{
+	return tg->page_size;
+}
+
+void tg_set_stream_rate(ffsb_tg_t *tg, uint64_t rate)
+{
+	tg->stream_rate = rate;
+}
+
+uint64_t tg_get_stream_rate(ffsb_tg_t *tg)
+{
+	return tg->stream_rate;
+}
+
+void tg_set_replay(ffsb_tg_t *tg, struct replay_trace *rt)
+{
+	tg->replay = rt;
+	update_bufsize(tg);
+}
+
+void tg_set_offsets(ffsb_tg_t *tg, ffsb_offsets_t *read,
+		    ffsb_offsets_t *write)
+{
+	int i;
+
+	tg->read_offsets = *read;
+	tg->write_offsets = *write;
+	for (i = 0; i < tg->num_threads; i++) {
+		tg->threads[i].read_offsets = *read;
+		tg->threads[i].write_offsets = *write;
+	}
+}
+
+struct replay_trace *tg_get_replay(ffsb_tg_t *tg)
+{
+	return tg->replay;
+}
+
+ffsb_sizedist_t *tg_get_sizedist(ffsb_tg_t *tg, int which)
+{
+	return &tg->size_dists[which];
+}
+
+void tg_set_arrivals(ffsb_tg_t *tg, double rate, int poisson)
+{
+	tg->arrival_rate = rate;
+	tg->arrival_poisson = poisson;
+	pthread_mutex_init(&tg->arrival_lock, NULL);
+}
+
+double tg_get_arrival_rate(ffsb_tg_t *tg)
+{
+	return tg->arrival_rate;
+}
+
+static uint64_t arrival_gap(ffsb_tg_t *tg, randdata_t *rd)
+{
+	double mean = 1000000000.0 / tg->arrival_rate;
+
+	if (tg->arrival_poisson)
+		return -mean * log(1.0 - getdrandom(rd));
+	return mean;
+}
+
+uint64_t tg_next_arrival(ffsb_tg_t *tg, randdata_t *rd)
+{
+	uint64_t ret;
+
+	pthread_mutex_lock(&tg->arrival_lock);
+	if (!tg->arrival_next)
+		tg->arrival_next = ffsb_clock_nsec();
+	ret = tg->arrival_next;
+	tg->arrival_next += arrival_gap(tg, rd);
+	pthread_mutex_unlock(&tg->arrival_lock);
+	return ret;
+}
+
+uint64_t tg_arrivals_pending(ffsb_tg_t *tg, randdata_t *rd)
+{
+	uint64_t now = ffsb_clock_nsec();
+	uint64_t count = 0;
+	struct oplog *log = rd->log;
+
+	/* not part of the op stream, keep it out of the oplog */
+	rd->log = NULL;
+	pthread_mutex_lock(&tg->arrival_lock);
+	while (tg->arrival_next && tg->arrival_next <= now) {
+		tg->arrival_next += arrival_gap(tg, rd);
+		count++;
+	}
+	pthread_mutex_unlock(&tg->arrival_lock);
+	rd->log = log;
+	return count;
+}
+
+void tg_set_limit(ffsb_tg_t *tg, int which, double rate, uint64_t burst_nsec)
+{
+	ffsb_bucket_init(&tg->limits[which], rate, burst_nsec);
+	if (rate)
+		tg->limited = 1;
+}
+
+ffsb_bucket_t *tg_get_limit(ffsb_tg_t *tg, int which)
+{
+	return &tg->limits[which];
+}
+
+int tg_is_limited(ffsb_tg_t *tg)
+{
+	return tg->limited;
+}
+
+void tg_add_op_io(ffsb_tg_t *tg, unsigned opnum, unsigned io)
+{
+	if ((tg->op_io[opnum] & io) != io)
+		__sync_fetch_and_or(&tg->op_io[opnum], io);
+}
+
+unsigned tg_get_op_io(ffsb_tg_t *tg, unsigned opnum)
+{
+	return tg->op_io[opnum];
+}
+
+void tg_set_schedule(ffsb_tg_t *tg, struct schedule *s)
+{
+	unsigned i;
+
+	tg->schedule = s;
+
+	/* a scheduled rate needs the ops limit to steer */
+	for (i = 0; i < s->num_segs; i++)
+		if (s->segs[i].rate && !tg->arrival_rate)
+			tg->limited = 1;
+}
+
+struct schedule *tg_get_schedule(ffsb_tg_t *tg)
+{
+	return tg->schedule;
+}
+
+void tg_set_active_threads(ffsb_tg_t *tg, unsigned threads)
+{
+	pthread_mutex_lock(&tg->active_lock);
+	tg->active_threads = threads;
+	pthread_cond_broadcast(&tg->active_cond);
+	pthread_mutex_unlock(&tg->active_lock);
+}
+
+unsigned tg_get_active_threads(ffsb_tg_t *tg)
+{
+	return tg->active_threads;
+}
+
+int tg_wait_active(ffsb_tg_t *tg, unsigned thread_num)
+{
+	int ret;
+
+	pthread_mutex_lock(&tg->active_lock);
+	while (thread_num >= tg->active_threads &&
+	       tg->flagval != tg->stopval)
+		pthread_cond_wait(&tg->active_cond, &tg->active_lock);
+	ret = (tg->flagval != tg->stopval);
+	pthread_mutex_unlock(&tg->active_lock);
+	return ret;
+}
+
+void tg_set_sched_weights(ffsb_tg_t *tg, struct sched_weights *w)
+{
+	tg->sched_weights = w;
+}
+
+void tg_set_sched_rate(ffsb_tg_t *tg, double rate)
+{
+	if (tg->arrival_rate) {
+		pthread_mutex_lock(&tg->arrival_lock);
+		tg->arrival_rate = rate;
+		pthread_mutex_unlock(&tg->arrival_lock);
+	} else
+		tg->limits[FFSB_LIMIT_OPS].rate = rate;
+}
+
+double tg_get_sched_rate(ffsb_tg_t *tg)
+{
+	if (tg->arrival_rate)
+		return tg->arrival_rate;
+	return tg->limits[FFSB_LIMIT_OPS].rate;
+}
+
+void tg_set_burst(ffsb_tg_t *tg, struct burst *b)
+{
+	tg->burst = b;
+}
+
+struct burst *tg_get_burst(ffsb_tg_t *tg)
+{
+	return tg->burst;
+}
+
+void tg_set_ramp(ffsb_tg_t *tg, struct ramp *r)
+{
+	tg->ramp = r;
+}
+
+struct ramp *tg_get_ramp(ffsb_tg_t *tg)
+{
+	return tg->ramp;
+}
+
+void tg_set_thinktime(ffsb_tg_t *tg, ffsb_thinktime_t *tt)
+{
+	tg->think = *tt;
+}
+
+ffsb_thinktime_t *tg_get_thinktime(ffsb_tg_t *tg)
+{
+	return &tg->think;
+}
+
+void tg_set_file_popularity(ffsb_tg_t *tg, ffsb_popularity_t *pop)
+{
+	int i;
+
+	tg->file_pop = *pop;
+	for (i = 0; i < tg->num_threads; i++) {
+		ffsb_thread_t *ft = tg->threads + i;
+
+		ft->file_pop = *pop;
+		if (pop->type != FFSB_POP_UNIFORM)
+			ft_get_randdata(ft)->pop = &ft->file_pop;
+	}
+}
+
 int tg_get_stopval(ffsb_tg_t *tg)
 {
 	return tg->stopval;
@@ -286,6 +685,92 @@ static void tg_print_config_helper(ffsb_tg_t *tg)
 	printf("\t write_blocksize  = %u\t(%s)\n", tg->write_blocksize,
 	       ffsb_printsize(buf, tg->write_blocksize, 256));
 	printf("\t wait time        = %u\n", tg->wait_time);
+	if (tg->think.type != FFSB_THINK_NONE)
+		ffsb_thinktime_print(&tg->think);
+	if (tg->arrival_rate)
+		printf("\t arrivals         = %.2lf/sec, %s\n",
+		       tg->arrival_rate,
+		       tg->arrival_poisson ? "poisson" : "constant");
+	if (tg->limits[FFSB_LIMIT_OPS].rate)
+		printf("\t ops_limit        = %.2lf/sec\n",
+		       tg->limits[FFSB_LIMIT_OPS].rate);
+	if (tg->limits[FFSB_LIMIT_READ].rate)
+		printf("\t read_bw_limit    = %s/sec\n",
+		       ffsb_printsize(buf, tg->limits[FFSB_LIMIT_READ].rate,
+				      256));
+	if (tg->limits[FFSB_LIMIT_WRITE].rate)
+		printf("\t write_bw_limit   = %s/sec\n",
+		       ffsb_printsize(buf, tg->limits[FFSB_LIMIT_WRITE].rate,
+				      256));
+	if (tg->limited)
+		printf("\t limit_burst      = %.3lf msec\n",
+		       tg->limits[FFSB_LIMIT_OPS].burst / 1000000.0);
+	if (tg->burst)
+		burst_print_config(tg->burst);
+	if (tg->ramp)
+		ramp_print_config(tg->ramp);
+	if (tg->op_weights[ops_find_op("lock")] ||
+	    tg->op_weights[ops_find_op("flock")]) {
+		printf("\t\n");
+		printf("\t lock_range_size  = %llu\t(%s)\n",
+		       (unsigned long long)tg->lock_range_size,
+		       ffsb_printsize(buf, tg->lock_range_size, 256));
+		printf("\t lock_overlap     = %u%%\n", tg->lock_overlap);
+		printf("\t lock_write_pct   = %u%%\n", tg->lock_write_percent);
+		printf("\t lock_io          = %s\n",
+		       (tg->lock_io) ? "on" : "off");
+	}
+	if (tg->op_weights[ops_find_op("rmw")] ||
+	    tg->op_weights[ops_find_op("rmw_fdatasync")]) {
+		printf("\t\n");
+		printf("\t rmw_recordsize   = %u\t(%s)\n", tg->rmw_recordsize,
+		       ffsb_printsize(buf, tg->rmw_recordsize, 256));
+		printf("\t rmw_records      = %u\n", tg->rmw_records);
+	}
+	if (tg->op_weights[ops_find_op("scan")]) {
+		printf("\t\n");
+		printf("\t scan_threads     = %u\n", tg->scan_threads);
+	}
+	if (tg->op_weights[ops_find_op("page_read")] ||
+	    tg->op_weights[ops_find_op("page_write")]) {
+		printf("\t\n");
+		printf("\t page_size        = %u\t(%s)\n", tg->page_size,
+		       ffsb_printsize(buf, tg->page_size, 256));
+	}
+	if (tg->op_weights[ops_find_op("stream_read")] ||
+	    tg->op_weights[ops_find_op("stream_write")]) {
+		printf("\t\n");
+		printf("\t stream_rate      = %llu\t(%s/sec)\n",
+		       (unsigned long long)tg->stream_rate,
+		       ffsb_printsize(buf, tg->stream_rate, 256));
+	}
+	if (tg->replay) {
+		printf("\t\n");
+		replay_print_config(tg->replay);
+	}
+	if (tg->file_pop.type != FFSB_POP_UNIFORM) {
+		printf("\t\n");
+		ffsb_popularity_print(&tg->file_pop);
+	}
+	if (tg->read_offsets.type != FFSB_OFF_DEFAULT ||
+	    tg->write_offsets.type != FFSB_OFF_DEFAULT) {
+		printf("\t\n");
+		ffsb_offsets_print("read_offsets", &tg->read_offsets);
+		ffsb_offsets_print("write_offsets", &tg->write_offsets);
+	}
+	for (i = 0; i < FFSB_NUM_SIZEDISTS; i++) {
+		static char *names[] = { "read_size", "read_blocksize",
+					 "write_size", "write_blocksize" };
+
+		if (tg->size_dists[i].type == FFSB_SIZE_FIXED)
+			continue;
+		printf("\t\n");
+		ffsb_sizedist_print(names[i], &tg->size_dists[i]);
+	}
+	if (tg->schedule) {
+		printf("\t\n");
+		schedule_print_config(tg->schedule);
+	}
 	if (tg->bindfs >= 0) {
 		printf("\t\n");
 		printf("\t bound to fs %d\n", tg->bindfs);
@@ -322,6 +807,8 @@ void tg_collect_results(ffsb_tg_t *tg, ffsb_op_results_t *r)
 	int i;
 	for (i = 0; i < tg_get_numthreads(tg); i++)
 		add_results(r, ft_get_results(tg->threads + i));
+	if (tg->burst)
+		add_results(r, tg->burst->results);
 }
 
 void tg_set_waittime(ffsb_tg_t *tg, unsigned time)
@@ -334,11 +821,57 @@ unsigned tg_get_waittime(ffsb_tg_t *tg)
 	return tg->wait_time;
 }
 
+void tg_set_window(ffsb_tg_t *tg, int window)
+{
+	tg->window = window;
+}
+
+int tg_get_window(ffsb_tg_t *tg)
+{
+	return tg->window;
+}
+
+void tg_add_progress(ffsb_tg_t *tg, uint64_t *ops, uint64_t *bytes)
+{
+	int i;
+
+	for (i = 0; i < tg->num_threads; i++)
+		ft_add_progress(tg->threads + i, ops, bytes);
+}
+
+void tg_add_done(ffsb_tg_t *tg, uint64_t *ops, uint64_t *nsec)
+{
+	int i;
+
+	for (i = 0; i < tg->num_threads; i++)
+		ft_add_done(tg->threads + i, ops, nsec);
+}
+
+void tg_add_ramp_lat(ffsb_tg_t *tg, ffsb_hist_t *lat)
+{
+	int i;
+
+	for (i = 0; i < tg->num_threads; i++)
+		ft_add_ramp_lat(tg->threads + i, lat);
+}
+
 int tg_get_flagval(ffsb_tg_t *tg)
 {
 	return tg->flagval;
 }
 
+int tg_wait_until(ffsb_tg_t *tg, uint64_t due)
+{
+	uint64_t now;
+
+	while ((now = ffsb_clock_nsec()) < due) {
+		if (tg->flagval == tg->stopval)
+			return 0;
+		ffsb_sleep_until(min(due, now + 100000000ULL));
+	}
+	return 1;
+}
+
 void tg_set_statsc(ffsb_tg_t *tg, ffsb_statsc_t *fsc)
 {
 	if (fsc) {
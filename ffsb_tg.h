@@ -28,6 +28,8 @@
 #include "ffsb_thread.h"
 #include "ffsb_fs.h"
 #include "ffsb_stats.h"
+#include "ffsb_dist.h"
+#include "ffsb_bucket.h"
 
 #include "util.h" /* for barrier obj */
 
@@ -57,6 +59,32 @@
 
 struct ffsb_thread;
 struct ffsb_config;
+struct replay_trace;
+#define FFSB_TG_POLL_MSEC	10
+
+#define FFSB_WINDOW_MEASURE	0
+#define FFSB_WINDOW_WARMUP	1
+#define FFSB_WINDOW_COOLDOWN	2
+
+struct schedule;
+struct sched_weights;
+struct burst;
+struct ramp;
+
+#define FFSB_TG_DEFAULT_LOCK_RANGE_SIZE 4096
+
+/* Which of the tg's size distributions */
+#define FFSB_READ_SIZE		0
+#define FFSB_READ_BLOCKSIZE	1
+#define FFSB_WRITE_SIZE		2
+#define FFSB_WRITE_BLOCKSIZE	3
+#define FFSB_NUM_SIZEDISTS	4
+
+/* The tg's rate limits, ops/sec and read and write bytes/sec */
+#define FFSB_LIMIT_OPS		0
+#define FFSB_LIMIT_READ		1
+#define FFSB_LIMIT_WRITE	2
+#define FFSB_NUM_LIMITS		3
 
 typedef struct ffsb_tg {
 	unsigned tg_num;
@@ -82,6 +110,45 @@ typedef struct ffsb_tg {
 
 	int fsync_file;		/* boolean */
 
+	/* lock and flock ops */
+	uint64_t lock_range_size;
+	uint32_t lock_overlap;		/* percent */
+	uint32_t lock_write_percent;
+	int lock_io;			/* boolean */
+
+	/* rmw ops, records read, modified and written back per op */
+	uint32_t rmw_recordsize;
+	uint32_t rmw_records;
+
+	/* scan op, number of walkers per scan */
+	uint32_t scan_threads;
+
+	/* page ops, size of each page read or written */
+	uint32_t page_size;
+#define FFSB_TG_DEFAULT_PAGE_SIZE 8192
+
+	/* stream ops, bytes/sec each stream is paced at */
+	uint64_t stream_rate;
+
+	/* replay op, the trace whose threads this tg's threads are */
+	struct replay_trace *replay;
+
+	/* how files are picked, see ffsb_dist.h */
+	ffsb_popularity_t file_pop;
+
+	/* where read and write ops put their blocks, see ffsb_dist.h */
+	ffsb_offsets_t read_offsets;
+	ffsb_offsets_t write_offsets;
+
+	/* read_size, read_blocksize, write_size and write_blocksize
+	 * drawn from distributions, the fixed values above are then
+	 * the largest they can draw
+	 */
+	ffsb_sizedist_t size_dists[FFSB_NUM_SIZEDISTS];
+
+	/* wait after each op, op_delay is a fixed one */
+	ffsb_thinktime_t think;
+
 	/* Should be max(write_blocksize, read_blocksize) */
 	uint32_t thread_bufsize;
 
@@ -94,9 +161,48 @@ typedef struct ffsb_tg {
 	int flagval;
 	int stopval;
 
+	/* Which part of the run this is.  Ops that start during the
+	 * warmup or cooldown run as usual but aren't counted.
+	 */
+	volatile int window;
+
 	/* Delay between every operation, in milliseconds*/
 	unsigned wait_time;
 
+	/* Open loop: ops arrive at arrival_rate a second, spaced
+	 * evenly or as a Poisson process, and each free thread takes
+	 * the next one.  arrival_next is when it's due, in nsecs.
+	 */
+	double arrival_rate;
+	int arrival_poisson;
+	pthread_mutex_t arrival_lock;
+	uint64_t arrival_next;
+
+	/* Rate limits shared by all the threads, see ffsb_bucket.h */
+	ffsb_bucket_t limits[FFSB_NUM_LIMITS];
+	int limited;
+
+	/* Whether each op has been seen to read (1) or write (2), so
+	 * it only waits on the bandwidth limits it's held to
+	 */
+	unsigned op_io[FFSB_NUMOPS];
+
+	/* Load schedule, see schedule.h.  Threads numbered from
+	 * active_threads on are parked on active_cond, and
+	 * sched_weights replaces the op weights when it's set.
+	 */
+	struct schedule *schedule;
+	unsigned active_threads;
+	pthread_mutex_t active_lock;
+	pthread_cond_t active_cond;
+	struct sched_weights *sched_weights;
+
+	/* On/off bursts, see burst.h */
+	struct burst *burst;
+
+	/* Thread count ramp, see ramp.h, it also moves active_threads */
+	struct ramp *ramp;
+
 	/* stats configuration */
 	int need_stats;
 	ffsb_statsc_t fsc;
@@ -110,7 +216,8 @@ void destroy_ffsb_tg(ffsb_tg_t *tg);
 
 /* Parameters needed to fire off a thread group.  The main thread will
  * evaluate poll_fn(poll_data) until it gets a nonzero return value.
- * It will sleep for wait_time secs between calls The ffsb_config
+ * It will sleep for wait_time secs between calls, or
+ * FFSB_TG_POLL_MSEC msecs if wait_time is 0.  The ffsb_config
  * struct is needed for fs selection.  Barriers are to synchronize
  * multiple tgs and all threads pt is for pthread_create()
  */
@@ -149,6 +256,7 @@ void tg_set_bindfs(ffsb_tg_t *tg, int fsnum);
 int  tg_get_bindfs(ffsb_tg_t *tg);
 
 unsigned tg_get_numthreads(ffsb_tg_t *tg);
+unsigned tg_get_tgnum(ffsb_tg_t *tg);
 
 void tg_set_op_weight(ffsb_tg_t *tg, char *opname, unsigned weight);
 unsigned tg_get_op_weight(ffsb_tg_t *tg, char *opname);
@@ -179,9 +287,107 @@ uint32_t tg_get_read_skipsize(ffsb_tg_t *tg);
 uint64_t tg_get_write_size(ffsb_tg_t *tg);
 uint32_t tg_get_write_blocksize(ffsb_tg_t *tg);
 
+void tg_set_lock_range_size(ffsb_tg_t *tg, uint64_t size);
+void tg_set_lock_overlap(ffsb_tg_t *tg, uint32_t percent);
+void tg_set_lock_write_percent(ffsb_tg_t *tg, uint32_t percent);
+void tg_set_lock_io(ffsb_tg_t *tg, int lock_io);
+
+uint64_t tg_get_lock_range_size(ffsb_tg_t *tg);
+uint32_t tg_get_lock_overlap(ffsb_tg_t *tg);
+uint32_t tg_get_lock_write_percent(ffsb_tg_t *tg);
+int tg_get_lock_io(ffsb_tg_t *tg);
+
+void tg_set_rmw_recordsize(ffsb_tg_t *tg, uint32_t size);
+void tg_set_rmw_records(ffsb_tg_t *tg, uint32_t records);
+
+uint32_t tg_get_rmw_recordsize(ffsb_tg_t *tg);
+uint32_t tg_get_rmw_records(ffsb_tg_t *tg);
+
+void tg_set_scan_threads(ffsb_tg_t *tg, uint32_t threads);
+uint32_t tg_get_scan_threads(ffsb_tg_t *tg);
+
+void tg_set_page_size(ffsb_tg_t *tg, uint32_t size);
+uint32_t tg_get_page_size(ffsb_tg_t *tg);
+
+void tg_set_stream_rate(ffsb_tg_t *tg, uint64_t rate);
+uint64_t tg_get_stream_rate(ffsb_tg_t *tg);
+
+void tg_set_replay(ffsb_tg_t *tg, struct replay_trace *rt);
+
+void tg_set_file_popularity(ffsb_tg_t *tg, ffsb_popularity_t *pop);
+void tg_set_offsets(ffsb_tg_t *tg, ffsb_offsets_t *read,
+		    ffsb_offsets_t *write);
+struct replay_trace *tg_get_replay(ffsb_tg_t *tg);
+ffsb_sizedist_t *tg_get_sizedist(ffsb_tg_t *tg, int which);
+void tg_set_thinktime(ffsb_tg_t *tg, ffsb_thinktime_t *tt);
+ffsb_thinktime_t *tg_get_thinktime(ffsb_tg_t *tg);
+void tg_set_arrivals(ffsb_tg_t *tg, double rate, int poisson);
+double tg_get_arrival_rate(ffsb_tg_t *tg);
+
+/* Takes the next arrival off the tg's schedule, returns when it was
+ * due to start in nsecs (CLOCK_MONOTONIC)
+ */
+uint64_t tg_next_arrival(ffsb_tg_t *tg, randdata_t *rd);
+
+/* How many arrivals were due by now but never started */
+uint64_t tg_arrivals_pending(ffsb_tg_t *tg, randdata_t *rd);
+
+void tg_set_limit(ffsb_tg_t *tg, int which, double rate, uint64_t burst_nsec);
+ffsb_bucket_t *tg_get_limit(ffsb_tg_t *tg, int which);
+int tg_is_limited(ffsb_tg_t *tg);
+void tg_add_op_io(ffsb_tg_t *tg, unsigned opnum, unsigned io);
+
+void tg_set_schedule(ffsb_tg_t *tg, struct schedule *s);
+struct schedule *tg_get_schedule(ffsb_tg_t *tg);
+void tg_set_active_threads(ffsb_tg_t *tg, unsigned threads);
+unsigned tg_get_active_threads(ffsb_tg_t *tg);
+
+/* Parks thread thread_num until it's one of the active threads.
+ * Returns 0 if the run ended.
+ */
+int tg_wait_active(ffsb_tg_t *tg, unsigned thread_num);
+void tg_set_sched_weights(ffsb_tg_t *tg, struct sched_weights *w);
+
+/* The rate a schedule steers, arrival_rate in open loop and the ops
+ * limit otherwise
+ */
+void tg_set_sched_rate(ffsb_tg_t *tg, double rate);
+double tg_get_sched_rate(ffsb_tg_t *tg);
+unsigned tg_get_op_io(ffsb_tg_t *tg, unsigned opnum);
+void tg_set_burst(ffsb_tg_t *tg, struct burst *b);
+struct burst *tg_get_burst(ffsb_tg_t *tg);
+void tg_set_ramp(ffsb_tg_t *tg, struct ramp *r);
+struct ramp *tg_get_ramp(ffsb_tg_t *tg);
+
 void tg_set_waittime(ffsb_tg_t *tg, unsigned time);
 unsigned tg_get_waittime(ffsb_tg_t *tg);
 
+/* Set by the main thread as the run moves from the warmup to the
+ * measurement and then the cooldown
+ */
+void tg_set_window(ffsb_tg_t *tg, int window);
+int tg_get_window(ffsb_tg_t *tg);
+
+/* Adds up the ops of each kind (FFSB_NUMOPS of them) and the bytes
+ * the threads have done so far in the measurement window
+ */
+void tg_add_progress(ffsb_tg_t *tg, uint64_t *ops, uint64_t *bytes);
+
+/* Adds up the ops the threads have done since the run began and the
+ * nsecs they took, whatever the window
+ */
+void tg_add_done(ffsb_tg_t *tg, uint64_t *ops, uint64_t *nsec);
+
+/* Merges every thread's op latencies since the run began into lat,
+ * when the tg ramps
+ */
+void tg_add_ramp_lat(ffsb_tg_t *tg, ffsb_hist_t *lat);
+
+/* Waits until due (ffsb_clock_nsec() time), a bit at a time so the
+ * end of the run isn't missed.  Returns 0 if the run ended.
+ */
+int tg_wait_until(ffsb_tg_t *tg, uint64_t due);
+
 /* The threads in the tg should be the only ones using these (below)
  * funcs.
  */
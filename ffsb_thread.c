@@ -18,6 +18,8 @@
 #include "ffsb_tg.h"
 #include "ffsb_thread.h"
 #include "ffsb_op.h"
+#include "streamops.h"
+#include "oplog.h"
 #include "util.h"
 
 void init_ffsb_thread(ffsb_thread_t *ft, struct ffsb_tg *tg, unsigned bufsize,
@@ -37,7 +39,12 @@ void init_ffsb_thread(ffsb_thread_t *ft, struct ffsb_tg *tg, unsigned bufsize,
 
 void destroy_ffsb_thread(ffsb_thread_t *ft)
 {
+	int i;
+
+	for (i = 0; i < FFSB_NUMOPS; i++)
+		free(ft->op_data[i]);
 	free(ft->mallocbuf);
+	free(ft->ramp_lat);
 	destroy_random(&ft->rd);
 	if (ft->fsd.config)
 		ffsb_statsd_destroy(&ft->fsd);
@@ -48,20 +55,269 @@ void ft_set_statsc(ffsb_thread_t *ft, ffsb_statsc_t *fsc)
 	ffsb_statsd_init(&ft->fsd, fsc);
 }
 
+/* A helper works for ft on another thread during one op, with its
+ * own buffer, results and stats but no random state.
+ * ft_merge_helper() hands those back to ft and tears the helper down.
+ */
+void ft_init_helper(ffsb_thread_t *helper, ffsb_thread_t *ft,
+		    unsigned bufsize)
+{
+	memset(helper, 0, sizeof(ffsb_thread_t));
+
+	helper->tg = ft->tg;
+	helper->tg_num = ft->tg_num;
+	helper->thread_num = ft->thread_num;
+	helper->window = ft->window;
+
+	ft_alter_bufsize(helper, bufsize);
+	if (ft->fsd.config)
+		ft_set_statsc(helper, ft->fsd.config);
+}
+
+void ft_merge_helper(ffsb_thread_t *ft, ffsb_thread_t *helper)
+{
+	add_results(&ft->results, &helper->results);
+	if (ft->fsd.config)
+		ffsb_statsd_add(&ft->fsd, &helper->fsd);
+
+	/* Paid for with ft's bandwidth limits, once the op is done */
+	ft->io_bytes[0] += helper->io_bytes[0];
+	ft->io_bytes[1] += helper->io_bytes[1];
+	destroy_ffsb_thread(helper);
+}
+
+/* Waits out the think time after an op, against an absolute deadline
+ * so a wakeup that comes early is slept off again, and records how
+ * long the wait really was
+ */
+static void ft_think(ffsb_thread_t *ft, ffsb_thinktime_t *tt)
+{
+	uint64_t usec, start;
+
+	if (tt->type == FFSB_THINK_NONE)
+		return;
+
+	usec = ffsb_thinktime_pick(tt, &ft->rd);
+	start = ffsb_clock_nsec();
+	ffsb_sleep_until(start + usec * 1000);
+	ft_add_think(ft, usec, (ffsb_clock_nsec() - start) / 1000);
+}
+
+/* Holds the thread back while the tg is over the bandwidth limits the
+ * op is held to, then takes it from the ops limit.  Returns 0 if the
+ * run ended.
+ */
+static int ft_throttle(ffsb_thread_t *ft, unsigned opnum)
+{
+	ffsb_tg_t *tg = ft->tg;
+	unsigned io = tg_get_op_io(tg, opnum);
+	uint64_t start = ffsb_clock_nsec();
+	uint64_t due = 0;
+	int ret;
+
+	if (io & 1)
+		due = ffsb_bucket_ready(tg_get_limit(tg, FFSB_LIMIT_READ));
+	if (io & 2)
+		due = max(due, ffsb_bucket_ready(tg_get_limit(tg,
+							FFSB_LIMIT_WRITE)));
+	ret = tg_wait_until(tg, due);
+	if (ret)
+		ret = tg_wait_until(tg, ffsb_bucket_take(tg_get_limit(tg,
+						FFSB_LIMIT_OPS), 1));
+	ft_add_throttle(ft, (ffsb_clock_nsec() - start) / 1000);
+	return ret;
+}
+
+/* Follows the tg into its next window.  The warmup's results are
+ * thrown away once it's over, and the results are put aside when the
+ * cooldown starts so they can be put back at the end.  Ops count
+ * towards the window they started in.
+ */
+static void ft_set_window(ffsb_thread_t *ft, int window)
+{
+	ffsb_statsc_t *fsc = ft->fsd.config;
+
+	if (window == ft->window)
+		return;
+	if (ft->window == FFSB_WINDOW_WARMUP) {
+		init_ffsb_op_results(&ft->results);
+		ft->burst_phase.warmup = 1;
+		if (fsc) {
+			ffsb_statsd_destroy(&ft->fsd);
+			ffsb_statsd_init(&ft->fsd, fsc);
+		}
+	}
+	if (window == FFSB_WINDOW_COOLDOWN) {
+		ft->kept = ffsb_malloc(sizeof(*ft->kept));
+		memcpy(ft->kept, &ft->results, sizeof(*ft->kept));
+	}
+	ft->window = window;
+}
+
+static uint64_t ft_get_ops(ffsb_thread_t *ft)
+{
+	uint64_t ops = 0;
+	int i;
+
+	for (i = 0; i < FFSB_NUMOPS; i++)
+		ops += ft->results.op_weight[i];
+	return ops;
+}
+
+/* Holds the thread back until the tg is in a burst.  When the
+ * threads burst together the op is counted in flight from here, so
+ * the controller can tell when a burst has drained.  Returns 0 if the
+ * run ended.
+ */
+static int ft_burst_wait(ffsb_thread_t *ft, struct burst *b)
+{
+	struct burst_phase *ph = &ft->burst_phase;
+	struct oplog *saved;
+	uint64_t now, due;
+
+	while (!b->independent) {
+		__sync_fetch_and_add(&b->inflight, 1);
+		if (b->on)
+			return 1;
+		__sync_fetch_and_sub(&b->inflight, 1);
+
+		due = b->next_on;
+		now = ffsb_clock_nsec();
+		if (due <= now)
+			due = now + BURST_TICK_NSEC;
+		if (!tg_wait_until(ft->tg, due))
+			return 0;
+	}
+
+	now = ffsb_clock_nsec();
+	if (now >= ph->off) {
+		if (ph->off && !ph->warmup) {
+			ft->results.bursts++;
+			ft->results.burst_usec += (ph->off - ph->on) / 1000;
+			ft->results.burst_ops += ft_get_ops(ft) - ph->ops;
+			ft->results.burst_bytes += ft->results.read_bytes +
+				ft->results.write_bytes - ph->bytes;
+			ft->results.burst_threads = 1;
+			ffsb_hist_add(&ft->results.burst_drain,
+				      (ph->last_end > ph->off) ?
+				      (ph->last_end - ph->off) / 1000 : 0);
+		}
+		if (ph->off) {
+			ph->on = ph->off + burst_length(b, &ft->rd, 0);
+		} else {
+			/* start at a random point in the cycle */
+			saved = ft->rd.log;
+			ft->rd.log = NULL;
+			ph->on = now + getdrandom(&ft->rd) *
+				(b->on_nsec + b->off_nsec);
+			ft->rd.log = saved;
+		}
+		ph->on = max(ph->on, now);
+		ph->off = ph->on + burst_length(b, &ft->rd, 1);
+		ph->warmup = 0;
+		ph->ops = ft_get_ops(ft);
+		ph->bytes = ft->results.read_bytes + ft->results.write_bytes;
+	}
+	return tg_wait_until(ft->tg, ph->on);
+}
+
+/* Times in nsecs */
+static void ft_burst_done(ffsb_thread_t *ft, struct burst *b,
+			  uint64_t start, uint64_t end)
+{
+	ffsb_hist_add(&ft->results.burst_lat, (end - start) / 1000);
+	if (b->independent)
+		ft->burst_phase.last_end = end;
+	else
+		__sync_fetch_and_sub(&b->inflight, 1);
+}
+
 void *ft_run(void *data)
 {
 	ffsb_thread_t *ft = (ffsb_thread_t *)data;
 	tg_op_params_t params;
-	unsigned wait_time = tg_get_waittime(ft->tg);
+	ffsb_thinktime_t *tt = tg_get_thinktime(ft->tg);
+	int open_loop = (tg_get_arrival_rate(ft->tg) > 0);
+	int limited = tg_is_limited(ft->tg);
+	struct burst *burst = tg_get_burst(ft->tg);
 	int stopval = tg_get_stopval(ft->tg);
+	uint64_t due = 0, start, end, io_bytes[2];
 
+	if (tg_get_ramp(ft->tg)) {
+		ft->ramp_lat = ffsb_malloc(sizeof(*ft->ramp_lat));
+		ffsb_hist_init(ft->ramp_lat);
+	}
 	ffsb_barrier_wait(tg_get_start_barrier(ft->tg));
 
 	while (tg_get_flagval(ft->tg) != stopval) {
+		ft_set_window(ft, tg_get_window(ft->tg));
+
+		/* Replayed oplog ran out, idle until the run ends */
+		if (oplog_done(ft->rd.log)) {
+			ffsb_milli_sleep(100);
+			continue;
+		}
+		/* Not needed by the schedule or the ramp just now */
+		if (ft->thread_num >= tg_get_active_threads(ft->tg)) {
+			if (!tg_wait_active(ft->tg, ft->thread_num))
+				break;
+			continue;
+		}
+		if (open_loop) {
+			due = tg_next_arrival(ft->tg, &ft->rd);
+			if (!tg_wait_until(ft->tg, due))
+				break;
+		}
+		if (burst && !ft_burst_wait(ft, burst))
+			break;
 		tg_get_op(ft->tg, &ft->rd, &params);
+		if (limited && !ft_throttle(ft, params.opnum))
+			break;
+
+		start = ffsb_clock_nsec();
+		io_bytes[0] = ft->io_bytes[0];
+		io_bytes[1] = ft->io_bytes[1];
 		do_op(ft, params.fs, params.opnum);
-		ffsb_milli_sleep(wait_time);
+		end = ffsb_clock_nsec();
+		ft->done_ops++;
+		ft->done_nsec += end - start;
+		if (ft->ramp_lat)
+			ffsb_hist_add(ft->ramp_lat, (end - start) / 1000);
+		if (burst)
+			ft_burst_done(ft, burst, start, end);
+
+		/* bytes are only known afterwards, they're paid for by
+		 * the next op held to the same limit
+		 */
+		if (limited) {
+			io_bytes[0] = ft->io_bytes[0] - io_bytes[0];
+			io_bytes[1] = ft->io_bytes[1] - io_bytes[1];
+			tg_add_op_io(ft->tg, params.opnum,
+				     (io_bytes[0] ? 1 : 0) |
+				     (io_bytes[1] ? 2 : 0));
+			ffsb_bucket_charge(tg_get_limit(ft->tg, FFSB_LIMIT_READ),
+					   io_bytes[0]);
+			ffsb_bucket_charge(tg_get_limit(ft->tg,
+							FFSB_LIMIT_WRITE),
+					   io_bytes[1]);
+		}
+		if (open_loop)
+			ft_add_arrival(ft, due, start, end);
+		else
+			ft_think(ft, tt);
+	}
+	ft_set_window(ft, tg_get_window(ft->tg));
+	stream_finish(ft);
+	if (ft->kept) {
+		memcpy(&ft->results, ft->kept, sizeof(ft->results));
+		free(ft->kept);
+		ft->kept = NULL;
 	}
+	if (open_loop && ft->thread_num == 0)
+		ft->results.arrival_pending =
+			tg_arrivals_pending(ft->tg, &ft->rd);
+	oplog_close(ft->rd.log);
+	ft->rd.log = NULL;
 	return NULL;
 }
 
@@ -114,11 +370,105 @@ int ft_get_fsync_file(ffsb_thread_t *ft)
 	return tg_get_fsync_file(ft->tg);
 }
 
+uint64_t ft_get_lock_range_size(ffsb_thread_t *ft)
+{
+	return tg_get_lock_range_size(ft->tg);
+}
+
+uint32_t ft_get_lock_overlap(ffsb_thread_t *ft)
+{
+	return tg_get_lock_overlap(ft->tg);
+}
+
+uint32_t ft_get_lock_write_percent(ffsb_thread_t *ft)
+{
+	return tg_get_lock_write_percent(ft->tg);
+}
+
+int ft_get_lock_io(ffsb_thread_t *ft)
+{
+	return tg_get_lock_io(ft->tg);
+}
+
+uint32_t ft_get_rmw_recordsize(ffsb_thread_t *ft)
+{
+	return tg_get_rmw_recordsize(ft->tg);
+}
+
+uint32_t ft_get_rmw_records(ffsb_thread_t *ft)
+{
+	return tg_get_rmw_records(ft->tg);
+}
+
+uint32_t ft_get_scan_threads(ffsb_thread_t *ft)
+{
+	return tg_get_scan_threads(ft->tg);
+}
+
+uint32_t ft_get_page_size(ffsb_thread_t *ft)
+{
+	return tg_get_page_size(ft->tg);
+}
+
+uint64_t ft_get_stream_rate(ffsb_thread_t *ft)
+{
+	return tg_get_stream_rate(ft->tg);
+}
+
+struct replay_trace *ft_get_replay(ffsb_thread_t *ft)
+{
+	return tg_get_replay(ft->tg);
+}
+
+uint64_t ft_pick_size(ffsb_thread_t *ft, int which)
+{
+	ffsb_sizedist_t *sd = tg_get_sizedist(ft->tg, which);
+
+	if (sd->type != FFSB_SIZE_FIXED)
+		return ffsb_sizedist_pick(sd, ft_get_randdata(ft));
+
+	switch (which) {
+	case FFSB_READ_SIZE:
+		return tg_get_read_size(ft->tg);
+	case FFSB_READ_BLOCKSIZE:
+		return tg_get_read_blocksize(ft->tg);
+	case FFSB_WRITE_SIZE:
+		return tg_get_write_size(ft->tg);
+	default:
+		return tg_get_write_blocksize(ft->tg);
+	}
+}
+
+ffsb_offsets_t *ft_get_read_offsets(ffsb_thread_t *ft)
+{
+	return &ft->read_offsets;
+}
+
+ffsb_offsets_t *ft_get_write_offsets(ffsb_thread_t *ft)
+{
+	return &ft->write_offsets;
+}
+
+unsigned ft_get_thread_num(ffsb_thread_t *ft)
+{
+	return ft->thread_num;
+}
+
 randdata_t *ft_get_randdata(ffsb_thread_t *ft)
 {
 	return &ft->rd;
 }
 
+void ft_set_opdata(ffsb_thread_t *ft, void *data, unsigned opnum)
+{
+	ft->op_data[opnum] = data;
+}
+
+void *ft_get_opdata(ffsb_thread_t *ft, unsigned opnum)
+{
+	return ft->op_data[opnum];
+}
+
 void ft_incr_op(ffsb_thread_t *ft, unsigned opnum, unsigned increment, uint64_t bytes)
 {
 	ft->results.ops[opnum] += increment;
@@ -126,6 +476,119 @@ void ft_incr_op(ffsb_thread_t *ft, unsigned opnum, unsigned increment, uint64_t
 	ft->results.bytes[opnum] += bytes;
 }
 
+void ft_add_lock_wait(ffsb_thread_t *ft, unsigned opnum, int contended,
+		      uint64_t usec)
+{
+	ft->results.lock_contended[opnum] += contended;
+	ft->results.lock_wait_usec[opnum] += usec;
+}
+
+void ft_add_scan(ffsb_thread_t *ft, uint64_t files, uint64_t dirs,
+		 uint64_t usec)
+{
+	ft->results.scan_files += files;
+	ft->results.scan_dirs += dirs;
+	ft->results.scan_usec += usec;
+}
+
+void ft_add_lsm_compact(ffsb_thread_t *ft, uint64_t usec)
+{
+	ft->results.lsm_compact_usec += usec;
+}
+
+void ft_add_lsm_get(ffsb_thread_t *ft, uint64_t usec)
+{
+	ffsb_hist_add(&ft->results.lsm_get_lat, usec);
+}
+
+void ft_add_page_lat(ffsb_thread_t *ft, int write, int during, uint64_t usec)
+{
+	ffsb_hist_add(&ft->results.page_lat[write][during], usec);
+}
+
+void ft_add_obj_lat(ffsb_thread_t *ft, int verb, uint64_t usec)
+{
+	ffsb_hist_add(&ft->results.obj_lat[verb], usec);
+}
+
+void ft_add_stream_late(ffsb_thread_t *ft, int write, uint64_t usec)
+{
+	ffsb_hist_add(&ft->results.stream_late[write], usec);
+}
+
+void ft_add_replay_error(ffsb_thread_t *ft)
+{
+	ft->results.replay_errors++;
+}
+
+void ft_add_replay_done(ffsb_thread_t *ft, uint64_t usec)
+{
+	ft->results.replay_done++;
+	ft->results.replay_done_usec = usec;
+}
+
+void ft_add_think(ffsb_thread_t *ft, uint64_t requested, uint64_t actual)
+{
+	ft->results.think_requested_usec += requested;
+	ffsb_hist_add(&ft->results.think_actual, actual);
+	ffsb_hist_add(&ft->results.think_over,
+		      (actual > requested) ? actual - requested : 0);
+}
+
+void ft_add_io_bytes(ffsb_thread_t *ft, int write, uint64_t bytes)
+{
+	ft->io_bytes[write] += bytes;
+}
+
+void ft_add_throttle(ffsb_thread_t *ft, uint64_t usec)
+{
+	ft->results.throttle_usec += usec;
+}
+
+/* Times in nsecs */
+void ft_add_arrival(ffsb_thread_t *ft, uint64_t due, uint64_t start,
+		    uint64_t end)
+{
+	ffsb_hist_add(&ft->results.arrival_response, (end - due) / 1000);
+	ffsb_hist_add(&ft->results.arrival_service, (end - start) / 1000);
+	ffsb_hist_add(&ft->results.arrival_lag,
+		      (start > due) ? (start - due) / 1000 : 0);
+}
+
+void ft_add_checkpoint(ffsb_thread_t *ft, uint64_t usec)
+{
+	ft->results.checkpoint_usec += usec;
+}
+
+void ft_add_verify(ffsb_thread_t *ft, unsigned blocks, unsigned errors)
+{
+	ft->results.verify_blocks += blocks;
+	ft->results.verify_errors += errors;
+}
+
+void ft_add_progress(ffsb_thread_t *ft, uint64_t *ops, uint64_t *bytes)
+{
+	int i;
+
+	if (ft->window != FFSB_WINDOW_MEASURE)
+		return;
+	for (i = 0; i < FFSB_NUMOPS; i++)
+		ops[i] += ft->results.ops[i];
+	*bytes += ft->results.read_bytes + ft->results.write_bytes;
+}
+
+void ft_add_done(ffsb_thread_t *ft, uint64_t *ops, uint64_t *nsec)
+{
+	*ops += ft->done_ops;
+	*nsec += ft->done_nsec;
+}
+
+void ft_add_ramp_lat(ffsb_thread_t *ft, ffsb_hist_t *lat)
+{
+	if (ft->ramp_lat)
+		ffsb_hist_merge(lat, ft->ramp_lat);
+}
+
 void ft_add_readbytes(ffsb_thread_t *ft, uint32_t bytes)
 {
 	ft->results.read_bytes += bytes;
@@ -154,17 +617,34 @@ uint32_t ft_get_read_skipsize(ffsb_thread_t *ft)
 int ft_needs_stats(ffsb_thread_t *ft, syscall_t sys)
 {
 	int ret = 0;
-	if (ft && ft->fsd.config && !fsc_ignore_sys(ft->fsd.config, sys))
+	if (ft && ft->fsd.config && !fsc_ignore_sys(ft->fsd.config, sys) &&
+	    ft->window != FFSB_WINDOW_COOLDOWN)
 		ret = 1;
 	return ret;
 }
 
 void ft_add_stat(ffsb_thread_t *ft, syscall_t sys, uint32_t val)
 {
-	if (ft)
+	if (ft && ft->window != FFSB_WINDOW_COOLDOWN)
 		ffsb_add_data(&ft->fsd, sys, val);
 }
 
+void do_stats(struct timeval *start, struct timeval *end,
+	      ffsb_thread_t *ft, ffsb_fs_t *fs, syscall_t sys)
+{
+	uint32_t value;
+
+	if (!ft && !fs)
+		return;
+
+	value = tvdiff_usec(start, end);
+
+	if (ft && ft_needs_stats(ft, sys))
+		ft_add_stat(ft, sys, value);
+	if (fs && fs_needs_stats(fs, sys))
+		fs_add_stat(fs, sys, value);
+}
+
 ffsb_statsd_t *ft_get_stats_data(ffsb_thread_t *ft)
 {
 	return &ft->fsd;
@@ -25,10 +25,13 @@
 #include "ffsb_op.h"
 #include "ffsb_tg.h"
 #include "ffsb_stats.h"
+#include "ffsb_dist.h"
+#include "burst.h"
 
 #include "util.h" /* for barrier stuff */
 
 struct ffsb_tg;
+struct ffsb_fs;
 struct ffsb_op_results;
 
 /* FFSB thread object
@@ -54,6 +57,45 @@ typedef struct ffsb_thread {
 
 	struct ffsb_op_results results;
 
+	/* This thread's copy of the tg's file popularity, it keeps
+	 * per-thread state
+	 */
+	ffsb_popularity_t file_pop;
+
+	/* Likewise for the tg's read and write offset distributions */
+	ffsb_offsets_t read_offsets;
+	ffsb_offsets_t write_offsets;
+
+	/* Per-thread op state, for ops that carry something over
+	 * from one call to the next
+	 */
+	void *op_data[FFSB_NUMOPS];
+
+	/* Bytes this thread has really read [0] and written [1], for
+	 * the tg's bandwidth limits
+	 */
+	uint64_t io_bytes[2];
+
+	/* This thread's on/off phase, when the tg's bursts are
+	 * independent
+	 */
+	struct burst_phase burst_phase;
+
+	/* The tg's window as of this thread's last op, and its results
+	 * as they were when the cooldown began
+	 */
+	int window;
+	struct ffsb_op_results *kept;
+
+	/* Ops done and the time spent in them (nsecs) since the run
+	 * began, never reset, for the steady state rounds
+	 */
+	uint64_t done_ops;
+	uint64_t done_nsec;
+
+	/* Likewise every op's latency (usecs), if the tg ramps */
+	ffsb_hist_t *ramp_lat;
+
 	/* stats */
 	ffsb_statsd_t fsd;
 } ffsb_thread_t ;
@@ -62,6 +104,11 @@ void init_ffsb_thread(ffsb_thread_t *, struct ffsb_tg *, unsigned,
 		       unsigned, unsigned);
 void destroy_ffsb_thread(ffsb_thread_t *);
 
+/* Threads an op starts to work alongside ft */
+void ft_init_helper(ffsb_thread_t *helper, ffsb_thread_t *ft,
+		    unsigned bufsize);
+void ft_merge_helper(ffsb_thread_t *ft, ffsb_thread_t *helper);
+
 /* Owning thread group will start thread with this, thread runs until
  * *ft->checkval == ft->stopval.  Yes this is not strictly
  * synchronized, but that is okay for our purposes, and it limits (IMO
@@ -85,10 +132,65 @@ uint32_t ft_get_write_blocksize(ffsb_thread_t *);
 
 int ft_get_fsync_file(ffsb_thread_t *);
 
+uint64_t ft_get_lock_range_size(ffsb_thread_t *);
+uint32_t ft_get_lock_overlap(ffsb_thread_t *);
+uint32_t ft_get_lock_write_percent(ffsb_thread_t *);
+int ft_get_lock_io(ffsb_thread_t *);
+
+uint32_t ft_get_rmw_recordsize(ffsb_thread_t *);
+uint32_t ft_get_rmw_records(ffsb_thread_t *);
+
+uint32_t ft_get_scan_threads(ffsb_thread_t *);
+
+uint32_t ft_get_page_size(ffsb_thread_t *);
+
+uint64_t ft_get_stream_rate(ffsb_thread_t *);
+
+struct replay_trace *ft_get_replay(ffsb_thread_t *);
+/* A size for this op or syscall, FFSB_READ_SIZE etc. */
+uint64_t ft_pick_size(ffsb_thread_t *, int which);
+ffsb_offsets_t *ft_get_read_offsets(ffsb_thread_t *);
+ffsb_offsets_t *ft_get_write_offsets(ffsb_thread_t *);
+unsigned ft_get_thread_num(ffsb_thread_t *);
+
 randdata_t *ft_get_randdata(ffsb_thread_t *);
 
+void ft_set_opdata(ffsb_thread_t *, void *, unsigned opnum);
+void *ft_get_opdata(ffsb_thread_t *, unsigned opnum);
+
 void ft_incr_op(ffsb_thread_t *ft, unsigned opnum, unsigned increment, uint64_t bytes);
 
+void ft_add_lock_wait(ffsb_thread_t *ft, unsigned opnum, int contended,
+		      uint64_t usec);
+
+void ft_add_scan(ffsb_thread_t *ft, uint64_t files, uint64_t dirs,
+		 uint64_t usec);
+
+void ft_add_lsm_compact(ffsb_thread_t *ft, uint64_t usec);
+void ft_add_lsm_get(ffsb_thread_t *ft, uint64_t usec);
+
+void ft_add_page_lat(ffsb_thread_t *ft, int write, int during, uint64_t usec);
+void ft_add_checkpoint(ffsb_thread_t *ft, uint64_t usec);
+void ft_add_obj_lat(ffsb_thread_t *ft, int verb, uint64_t usec);
+void ft_add_stream_late(ffsb_thread_t *ft, int write, uint64_t usec);
+void ft_add_replay_error(ffsb_thread_t *ft);
+void ft_add_replay_done(ffsb_thread_t *ft, uint64_t usec);
+void ft_add_think(ffsb_thread_t *ft, uint64_t requested, uint64_t actual);
+void ft_add_io_bytes(ffsb_thread_t *ft, int write, uint64_t bytes);
+void ft_add_throttle(ffsb_thread_t *ft, uint64_t usec);
+void ft_add_arrival(ffsb_thread_t *ft, uint64_t due, uint64_t start,
+		    uint64_t end);
+
+void ft_add_verify(ffsb_thread_t *ft, unsigned blocks, unsigned errors);
+
+/* Adds the transactions and bytes done so far to the totals, read by
+ * other threads while this one runs and skipped until it has left the
+ * warmup
+ */
+void ft_add_progress(ffsb_thread_t *ft, uint64_t *ops, uint64_t *bytes);
+void ft_add_done(ffsb_thread_t *ft, uint64_t *ops, uint64_t *nsec);
+void ft_add_ramp_lat(ffsb_thread_t *ft, ffsb_hist_t *lat);
+
 void ft_add_readbytes(ffsb_thread_t *, uint32_t);
 void ft_add_writebytes(ffsb_thread_t *, uint32_t);
 
@@ -103,6 +205,12 @@ void ft_set_statsc(ffsb_thread_t *, ffsb_statsc_t *);
 int ft_needs_stats(ffsb_thread_t *, syscall_t);
 void ft_add_stat(ffsb_thread_t *, syscall_t, uint32_t);
 
+/* Records the time a syscall took from start to end, with the
+ * thread's and the filesystem's stats, either may be NULL
+ */
+void do_stats(struct timeval *start, struct timeval *end,
+	      ffsb_thread_t *ft, struct ffsb_fs *fs, syscall_t sys);
+
 ffsb_statsd_t *ft_get_stats_data(ffsb_thread_t *);
 
 #endif /* _FFSB_THREAD_H_ */
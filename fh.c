@@ -23,12 +23,17 @@
 #include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <inttypes.h>
 #include <assert.h>
+#include <errno.h>
+#include <sys/file.h>
+#include <unistd.h>
 
 #include "ffsb.h"
 #include "fh.h"
+#include "verify.h"
 
 #include "config.h"
 
@@ -47,23 +52,84 @@
  * ha, well, they're supposed to anyway...!!! TODO -SR 2006/05/14
  */
 
-static void do_stats(struct timeval *start, struct timeval *end,
-		     ffsb_thread_t *ft, ffsb_fs_t *fs, syscall_t sys)
+/* In verify mode blocks are tagged with the inode number of their
+ * file and their offset in it.  Both are kept for each descriptor
+ * from the time it's opened, so the i/o calls needn't ask.  For
+ * O_APPEND descriptors the write goes to the end of the file,
+ * wherever the file offset is, so only those look it up.
+ *
+ * Descriptors index a table allocated a chunk at a time.  A chunk is
+ * only ever added by the open that first needs it, and the
+ * descriptor isn't used before that open returns.
+ */
+struct verify_fd {
+	uint32_t filenum;
+	int append;
+	uint64_t offset;
+};
+
+#define VERIFY_FD_CHUNK  1024
+#define VERIFY_FD_CHUNKS 1024
+
+static struct verify_fd *verify_fds[VERIFY_FD_CHUNKS];
+static pthread_mutex_t verify_fds_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct verify_fd *verify_fd(int fd)
 {
-	struct timeval diff;
-	uint32_t value = 0;
+	return &verify_fds[fd / VERIFY_FD_CHUNK][fd % VERIFY_FD_CHUNK];
+}
 
-	if (!ft && !fs)
-		return;
+static void verify_open(int fd, int flags)
+{
+	struct verify_fd *chunk, *vf;
+	struct stat st;
 
-	timersub(end, start, &diff);
+	if (fd >= VERIFY_FD_CHUNK * VERIFY_FD_CHUNKS) {
+		printf("verify: too many open files\n");
+		exit(1);
+	}
+	pthread_mutex_lock(&verify_fds_lock);
+	chunk = verify_fds[fd / VERIFY_FD_CHUNK];
+	if (chunk == NULL) {
+		chunk = ffsb_malloc(sizeof(*chunk) * VERIFY_FD_CHUNK);
+		verify_fds[fd / VERIFY_FD_CHUNK] = chunk;
+	}
+	pthread_mutex_unlock(&verify_fds_lock);
 
-	value = 1000000 * diff.tv_sec + diff.tv_usec;
+	if (fstat(fd, &st) < 0) {
+		perror("fstat");
+		exit(1);
+	}
+	vf = verify_fd(fd);
+	vf->filenum = (uint32_t)st.st_ino;
+	vf->append = (flags & O_APPEND) != 0;
+	vf->offset = 0;
+}
 
-	if (ft && ft_needs_stats(ft, sys))
-		ft_add_stat(ft, sys, value);
-	if (fs && fs_needs_stats(fs, sys))
-		fs_add_stat(fs, sys, value);
+/* Where a write of the descriptor will land */
+static uint64_t verify_write_offset(int fd)
+{
+	struct verify_fd *vf = verify_fd(fd);
+	struct stat st;
+
+	if (!vf->append)
+		return vf->offset;
+	if (fstat(fd, &st) < 0) {
+		perror("fstat");
+		exit(1);
+	}
+	return st.st_size;
+}
+
+static void verify_read(int fd, void *buf, uint32_t size, uint64_t offset,
+			ffsb_thread_t *ft)
+{
+	unsigned checked, errors;
+
+	errors = verify_check(buf, size, offset, verify_fd(fd)->filenum,
+			      &checked);
+	if (ft)
+		ft_add_verify(ft, checked, errors);
 }
 
 static int fhopenhelper(char *filename, char *bufflags, int flags,
@@ -90,6 +156,9 @@ static int fhopenhelper(char *filename, char *bufflags, int flags,
 		do_stats(&start, &end, ft, fs, SYS_OPEN);
 	}
 
+	if (fs && fs_get_verify(fs))
+		verify_open(fd, flags);
+
 	return fd;
 }
 
@@ -133,14 +202,239 @@ int fhopencreate(char *filename, ffsb_thread_t *ft, ffsb_fs_t *fs)
 	return fhopenhelper(filename, "rw", flags, ft, fs);
 }
 
+int fhopenrw(char *filename, ffsb_thread_t *ft, ffsb_fs_t *fs)
+{
+	int flags = O_RDWR;
+	int directio = fs_get_directio(fs);
+
+	if (directio)
+		flags |= O_DIRECT;
+	return fhopenhelper(filename, "rw", flags, ft, fs);
+}
+
+/* Like fhopenread() but returns -1 if the file is gone, as files may
+ * be deleted under a scan by other threadgroups
+ */
+int fhtryopenread(char *filename, ffsb_thread_t *ft, ffsb_fs_t *fs)
+{
+	int fd;
+	struct timeval start, end;
+	int flags = O_RDONLY | O_LARGEFILE;
+	int need_stats = ft_needs_stats(ft, SYS_OPEN) ||
+		fs_needs_stats(fs, SYS_OPEN);
+
+	if (fs_get_directio(fs))
+		flags |= O_DIRECT;
+
+	if (need_stats)
+		gettimeofday(&start, NULL);
+
+	fd = open64(filename, flags);
+
+	if (need_stats) {
+		gettimeofday(&end, NULL);
+		do_stats(&start, &end, ft, fs, SYS_OPEN);
+	}
+
+	if (fd < 0 && errno != ENOENT) {
+		perror(filename);
+		exit(1);
+	}
+	return fd;
+}
+
+/* Opens an unnamed file in directory dirname, it has to be given a
+ * name later on with fhlinkat()
+ */
+int fhopentmpfile(char *dirname, ffsb_thread_t *ft, ffsb_fs_t *fs)
+{
+#ifdef O_TMPFILE
+	int flags = O_TMPFILE | O_RDWR;
+	int directio = fs_get_directio(fs);
+
+	if (directio)
+		flags |= O_DIRECT;
+	return fhopenhelper(dirname, "rw", flags, ft, fs);
+#else
+	fprintf(stderr, "O_TMPFILE is not supported on this platform\n");
+	exit(1);
+#endif
+}
+
+/* Returns -1 if a directory in either path doesn't exist, so the
+ * caller can create it and retry, any other failure is fatal.
+ */
+int fhrename(char *oldname, char *newname, ffsb_thread_t *ft, ffsb_fs_t *fs)
+{
+	struct timeval start, end;
+	int ret;
+	int need_stats = ft_needs_stats(ft, SYS_RENAME) ||
+		fs_needs_stats(fs, SYS_RENAME);
+
+	if (need_stats)
+		gettimeofday(&start, NULL);
+
+	ret = rename(oldname, newname);
+
+	if (need_stats) {
+		gettimeofday(&end, NULL);
+		do_stats(&start, &end, ft, fs, SYS_RENAME);
+	}
+
+	if (ret < 0 && errno != ENOENT) {
+		perror(newname);
+		exit(1);
+	}
+	return ret;
+}
+
+/* Gives the unnamed file opened by fhopentmpfile() a name.
+ * AT_EMPTY_PATH needs CAP_DAC_READ_SEARCH, without it we fall back
+ * to linking through /proc which is what unprivileged users do.
+ */
+void fhlinkat(int fd, char *filename, ffsb_thread_t *ft, ffsb_fs_t *fs)
+{
+	struct timeval start, end;
+	char procpath[64];
+	int ret;
+	int need_stats = ft_needs_stats(ft, SYS_LINK) ||
+		fs_needs_stats(fs, SYS_LINK);
+
+	if (need_stats)
+		gettimeofday(&start, NULL);
+
+	ret = linkat(fd, "", AT_FDCWD, filename, AT_EMPTY_PATH);
+	if (ret < 0 && errno == ENOENT) {
+		snprintf(procpath, sizeof(procpath), "/proc/self/fd/%d", fd);
+		ret = linkat(AT_FDCWD, procpath, AT_FDCWD, filename,
+			     AT_SYMLINK_FOLLOW);
+	}
+
+	if (need_stats) {
+		gettimeofday(&end, NULL);
+		do_stats(&start, &end, ft, fs, SYS_LINK);
+	}
+
+	if (ret < 0) {
+		perror(filename);
+		exit(1);
+	}
+}
+
+/* Takes an OFD byte-range lock, read (shared) or write (exclusive).
+ * A non-blocking attempt is made first so we can tell whether we had
+ * to wait for somebody else, returns 1 if the lock was contended.
+ * The time spent acquiring the lock is stored in *wait_usec.
+ */
+int fhlock(int fd, int exclusive, uint64_t offset, uint64_t len,
+	   uint64_t *wait_usec, ffsb_thread_t *ft, ffsb_fs_t *fs)
+{
+#ifdef F_OFD_SETLK
+	struct timeval start, end;
+	struct flock fl;
+	int contended = 0;
+
+	memset(&fl, 0, sizeof(fl));
+	fl.l_type = exclusive ? F_WRLCK : F_RDLCK;
+	fl.l_whence = SEEK_SET;
+	fl.l_start = offset;
+	fl.l_len = len;
+
+	gettimeofday(&start, NULL);
+
+	if (fcntl(fd, F_OFD_SETLK, &fl) < 0) {
+		if (errno != EAGAIN && errno != EACCES) {
+			perror("fcntl(F_OFD_SETLK)");
+			exit(1);
+		}
+		contended = 1;
+		while (fcntl(fd, F_OFD_SETLKW, &fl) < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("fcntl(F_OFD_SETLKW)");
+			exit(1);
+		}
+	}
+
+	gettimeofday(&end, NULL);
+	do_stats(&start, &end, ft, fs, SYS_LOCK);
+
+	*wait_usec = tvdiff_usec(&start, &end);
+	return contended;
+#else
+	fprintf(stderr, "OFD locks are not supported on this platform\n");
+	exit(1);
+#endif
+}
+
+void fhunlock(int fd, uint64_t offset, uint64_t len, ffsb_thread_t *ft,
+	      ffsb_fs_t *fs)
+{
+#ifdef F_OFD_SETLK
+	struct flock fl;
+
+	memset(&fl, 0, sizeof(fl));
+	fl.l_type = F_UNLCK;
+	fl.l_whence = SEEK_SET;
+	fl.l_start = offset;
+	fl.l_len = len;
+
+	if (fcntl(fd, F_OFD_SETLK, &fl) < 0) {
+		perror("fcntl(F_UNLCK)");
+		exit(1);
+	}
+#endif
+}
+
+/* Same as fhlock() but for a whole-file flock() */
+int fhflock(int fd, int exclusive, uint64_t *wait_usec, ffsb_thread_t *ft,
+	    ffsb_fs_t *fs)
+{
+	struct timeval start, end;
+	int operation = exclusive ? LOCK_EX : LOCK_SH;
+	int contended = 0;
+
+	gettimeofday(&start, NULL);
+
+	if (flock(fd, operation | LOCK_NB) < 0) {
+		if (errno != EWOULDBLOCK) {
+			perror("flock");
+			exit(1);
+		}
+		contended = 1;
+		while (flock(fd, operation) < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("flock");
+			exit(1);
+		}
+	}
+
+	gettimeofday(&end, NULL);
+	do_stats(&start, &end, ft, fs, SYS_LOCK);
+
+	*wait_usec = tvdiff_usec(&start, &end);
+	return contended;
+}
+
+void fhfunlock(int fd, ffsb_thread_t *ft, ffsb_fs_t *fs)
+{
+	if (flock(fd, LOCK_UN) < 0) {
+		perror("flock(LOCK_UN)");
+		exit(1);
+	}
+}
+
 void fhread(int fd, void *buf, uint64_t size, ffsb_thread_t *ft, ffsb_fs_t *fs)
 {
 	ssize_t realsize;
 	struct timeval start, end;
 	int need_stats = ft_needs_stats(ft, SYS_READ) ||
 		fs_needs_stats(fs, SYS_READ);
+	int verify = fs && fs_get_verify(fs);
 
 	assert(size <= SIZE_MAX);
+
 	if (need_stats)
 		gettimeofday(&start, NULL);
 	realsize = read(fd, buf, size);
@@ -156,6 +450,152 @@ void fhread(int fd, void *buf, uint64_t size, ffsb_thread_t *ft, ffsb_fs_t *fs)
 		perror("read");
 		exit(1);
 	}
+	if (ft)
+		ft_add_io_bytes(ft, 0, size);
+
+	if (verify) {
+		verify_read(fd, buf, size, verify_fd(fd)->offset, ft);
+		verify_fd(fd)->offset += size;
+	}
+}
+
+/* Reads up to size bytes and returns how many it got, fewer than
+ * size only at the end of the file
+ */
+uint32_t fhreadsome(int fd, void *buf, uint32_t size, ffsb_thread_t *ft,
+		    ffsb_fs_t *fs)
+{
+	ssize_t realsize;
+	struct timeval start, end;
+	int need_stats = ft_needs_stats(ft, SYS_READ) ||
+		fs_needs_stats(fs, SYS_READ);
+
+	if (need_stats)
+		gettimeofday(&start, NULL);
+
+	realsize = read(fd, buf, size);
+
+	if (need_stats) {
+		gettimeofday(&end, NULL);
+		do_stats(&start, &end, ft, fs, SYS_READ);
+	}
+
+	if (realsize < 0) {
+		perror("read");
+		exit(1);
+	}
+	if (ft)
+		ft_add_io_bytes(ft, 0, realsize);
+	return realsize;
+}
+
+/* Positioned read and write, they don't move the file offset and
+ * are accounted as regular reads and writes
+ */
+void fhpread(int fd, void *buf, uint32_t size, uint64_t offset,
+	     ffsb_thread_t *ft, ffsb_fs_t *fs)
+{
+	ssize_t realsize;
+	struct timeval start, end;
+	int need_stats = ft_needs_stats(ft, SYS_READ) ||
+		fs_needs_stats(fs, SYS_READ);
+	int verify = fs && fs_get_verify(fs);
+
+	if (need_stats)
+		gettimeofday(&start, NULL);
+
+	realsize = pread(fd, buf, size, offset);
+
+	if (need_stats) {
+		gettimeofday(&end, NULL);
+		do_stats(&start, &end, ft, fs, SYS_READ);
+	}
+
+	if (realsize != size) {
+		printf("Read %lld instead of %u bytes at offset %llu.\n",
+		       (long long)realsize, size, (unsigned long long)offset);
+		perror("pread");
+		exit(1);
+	}
+	if (ft)
+		ft_add_io_bytes(ft, 0, size);
+
+	if (verify)
+		verify_read(fd, buf, size, offset, ft);
+}
+
+void fhpwrite(int fd, void *buf, uint32_t size, uint64_t offset,
+	      ffsb_thread_t *ft, ffsb_fs_t *fs)
+{
+	ssize_t realsize;
+	struct timeval start, end;
+	int need_stats = ft_needs_stats(ft, SYS_WRITE) ||
+		fs_needs_stats(fs, SYS_WRITE);
+
+	if (fs && fs_get_verify(fs))
+		verify_stamp(buf, size, offset, verify_fd(fd)->filenum);
+
+	if (need_stats)
+		gettimeofday(&start, NULL);
+
+	realsize = pwrite(fd, buf, size, offset);
+
+	if (need_stats) {
+		gettimeofday(&end, NULL);
+		do_stats(&start, &end, ft, fs, SYS_WRITE);
+	}
+
+	if (realsize != size) {
+		printf("Wrote %lld instead of %u bytes at offset %llu.\n"
+		       "Probably out of disk space\n", (long long)realsize,
+		       size, (unsigned long long)offset);
+		perror("pwrite");
+		exit(1);
+	}
+	if (ft)
+		ft_add_io_bytes(ft, 1, size);
+}
+
+void fhfdatasync(int fd, ffsb_thread_t *ft, ffsb_fs_t *fs)
+{
+	struct timeval start, end;
+	int need_stats = ft_needs_stats(ft, SYS_FDATASYNC) ||
+		fs_needs_stats(fs, SYS_FDATASYNC);
+
+	if (need_stats)
+		gettimeofday(&start, NULL);
+
+	if (fdatasync(fd)) {
+		perror("fdatasync");
+		printf("aborting\n");
+		exit(1);
+	}
+
+	if (need_stats) {
+		gettimeofday(&end, NULL);
+		do_stats(&start, &end, ft, fs, SYS_FDATASYNC);
+	}
+}
+
+void fhfsync(int fd, ffsb_thread_t *ft, ffsb_fs_t *fs)
+{
+	struct timeval start, end;
+	int need_stats = ft_needs_stats(ft, SYS_FSYNC) ||
+		fs_needs_stats(fs, SYS_FSYNC);
+
+	if (need_stats)
+		gettimeofday(&start, NULL);
+
+	if (fsync(fd)) {
+		perror("fsync");
+		printf("aborting\n");
+		exit(1);
+	}
+
+	if (need_stats) {
+		gettimeofday(&end, NULL);
+		do_stats(&start, &end, ft, fs, SYS_FSYNC);
+	}
 }
 
 void fhwrite(int fd, void *buf, uint32_t size, ffsb_thread_t *ft, ffsb_fs_t *fs)
@@ -165,7 +605,15 @@ void fhwrite(int fd, void *buf, uint32_t size, ffsb_thread_t *ft, ffsb_fs_t *fs)
 	int need_stats = ft_needs_stats(ft, SYS_WRITE) ||
 		fs_needs_stats(fs, SYS_WRITE);
 
+	int verify = fs && fs_get_verify(fs);
+	uint64_t offset = 0;
+
 	assert(size <= SIZE_MAX);
+	if (verify) {
+		offset = verify_write_offset(fd);
+		verify_stamp(buf, size, offset, verify_fd(fd)->filenum);
+	}
+
 	if (need_stats)
 		gettimeofday(&start, NULL);
 
@@ -182,6 +630,11 @@ void fhwrite(int fd, void *buf, uint32_t size, ffsb_thread_t *ft, ffsb_fs_t *fs)
 		perror("write");
 		exit(1);
 	}
+	if (ft)
+		ft_add_io_bytes(ft, 1, size);
+
+	if (verify)
+		verify_fd(fd)->offset = offset + size;
 }
 
 void fhseek(int fd, uint64_t offset, int whence, ffsb_thread_t *ft,
@@ -217,6 +670,9 @@ void fhseek(int fd, uint64_t offset, int whence, ffsb_thread_t *ft,
 		perror("seek");
 		exit(1);
 	}
+
+	if (fs && fs_get_verify(fs))
+		verify_fd(fd)->offset = res;
 }
 
 void fhclose(int fd, ffsb_thread_t *ft, ffsb_fs_t *fs)
@@ -261,18 +717,17 @@ void fhstat(char *name, ffsb_thread_t *ft, ffsb_fs_t *fs)
 int writefile_helper(int fd, uint64_t size, uint32_t blocksize, char *buf,
 		     struct ffsb_thread *ft, struct ffsb_fs *fs)
 {
-	uint64_t iterations, a;
-	uint64_t last;
-
-	iterations = size / blocksize;
-	last = size % blocksize;
-
-	for (a = 0; a < iterations; a++)
+	uint64_t a = 0;
+
+	while (size) {
+		/* a benchmark thread may draw each write's size */
+		if (ft)
+			blocksize = ft_pick_size(ft, FFSB_WRITE_BLOCKSIZE);
+		if (blocksize > size)
+			blocksize = size;
 		fhwrite(fd, buf, blocksize, ft, fs);
-
-	if (last) {
+		size -= blocksize;
 		a++;
-		fhwrite(fd, buf, last, ft, fs);
 	}
 	return a;
 }
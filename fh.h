@@ -27,11 +27,38 @@ int fhopenread(char *, struct ffsb_thread *, struct ffsb_fs *);
 int fhopenwrite(char *, struct ffsb_thread *, struct ffsb_fs *);
 int fhopencreate(char *, struct ffsb_thread *, struct ffsb_fs *);
 int fhopenappend(char *, struct ffsb_thread *, struct ffsb_fs *);
+int fhopenrw(char *, struct ffsb_thread *, struct ffsb_fs *);
+
+/* fhopenread() for files that may be gone, returns -1 if they are */
+int fhtryopenread(char *, struct ffsb_thread *, struct ffsb_fs *);
+
+/* O_TMPFILE create, takes a directory name, fhlinkat() names the file */
+int fhopentmpfile(char *, struct ffsb_thread *, struct ffsb_fs *);
+void fhlinkat(int, char *, struct ffsb_thread *, struct ffsb_fs *);
+
+int fhrename(char *, char *, struct ffsb_thread *, struct ffsb_fs *);
+
+/* OFD byte-range and flock() whole-file locks.  The lock calls return
+ * 1 if the lock was contended and store the time spent waiting.
+ */
+int fhlock(int, int, uint64_t, uint64_t, uint64_t *, struct ffsb_thread *,
+	   struct ffsb_fs *);
+void fhunlock(int, uint64_t, uint64_t, struct ffsb_thread *, struct ffsb_fs *);
+int fhflock(int, int, uint64_t *, struct ffsb_thread *, struct ffsb_fs *);
+void fhfunlock(int, struct ffsb_thread *, struct ffsb_fs *);
 
 void fhread(int, void *, uint64_t, struct ffsb_thread *, struct ffsb_fs *);
+uint32_t fhreadsome(int, void *, uint32_t, struct ffsb_thread *,
+		    struct ffsb_fs *);
 
 /* can only write up to size_t bytes at a time, so size is a uint32_t */
 void fhwrite(int, void *, uint32_t, struct ffsb_thread *, struct ffsb_fs *);
+void fhpread(int, void *, uint32_t, uint64_t, struct ffsb_thread *,
+	     struct ffsb_fs *);
+void fhpwrite(int, void *, uint32_t, uint64_t, struct ffsb_thread *,
+	      struct ffsb_fs *);
+void fhfdatasync(int, struct ffsb_thread *, struct ffsb_fs *);
+void fhfsync(int, struct ffsb_thread *, struct ffsb_fs *);
 void fhseek(int, uint64_t, int, struct ffsb_thread *, struct ffsb_fs *);
 void fhclose(int, struct ffsb_thread *, struct ffsb_fs *);
 
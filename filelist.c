@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <sched.h>
 
 #include "rand.h"
 #include "filelist.h"
@@ -30,6 +31,8 @@
 #include "rwlock.h"
 #include "rbt.h"
 #include "cirlist.h"
+#include "oplog.h"
+#include "ffsb_dist.h"
 
 #if 0
 static
@@ -301,14 +304,19 @@ static struct ffsb_file *choose_file(struct benchfiles *b, randdata_t *rd)
 	}
 
 	while (cur == NULL) {
-		chosen = getrandom(rd, b->listsize);
+		if (rd->pop)
+			chosen = ffsb_popularity_pick(rd->pop, rd,
+						      b->listsize);
+		else
+			chosen = getrandom(rd, b->listsize);
 		temp.num = chosen;
 		cur = rbtree_find(b->files, &temp);
 	}
 	return cur->object;
 }
 
-struct ffsb_file *choose_file_reader(struct benchfiles *bf, randdata_t *rd)
+static struct ffsb_file *pick_file_reader(struct benchfiles *bf,
+					  randdata_t *rd)
 {
 	struct ffsb_file *ret;
 
@@ -321,14 +329,15 @@ struct ffsb_file *choose_file_reader(struct benchfiles *bf, randdata_t *rd)
 	ret = choose_file(bf, rd);
 	if (rw_trylock_read(&ret->lock)) {
 		rw_unlock_read(&bf->fileslock);
-		return choose_file_reader(bf, rd);
+		return pick_file_reader(bf, rd);
 	}
 
 	rw_unlock_read(&bf->fileslock);
 	return ret;
 }
 
-struct ffsb_file *choose_file_writer(struct benchfiles *bf, randdata_t *rd)
+static struct ffsb_file *pick_file_writer(struct benchfiles *bf,
+					  randdata_t *rd)
 {
 	struct ffsb_file *ret ;
 
@@ -338,13 +347,74 @@ struct ffsb_file *choose_file_writer(struct benchfiles *bf, randdata_t *rd)
 
 	if (rw_trylock_write(&ret->lock)) {
 		rw_unlock_read(&bf->fileslock);
-		return choose_file_writer(bf, rd);
+		return pick_file_writer(bf, rd);
 	}
 
 	rw_unlock_read(&bf->fileslock);
 	return ret;
 }
 
+/* Waits for file num, NULL if it doesn't exist */
+static struct ffsb_file *lock_file_num(struct benchfiles *bf, uint64_t num,
+				       int write)
+{
+	struct ffsb_file temp, *ret;
+	rb_node *cur;
+	int busy;
+
+	temp.num = num;
+	for (;;) {
+		rw_lock_read(&bf->fileslock);
+		cur = rbtree_find(bf->files, &temp);
+		if (cur == NULL) {
+			rw_unlock_read(&bf->fileslock);
+			return NULL;
+		}
+		ret = cur->object;
+		if (write)
+			busy = rw_trylock_write(&ret->lock);
+		else
+			busy = rw_trylock_read(&ret->lock);
+		rw_unlock_read(&bf->fileslock);
+		if (!busy)
+			return ret;
+		sched_yield();
+	}
+}
+
+/* With an oplog, only the file finally chosen is logged, not the
+ * retries it took to find an unlocked one
+ */
+static struct ffsb_file *choose_file_logged(struct benchfiles *bf,
+					    randdata_t *rd, int write)
+{
+	struct oplog *log = rd->log;
+	struct ffsb_file *ret = NULL;
+
+	if (oplog_replaying(log)) {
+		ret = lock_file_num(bf, oplog_get(log, OPLOG_FILE), write);
+		if (ret)
+			return ret;
+		oplog_diverged(log);
+	}
+
+	rd->log = NULL;
+	ret = write ? pick_file_writer(bf, rd) : pick_file_reader(bf, rd);
+	rd->log = log;
+	oplog_put(log, OPLOG_FILE, ret->num);
+	return ret;
+}
+
+struct ffsb_file *choose_file_reader(struct benchfiles *bf, randdata_t *rd)
+{
+	return choose_file_logged(bf, rd, 0);
+}
+
+struct ffsb_file *choose_file_writer(struct benchfiles *bf, randdata_t *rd)
+{
+	return choose_file_logged(bf, rd, 1);
+}
+
 void unlock_file_reader(struct ffsb_file *file)
 {
 	rw_unlock_read(&file->lock) ;
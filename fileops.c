@@ -31,25 +31,7 @@
 #include "ffsb.h"
 #include "fileops.h"
 #include "ffsb_op.h"
-
-static void do_stats(struct timeval *start, struct timeval *end,
-		     ffsb_thread_t *ft, ffsb_fs_t *fs, syscall_t sys)
-{
-	struct timeval diff;
-	uint32_t value = 0;
-
-	if (!ft && !fs)
-		return;
-
-	timersub(end, start, &diff);
-
-	value = 1000000 * diff.tv_sec + diff.tv_usec;
-
-	if (ft && ft_needs_stats(ft, sys))
-		ft_add_stat(ft, sys, value);
-	if (fs && fs_needs_stats(fs, sys))
-		fs_add_stat(fs, sys, value);
-}
+#include "verify.h"
 
 void fop_bench(ffsb_fs_t *fs, unsigned opnum)
 {
@@ -61,22 +43,62 @@ void fop_age(ffsb_fs_t *fs, unsigned opnum)
 	fs_set_opdata(fs, fs_get_agefiles(fs), opnum);
 }
 
-static unsigned readfile_helper(int fd, uint64_t size, uint32_t blocksize,
-				char *buf, ffsb_thread_t *ft, ffsb_fs_t *fs)
+/* Ops that rewrite existing files normally share them with readers.
+ * In verify mode a block must never be read while it is being
+ * rewritten, or be written by two threads at once, so the writer
+ * takes the file exclusively.
+ */
+struct ffsb_file *choose_file_rewrite(struct benchfiles *bf, randdata_t *rd,
+				      ffsb_fs_t *fs)
+{
+	if (fs_get_verify(fs))
+		return choose_file_writer(bf, rd);
+	return choose_file_reader(bf, rd);
+}
+
+void unlock_file_rewrite(struct ffsb_file *file, ffsb_fs_t *fs)
 {
-	int iterations, a;
-	int last;
+	if (fs_get_verify(fs))
+		unlock_file_writer(file);
+	else
+		unlock_file_reader(file);
+}
 
-	iterations = size / blocksize;
-	last = size % blocksize;
+/* Reads size bytes, each read a read_blocksize from the thread.  A
+ * short last read isn't counted.
+ */
+static unsigned readfile_helper(int fd, uint64_t size, char *buf,
+				ffsb_thread_t *ft, ffsb_fs_t *fs)
+{
+	unsigned iterations = 0;
+	uint64_t blocksize;
 
-	for (a = 0; a < iterations; a++)
+	while (size) {
+		blocksize = ft_pick_size(ft, FFSB_READ_BLOCKSIZE);
+		if (blocksize > size) {
+			fhread(fd, buf, size, ft, fs);
+			break;
+		}
 		fhread(fd, buf, blocksize, ft, fs);
-	if (last)
-		fhread(fd, buf, last, ft, fs);
+		size -= blocksize;
+		iterations++;
+	}
 	return iterations;
 }
 
+/* Size of the next block of an op, cut short to what is left of it.
+ * 0 once the op is done.
+ */
+static uint32_t next_blocksize(ffsb_thread_t *ft, int which, uint64_t left)
+{
+	uint64_t blocksize;
+
+	if (!left)
+		return 0;
+	blocksize = ft_pick_size(ft, which);
+	return min(blocksize, left);
+}
+
 static uint64_t get_random_offset(randdata_t *rd, uint64_t filesize,
 				  int aligned)
 {
@@ -87,6 +109,35 @@ static uint64_t get_random_offset(randdata_t *rd, uint64_t filesize,
 	return getllrandom(rd, filesize) * 4096;
 }
 
+/* Read or write size bytes a block at a time, each block placed by
+ * the offset distribution.  Returns the number of blocks.
+ */
+static unsigned offsets_helper(int fd, ffsb_offsets_t *o, uint64_t filesize,
+			       uint64_t size, char *buf, int write,
+			       ffsb_thread_t *ft, ffsb_fs_t *fs)
+{
+	struct randdata *rd = ft_get_randdata(ft);
+	int which = write ? FFSB_WRITE_BLOCKSIZE : FFSB_READ_BLOCKSIZE;
+	unsigned iterations = 0;
+	uint32_t blocksize;
+
+	ffsb_offsets_start(o, rd, filesize,
+			   write ? ft_get_write_blocksize(ft) :
+			   ft_get_read_blocksize(ft));
+	while ((blocksize = next_blocksize(ft, which, size))) {
+		uint64_t offset = ffsb_offsets_next(o, rd, filesize, blocksize,
+						    fs_get_alignio(fs));
+		fhseek(fd, offset, SEEK_SET, ft, fs);
+		if (write)
+			fhwrite(fd, buf, blocksize, ft, fs);
+		else
+			fhread(fd, buf, blocksize, ft, fs);
+		size -= blocksize;
+		iterations++;
+	}
+	return iterations;
+}
+
 void ffsb_readfile(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
 {
 	struct benchfiles *bf = (struct benchfiles *)fs_get_opdata(fs, opnum);
@@ -97,7 +148,7 @@ void ffsb_readfile(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
 
 	char *buf = ft_getbuf(ft);
 	int read_random = ft_get_read_random(ft);
-	uint64_t read_size = ft_get_read_size(ft);
+	uint64_t read_size = ft_pick_size(ft, FFSB_READ_SIZE);
 	uint32_t read_blocksize = ft_get_read_blocksize(ft);
 	uint32_t read_skipsize = ft_get_read_skipsize(ft);
 	int skip_reads = ft_get_read_skip(ft);
@@ -112,8 +163,12 @@ void ffsb_readfile(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
 
 	assert(filesize >= read_size);
 
-	/* Sequential read, starting at a random point */
-	if (!read_random) {
+	if (ft_get_read_offsets(ft)->type != FFSB_OFF_DEFAULT) {
+		iterations = offsets_helper(fd, ft_get_read_offsets(ft),
+					    filesize, read_size, buf, 0,
+					    ft, fs);
+	} else if (!read_random) {
+		/* Sequential read, starting at a random point */
 		uint64_t range = filesize - read_size;
 		uint64_t offset = 0;
 		/* Skip or "stride" reads option */
@@ -162,22 +217,23 @@ void ffsb_readfile(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
 							   fs_get_alignio(fs));
 				fhseek(fd, offset, SEEK_SET, ft, fs);
 			}
-			iterations = readfile_helper(fd, read_size,
-						     read_blocksize, buf,
+			iterations = readfile_helper(fd, read_size, buf,
 						     ft, fs);
 		}
 	} else {
 		/* Randomized read */
-		uint64_t range = filesize - read_blocksize;
-		int i;
-
-		iterations = read_size / read_blocksize;
-
-		for (i = 0; i < iterations; i++) {
-			uint64_t offset = get_random_offset(rd, range,
-							    fs_get_alignio(fs));
+		uint64_t left = read_size;
+
+		while ((read_blocksize = next_blocksize(ft,
+							FFSB_READ_BLOCKSIZE,
+							left))) {
+			uint64_t offset = get_random_offset(rd,
+						filesize - read_blocksize,
+						fs_get_alignio(fs));
 			fhseek(fd, offset, SEEK_SET, ft, fs);
 			fhread(fd, buf, read_blocksize, ft, fs);
+			left -= read_blocksize;
+			iterations++;
 		}
 	}
 
@@ -199,7 +255,6 @@ void ffsb_readall(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
 	uint64_t filesize;
 
 	char *buf = ft_getbuf(ft);
-	uint32_t read_blocksize = ft_get_read_blocksize(ft);
 	struct randdata *rd = ft_get_randdata(ft);
 
 	unsigned iterations = 0;
@@ -208,7 +263,7 @@ void ffsb_readall(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
 	fd = fhopenread(curfile->name, ft, fs);
 
 	filesize = ffsb_get_filesize(curfile->name);
-	iterations = readfile_helper(fd, filesize, read_blocksize, buf, ft, fs);
+	iterations = readfile_helper(fd, filesize, buf, ft, fs);
 
 	unlock_file_reader(curfile);
 	fhclose(fd, ft, fs);
@@ -231,20 +286,24 @@ static unsigned ffsb_writefile_core(ffsb_thread_t *ft, ffsb_fs_t *fs,
 
 	char *buf = ft_getbuf(ft);
 	int write_random = ft_get_write_random(ft);
-	uint32_t write_size = ft_get_write_size(ft);
+	uint64_t write_size = ft_pick_size(ft, FFSB_WRITE_SIZE);
 	uint32_t write_blocksize = ft_get_write_blocksize(ft);
 	struct randdata *rd = ft_get_randdata(ft);
 	unsigned iterations = 0;
 
-	curfile = choose_file_reader(bf, rd);
+	curfile = choose_file_rewrite(bf, rd, fs);
 	fd = fhopenwrite(curfile->name, ft, fs);
 
 	filesize = ffsb_get_filesize(curfile->name);
 
 	assert(filesize >= write_size);
 
-	/* Sequential write, starting at a random point  */
-	if (!write_random) {
+	if (ft_get_write_offsets(ft)->type != FFSB_OFF_DEFAULT) {
+		iterations = offsets_helper(fd, ft_get_write_offsets(ft),
+					    filesize, write_size, buf, 1,
+					    ft, fs);
+	} else if (!write_random) {
+		/* Sequential write, starting at a random point  */
 		uint64_t range = filesize - write_size;
 		uint64_t offset = 0;
 		if (range) {
@@ -256,15 +315,18 @@ static unsigned ffsb_writefile_core(ffsb_thread_t *ft, ffsb_fs_t *fs,
 					      buf, ft, fs);
 	} else {
 		/* Randomized write */
-		uint64_t range = filesize - write_blocksize;
-		int i;
-		iterations = write_size / write_blocksize;
-
-		for (i = 0; i < iterations; i++) {
-			uint64_t offset = get_random_offset(rd, range,
-							    fs_get_alignio(fs));
+		uint64_t left = write_size;
+
+		while ((write_blocksize = next_blocksize(ft,
+							 FFSB_WRITE_BLOCKSIZE,
+							 left))) {
+			uint64_t offset = get_random_offset(rd,
+						filesize - write_blocksize,
+						fs_get_alignio(fs));
 			fhseek(fd, offset, SEEK_SET, ft, fs);
 			fhwrite(fd, buf, write_blocksize, ft, fs);
+			left -= write_blocksize;
+			iterations++;
 		}
 	}
 
@@ -275,7 +337,7 @@ static unsigned ffsb_writefile_core(ffsb_thread_t *ft, ffsb_fs_t *fs,
 			exit(1);
 		}
 	}
-	unlock_file_reader(curfile);
+	unlock_file_rewrite(curfile, fs);
 	fhclose(fd, ft, fs);
 	*filesize_ret = filesize;
 	return iterations;
@@ -319,7 +381,7 @@ static unsigned ffsb_writeall_core(ffsb_thread_t *ft, ffsb_fs_t *fs,
 
 	unsigned iterations = 0;
 
-	curfile = choose_file_reader(bf, rd);
+	curfile = choose_file_rewrite(bf, rd, fs);
 	fd = fhopenwrite(curfile->name, ft, fs);
 
 	filesize = ffsb_get_filesize(curfile->name);
@@ -332,7 +394,7 @@ static unsigned ffsb_writeall_core(ffsb_thread_t *ft, ffsb_fs_t *fs,
 			exit(1);
 		}
 
-	unlock_file_reader(curfile);
+	unlock_file_rewrite(curfile, fs);
 	fhclose(fd, ft, fs);
 	*filesize_ret = filesize;
 	return iterations;
@@ -372,20 +434,26 @@ static unsigned ffsb_appendfile_core(ffsb_thread_t *ft, ffsb_fs_t *fs,
 	int fd;
 
 	char *buf = ft_getbuf(ft);
-	uint32_t write_size = ft_get_write_size(ft);
+	uint64_t write_size = ft_pick_size(ft, FFSB_WRITE_SIZE);
 	uint32_t write_blocksize = ft_get_write_blocksize(ft);
 	struct randdata *rd = ft_get_randdata(ft);
 	unsigned iterations = 0;
 
-	curfile = choose_file_reader(bf, rd);
+	curfile = choose_file_rewrite(bf, rd, fs);
 	fd = fhopenappend(curfile->name, ft, fs);
 
-	unlock_file_reader(curfile);
+	/* Appends may run in parallel, except in verify mode where the
+	 * block headers depend on where each write lands.
+	 */
+	if (!fs_get_verify(fs))
+		unlock_file_reader(curfile);
 
 	curfile->size += (uint64_t)write_size;
 
 	iterations = writefile_helper(fd, write_size, write_blocksize, buf,
 				      ft, fs);
+	if (fs_get_verify(fs))
+		unlock_file_writer(curfile);
 	if (fsync_file)
  		if (fsync(fd)) {
  			perror("fsync");
@@ -418,21 +486,13 @@ void ffsb_appendfile_fsync(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
 	ft_add_writebytes(ft, filesize);
 }
 
-static unsigned ffsb_createfile_core(ffsb_thread_t *ft, ffsb_fs_t *fs,
-				     unsigned opnum, uint64_t *filesize_ret,
-				     int fsync_file)
+/* Pick the size of a new file, either from the size_weight list or
+ * uniformly between min_filesize and max_filesize
+ */
+uint64_t choose_create_size(ffsb_fs_t *fs, randdata_t *rd)
 {
-	struct benchfiles *bf = (struct benchfiles *)fs_get_opdata(fs, opnum);
-	struct ffsb_file *newfile = NULL;
-
-	int fd;
 	uint64_t size;
 
-	char *buf = ft_getbuf(ft);
-	uint32_t write_blocksize = ft_get_write_blocksize(ft);
-	struct randdata *rd = ft_get_randdata(ft);
-	unsigned iterations = 0;
-
 	if (fs->num_weights) {
 		int num = 1 + getrandom(rd, fs->sum_weights);
 		int curop = 0;
@@ -450,6 +510,29 @@ static unsigned ffsb_createfile_core(ffsb_thread_t *ft, ffsb_fs_t *fs,
 			size += getllrandom(rd, range);
 	}
 
+	/* verify only deals in whole blocks */
+	if (fs_get_verify(fs))
+		size &= ~(uint64_t)(VERIFY_BLOCKSIZE - 1);
+	return size;
+}
+
+static unsigned ffsb_createfile_core(ffsb_thread_t *ft, ffsb_fs_t *fs,
+				     unsigned opnum, uint64_t *filesize_ret,
+				     int fsync_file)
+{
+	struct benchfiles *bf = (struct benchfiles *)fs_get_opdata(fs, opnum);
+	struct ffsb_file *newfile = NULL;
+
+	int fd;
+	uint64_t size;
+
+	char *buf = ft_getbuf(ft);
+	uint32_t write_blocksize = ft_get_write_blocksize(ft);
+	struct randdata *rd = ft_get_randdata(ft);
+	unsigned iterations = 0;
+
+	size = choose_create_size(fs, rd);
+
 	newfile = add_file(bf, size, rd);
 	fd = fhopencreate(newfile->name, ft, fs);
 	iterations = writefile_helper(fd, size, write_blocksize, buf, ft, fs);
@@ -487,6 +570,76 @@ void ffsb_createfile_fsync(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
 	ft_add_writebytes(ft, filesize);
 }
 
+/* Same as ffsb_createfile_core, but the file is written as an
+ * unnamed O_TMPFILE in the target directory and only linked into the
+ * namespace once all of its data is written (and optionally synced).
+ */
+static unsigned ffsb_createfile_tmpfile_core(ffsb_thread_t *ft, ffsb_fs_t *fs,
+					     unsigned opnum,
+					     uint64_t *filesize_ret,
+					     int fsync_file)
+{
+	struct benchfiles *bf = (struct benchfiles *)fs_get_opdata(fs, opnum);
+	struct ffsb_file *newfile = NULL;
+
+	int fd;
+	uint64_t size;
+	char dirname[FILENAME_MAX];
+	char *slash;
+
+	char *buf = ft_getbuf(ft);
+	uint32_t write_blocksize = ft_get_write_blocksize(ft);
+	struct randdata *rd = ft_get_randdata(ft);
+	unsigned iterations = 0;
+
+	size = choose_create_size(fs, rd);
+
+	newfile = add_file(bf, size, rd);
+
+	strncpy(dirname, newfile->name, FILENAME_MAX - 1);
+	dirname[FILENAME_MAX - 1] = '\0';
+	slash = strrchr(dirname, '/');
+	if (slash)
+		*slash = '\0';
+
+	fd = fhopentmpfile(dirname, ft, fs);
+	iterations = writefile_helper(fd, size, write_blocksize, buf, ft, fs);
+
+	if (fsync_file)
+ 		if (fsync(fd)) {
+ 			perror("fsync");
+ 			printf("aborting\n");
+ 			exit(1);
+ 		}
+
+	fhlinkat(fd, newfile->name, ft, fs);
+	fhclose(fd, ft, fs);
+	unlock_file_writer(newfile);
+ 	*filesize_ret = size;
+	return iterations;
+}
+
+void ffsb_createfile_tmpfile(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
+{
+	unsigned iterations;
+	uint64_t filesize;
+
+	iterations = ffsb_createfile_tmpfile_core(ft, fs, opnum, &filesize, 0);
+	ft_incr_op(ft, opnum, iterations, filesize);
+	ft_add_writebytes(ft, filesize);
+}
+
+void ffsb_createfile_tmpfile_fsync(ffsb_thread_t *ft, ffsb_fs_t *fs,
+				   unsigned opnum)
+{
+	unsigned iterations;
+	uint64_t filesize;
+
+	iterations = ffsb_createfile_tmpfile_core(ft, fs, opnum, &filesize, 1);
+	ft_incr_op(ft, opnum, iterations, filesize);
+	ft_add_writebytes(ft, filesize);
+}
+
 void ffsb_deletefile(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
 {
 	struct benchfiles *bf = (struct benchfiles *)fs_get_opdata(fs, opnum);
@@ -545,3 +698,84 @@ void ffsb_stat(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
 	ft_incr_op(ft, opnum, 1, 0);
 }
 
+
+/* Read-modify-write: read a record, change a few bytes of it and write
+ * it back in place, like a database updating a row in a page.  Each
+ * record's read-to-write turnaround is recorded as the "rmw" call,
+ * the read and write halves show up as regular reads and writes.
+ */
+static unsigned ffsb_rmw_core(ffsb_thread_t *ft, ffsb_fs_t *fs,
+			      unsigned opnum, uint64_t *bytes_ret,
+			      int sync_file)
+{
+	struct benchfiles *bf = (struct benchfiles *)fs_get_opdata(fs, opnum);
+	struct ffsb_file *curfile = NULL;
+
+	int fd;
+	uint64_t filesize, range;
+	struct timeval start, end;
+	int need_stats = ft_needs_stats(ft, SYS_RMW) ||
+		fs_needs_stats(fs, SYS_RMW);
+
+	char *buf = ft_getbuf(ft);
+	uint32_t recordsize = ft_get_rmw_recordsize(ft);
+	uint32_t records = ft_get_rmw_records(ft);
+	struct randdata *rd = ft_get_randdata(ft);
+	unsigned i;
+
+	curfile = choose_file_rewrite(bf, rd, fs);
+	fd = fhopenrw(curfile->name, ft, fs);
+
+	filesize = ffsb_get_filesize(curfile->name);
+
+	assert(filesize >= recordsize);
+	range = filesize - recordsize;
+
+	for (i = 0; i < records; i++) {
+		uint64_t offset = get_random_offset(rd, range,
+						    fs_get_alignio(fs));
+		uint32_t pos = getrandom(rd, recordsize / sizeof(uint64_t));
+
+		if (need_stats)
+			gettimeofday(&start, NULL);
+
+		fhpread(fd, buf, recordsize, offset, ft, fs);
+		((uint64_t *)buf)[pos]++;
+		fhpwrite(fd, buf, recordsize, offset, ft, fs);
+
+		if (need_stats) {
+			gettimeofday(&end, NULL);
+			do_stats(&start, &end, ft, fs, SYS_RMW);
+		}
+	}
+
+	if (sync_file)
+		fhfdatasync(fd, ft, fs);
+
+	unlock_file_rewrite(curfile, fs);
+	fhclose(fd, ft, fs);
+	*bytes_ret = (uint64_t)records * recordsize;
+	return records;
+}
+
+void ffsb_rmw(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
+{
+	unsigned iterations;
+	uint64_t bytes;
+
+	iterations = ffsb_rmw_core(ft, fs, opnum, &bytes, 0);
+	ft_incr_op(ft, opnum, iterations, bytes);
+	ft_add_readbytes(ft, bytes);
+	ft_add_writebytes(ft, bytes);
+}
+
+void ffsb_rmw_fdatasync(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
+{
+	unsigned iterations;
+	uint64_t bytes;
+
+	iterations = ffsb_rmw_core(ft, fs, opnum, &bytes, 1);
+	ft_incr_op(ft, opnum, iterations, bytes);
+	ft_add_readbytes(ft, bytes);
+	ft_add_writebytes(ft, bytes);
+}
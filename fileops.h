@@ -31,11 +31,16 @@ void ffsb_writeall(ffsb_thread_t *tconfig, ffsb_fs_t *, unsigned opnum);
 void ffsb_writeall_fsync(ffsb_thread_t *tconfig, ffsb_fs_t *, unsigned opnum);
 void ffsb_createfile(ffsb_thread_t *tconfig, ffsb_fs_t *, unsigned opnum);
 void ffsb_createfile_fsync(ffsb_thread_t *tconfig, ffsb_fs_t *, unsigned opnum);
+void ffsb_createfile_tmpfile(ffsb_thread_t *tconfig, ffsb_fs_t *, unsigned opnum);
+void ffsb_createfile_tmpfile_fsync(ffsb_thread_t *tconfig, ffsb_fs_t *,
+				   unsigned opnum);
 void ffsb_deletefile(ffsb_thread_t *tconfig, ffsb_fs_t *, unsigned opnum);
 void ffsb_appendfile(ffsb_thread_t *tconfig, ffsb_fs_t *, unsigned opnum);
 void ffsb_appendfile_fsync(ffsb_thread_t *tconfig, ffsb_fs_t *, unsigned opnum);
 void ffsb_stat(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum);
 void ffsb_open_close(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum);
+void ffsb_rmw(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum);
+void ffsb_rmw_fdatasync(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum);
 
 struct ffsb_op_results;
 
@@ -44,6 +49,13 @@ void ffsb_write_print_exl(struct ffsb_op_results *, double secs, unsigned op_num
 void ffsb_create_print_exl(struct ffsb_op_results *, double secs, unsigned op_num);
 void ffsb_append_print_exl(struct ffsb_op_results *, double secs, unsigned op_num);
 
+struct ffsb_file *choose_file_rewrite(struct benchfiles *, randdata_t *,
+				      ffsb_fs_t *);
+void unlock_file_rewrite(struct ffsb_file *, ffsb_fs_t *);
+
+/* Size for a new file, from size_weight or min/max_filesize */
+uint64_t choose_create_size(ffsb_fs_t *fs, randdata_t *rd);
+
 /* Set up ops for either aging or benchmarking */
 void fop_bench(ffsb_fs_t *fs, unsigned opnum);
 void fop_age(ffsb_fs_t *fs, unsigned opnum);
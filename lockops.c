@@ -0,0 +1,151 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include <unistd.h>
+#include <sys/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ffsb.h"
+#include "lockops.h"
+#include "fh.h"
+#include "util.h"
+#include "filelist.h"
+
+/* lockops:
+ *  lock  - OFD byte-range lock, shared or exclusive
+ *  flock - whole-file flock(), shared or exclusive
+ *
+ * Both pick a file from the data set and a range of lock_range_size
+ * bytes within it.  lock_overlap percent of the ranges are placed at
+ * the start of the file so that threads fight over them, the others
+ * are spread over the file on range aligned boundaries.  If lock_io
+ * is set, the range is read (shared lock) or rewritten (exclusive
+ * lock) before the lock is dropped.
+ */
+
+static uint64_t lock_io(int fd, int exclusive, uint64_t offset,
+			uint64_t size, ffsb_thread_t *ft, ffsb_fs_t *fs)
+{
+	char *buf = ft_getbuf(ft);
+	uint32_t blocksize;
+	uint64_t done = 0;
+	uint32_t len;
+
+	if (exclusive)
+		blocksize = ft_get_write_blocksize(ft);
+	else
+		blocksize = ft_get_read_blocksize(ft);
+
+	fhseek(fd, offset, SEEK_SET, ft, fs);
+	while (done < size) {
+		len = min(blocksize, size - done);
+		if (exclusive)
+			fhwrite(fd, buf, len, ft, fs);
+		else
+			fhread(fd, buf, len, ft, fs);
+		done += len;
+	}
+
+	if (exclusive)
+		ft_add_writebytes(ft, size);
+	else
+		ft_add_readbytes(ft, size);
+	return size;
+}
+
+static void lock_core(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum,
+		      int whole_file)
+{
+	struct benchfiles *bf = (struct benchfiles *)fs_get_opdata(fs, opnum);
+	struct ffsb_file *curfile = NULL;
+	randdata_t *rd = ft_get_randdata(ft);
+
+	uint64_t range_size = ft_get_lock_range_size(ft);
+	uint64_t filesize, lock_len;
+	uint64_t offset = 0;
+	uint64_t wait_usec = 0;
+	uint64_t bytes = 0;
+	int exclusive, contended;
+	int fd;
+
+	exclusive = getrandom(rd, 100) < ft_get_lock_write_percent(ft);
+
+	if (exclusive && ft_get_lock_io(ft))
+		curfile = choose_file_rewrite(bf, rd, fs);
+	else
+		curfile = choose_file_reader(bf, rd);
+	fd = fhopenrw(curfile->name, ft, fs);
+
+	filesize = ffsb_get_filesize(curfile->name);
+	if (range_size > filesize)
+		range_size = filesize;
+
+	if (range_size && getrandom(rd, 100) >= ft_get_lock_overlap(ft))
+		offset = getllrandom(rd, filesize / range_size) * range_size;
+
+	/* A zero l_len would lock the whole file, an empty file gets
+	 * its first byte locked instead
+	 */
+	lock_len = max(range_size, 1);
+
+	if (whole_file)
+		contended = fhflock(fd, exclusive, &wait_usec, ft, fs);
+	else
+		contended = fhlock(fd, exclusive, offset, lock_len,
+				   &wait_usec, ft, fs);
+
+	if (ft_get_lock_io(ft) && range_size)
+		bytes = lock_io(fd, exclusive, offset, range_size, ft, fs);
+
+	if (whole_file)
+		fhfunlock(fd, ft, fs);
+	else
+		fhunlock(fd, offset, lock_len, ft, fs);
+
+	fhclose(fd, ft, fs);
+	if (exclusive && ft_get_lock_io(ft))
+		unlock_file_rewrite(curfile, fs);
+	else
+		unlock_file_reader(curfile);
+
+	ft_add_lock_wait(ft, opnum, contended, wait_usec);
+	ft_incr_op(ft, opnum, 1, bytes);
+}
+
+void ffsb_lock(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
+{
+	lock_core(ft, fs, opnum, 0);
+}
+
+void ffsb_flock(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
+{
+	lock_core(ft, fs, opnum, 1);
+}
+
+void ffsb_lock_print_exl(struct ffsb_op_results *results, double secs,
+			 unsigned op_num)
+{
+	unsigned acquired = results->ops[op_num];
+	uint64_t contended = results->lock_contended[op_num];
+
+	printf("%s: %llu of %u acquisitions contended (%.2lf%%), "
+	       "avg acquire time %.2lf usec\n", op_get_name(op_num),
+	       (unsigned long long)contended, acquired,
+	       100 * (double)contended / acquired,
+	       (double)results->lock_wait_usec[op_num] / acquired);
+}
@@ -0,0 +1,34 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef _LOCKOPS_H_
+#define _LOCKOPS_H_
+
+#include "ffsb.h"
+#include "fileops.h"
+
+/* Lock contention ops.  "lock" takes an OFD fcntl() byte-range lock
+ * and "flock" a whole-file flock() on a file from the data set,
+ * optionally doing i/o on the range while holding it.
+ */
+void ffsb_lock(struct ffsb_thread *, ffsb_fs_t *, unsigned);
+void ffsb_flock(struct ffsb_thread *, ffsb_fs_t *, unsigned);
+
+void ffsb_lock_print_exl(struct ffsb_op_results *, double secs,
+			 unsigned op_num);
+
+#endif /* _LOCKOPS_H_ */
@@ -0,0 +1,670 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#define _LARGEFILE64_SOURCE
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+
+#include "ffsb.h"
+#include "lsmops.h"
+#include "fh.h"
+#include "util.h"
+
+#define LSM_BASE "lsm"
+
+/* Keys are only tracked as ranges, so overlap between levels comes
+ * out the way it would in a real tree.  Flushed SSTs hold keys from
+ * anywhere in the keyspace, every deeper level is sorted and split.
+ */
+#define LSM_KEYSPACE (1ULL << 32)
+
+/* How long idle compaction and get threads wait for a flush */
+#define LSM_IDLE_WAIT_USEC 100000
+
+struct lsm_sst {
+	struct ffsb_file *file;
+	uint64_t lo, hi;	/* key range, [lo, hi) */
+	int compacting;
+};
+
+struct lsm_level {
+	struct benchfiles bf;
+
+	/* L0 is kept in flush order, the other levels by key */
+	struct lsm_sst *ssts;
+	unsigned count, size;
+	uint64_t bytes;
+
+	/* Key the next compaction out of this level starts at */
+	uint64_t cursor;
+};
+
+struct lsm_tree {
+	pthread_mutex_t lock;
+	pthread_cond_t work;
+
+	uint64_t sst_size;
+	uint32_t fanout;
+	uint32_t l0_files;
+	uint32_t num_levels;
+
+	/* Only one L0 -> L1 compaction can run at a time, since
+	 * every L0 file overlaps all of L1
+	 */
+	int l0_compacting;
+
+	struct lsm_level levels[FFSB_FS_MAX_LSM_LEVELS];
+};
+
+/* Inputs of one compaction, the first num_upper come from level, the
+ * rest from level + 1
+ */
+struct lsm_job {
+	unsigned level;
+	unsigned num_inputs, num_upper;
+	struct lsm_sst *inputs;
+	uint64_t lo, hi, bytes;
+};
+
+static int overlaps(uint64_t lo, uint64_t hi, struct lsm_sst *sst)
+{
+	return lo < sst->hi && sst->lo < hi;
+}
+
+static void level_insert(struct lsm_level *lvl, struct lsm_sst *sst,
+			 int sorted)
+{
+	unsigned pos = lvl->count;
+
+	if (lvl->count == lvl->size) {
+		lvl->size = lvl->size ? lvl->size * 2 : 16;
+		lvl->ssts = ffsb_realloc(lvl->ssts,
+					 lvl->size * sizeof(struct lsm_sst));
+	}
+
+	if (sorted)
+		for (pos = 0; pos < lvl->count; pos++)
+			if (lvl->ssts[pos].lo > sst->lo)
+				break;
+
+	memmove(&lvl->ssts[pos + 1], &lvl->ssts[pos],
+		(lvl->count - pos) * sizeof(struct lsm_sst));
+	lvl->ssts[pos] = *sst;
+	lvl->count++;
+	lvl->bytes += sst->file->size;
+}
+
+static void level_remove(struct lsm_level *lvl, struct ffsb_file *file)
+{
+	unsigned pos;
+
+	for (pos = 0; pos < lvl->count; pos++)
+		if (lvl->ssts[pos].file == file)
+			break;
+	if (pos == lvl->count) {
+		printf("lsm: %s missing from its level\n", file->name);
+		exit(1);
+	}
+
+	lvl->count--;
+	lvl->bytes -= file->size;
+	memmove(&lvl->ssts[pos], &lvl->ssts[pos + 1],
+		(lvl->count - pos) * sizeof(struct lsm_sst));
+}
+
+/* Target size of levels 1 and up, L1 holds as much as the L0
+ * trigger and every level below is fanout times bigger
+ */
+static uint64_t level_target(struct lsm_tree *tree, unsigned level)
+{
+	uint64_t target = tree->l0_files * tree->sst_size;
+
+	while (--level)
+		target *= tree->fanout;
+	return target;
+}
+
+/* How far over its target a level is, not counting files already
+ * being compacted.  Anything >= 1 needs compacting.
+ */
+static double level_score(struct lsm_tree *tree, unsigned level)
+{
+	struct lsm_level *lvl = &tree->levels[level];
+	uint64_t bytes = 0;
+	unsigned i, count = 0;
+
+	for (i = 0; i < lvl->count; i++)
+		if (!lvl->ssts[i].compacting) {
+			bytes += lvl->ssts[i].file->size;
+			count++;
+		}
+
+	if (level == 0)
+		return tree->l0_compacting ? 0 :
+			(double)count / tree->l0_files;
+	return (double)bytes / level_target(tree, level);
+}
+
+static void job_add(struct lsm_job *job, struct lsm_sst *sst)
+{
+	sst->compacting = 1;
+	job->inputs[job->num_inputs++] = *sst;
+	job->bytes += sst->file->size;
+	job->lo = min(job->lo, sst->lo);
+	job->hi = job->hi > sst->hi ? job->hi : sst->hi;
+}
+
+/* Claims the overlapping files of the next level, unless one of them
+ * is already part of another compaction
+ */
+static int claim_overlaps(struct lsm_tree *tree, struct lsm_job *job,
+			  uint64_t lo, uint64_t hi)
+{
+	struct lsm_level *next = &tree->levels[job->level + 1];
+	unsigned i;
+
+	for (i = 0; i < next->count; i++)
+		if (next->ssts[i].compacting && overlaps(lo, hi, &next->ssts[i]))
+			return 0;
+
+	for (i = 0; i < next->count; i++)
+		if (overlaps(lo, hi, &next->ssts[i]))
+			job_add(job, &next->ssts[i]);
+	return 1;
+}
+
+static int claim_level(struct lsm_tree *tree, unsigned level,
+		       struct lsm_job *job)
+{
+	struct lsm_level *lvl = &tree->levels[level];
+	struct lsm_level *next = &tree->levels[level + 1];
+	unsigned i, start;
+
+	memset(job, 0, sizeof(*job));
+	job->level = level;
+	job->lo = LSM_KEYSPACE;
+	job->inputs = ffsb_malloc((lvl->count + next->count) *
+				  sizeof(struct lsm_sst));
+
+	/* All of L0 goes down at once */
+	if (level == 0) {
+		uint64_t lo = LSM_KEYSPACE, hi = 0;
+
+		for (i = 0; i < lvl->count; i++) {
+			lo = min(lo, lvl->ssts[i].lo);
+			hi = hi > lvl->ssts[i].hi ? hi : lvl->ssts[i].hi;
+		}
+		if (claim_overlaps(tree, job, lo, hi)) {
+			for (i = 0; i < lvl->count; i++)
+				job_add(job, &lvl->ssts[i]);
+			job->num_upper = lvl->count;
+			tree->l0_compacting = 1;
+			goto claimed;
+		}
+		goto busy;
+	}
+
+	/* Otherwise take one file, round robin through the keyspace */
+	for (start = 0; start < lvl->count; start++)
+		if (lvl->ssts[start].lo >= lvl->cursor)
+			break;
+
+	for (i = 0; i < lvl->count; i++) {
+		struct lsm_sst *sst = &lvl->ssts[(start + i) % lvl->count];
+
+		if (sst->compacting)
+			continue;
+		if (!claim_overlaps(tree, job, sst->lo, sst->hi))
+			continue;
+		job_add(job, sst);
+		job->num_upper = 1;
+		lvl->cursor = sst->hi < LSM_KEYSPACE ? sst->hi : 0;
+		goto claimed;
+	}
+
+busy:
+	free(job->inputs);
+	return 0;
+
+claimed:
+	/* Keep the level's inputs first */
+	if (job->num_upper != job->num_inputs) {
+		unsigned lower = job->num_inputs - job->num_upper;
+		struct lsm_sst *tmp = ffsb_malloc(job->num_inputs *
+						  sizeof(struct lsm_sst));
+
+		memcpy(tmp, job->inputs + lower,
+		       job->num_upper * sizeof(struct lsm_sst));
+		memcpy(tmp + job->num_upper, job->inputs,
+		       lower * sizeof(struct lsm_sst));
+		free(job->inputs);
+		job->inputs = tmp;
+	}
+	return 1;
+}
+
+/* Picks the level furthest over its target that isn't blocked by a
+ * running compaction.  Called with the tree locked.
+ */
+static int pick_job(struct lsm_tree *tree, struct lsm_job *job)
+{
+	double scores[FFSB_FS_MAX_LSM_LEVELS];
+	unsigned i;
+
+	for (i = 0; i + 1 < tree->num_levels; i++)
+		scores[i] = level_score(tree, i);
+
+	for (;;) {
+		unsigned best = 0;
+
+		for (i = 1; i + 1 < tree->num_levels; i++)
+			if (scores[i] > scores[best])
+				best = i;
+		if (scores[best] < 1.0)
+			return 0;
+		if (claim_level(tree, best, job))
+			return 1;
+		scores[best] = 0;
+	}
+}
+
+/* Called with the tree locked */
+static void wait_for_work(struct lsm_tree *tree)
+{
+	struct timeval now;
+	struct timespec abstime;
+	uint64_t usec;
+
+	gettimeofday(&now, NULL);
+	usec = now.tv_usec + LSM_IDLE_WAIT_USEC;
+	abstime.tv_sec = now.tv_sec + usec / 1000000;
+	abstime.tv_nsec = (usec % 1000000) * 1000;
+	pthread_cond_timedwait(&tree->work, &tree->lock, &abstime);
+}
+
+static void lsm_fsync(int fd)
+{
+	if (fsync(fd)) {
+		perror("fsync");
+		printf("aborting\n");
+		exit(1);
+	}
+}
+
+void ffsb_lsm_flush(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
+{
+	struct lsm_tree *tree = (struct lsm_tree *)fs_get_opdata(fs, opnum);
+	struct lsm_level *l0 = &tree->levels[0];
+	randdata_t *rd = ft_get_randdata(ft);
+	char *buf = ft_getbuf(ft);
+	uint64_t size = tree->sst_size;
+	struct lsm_sst sst;
+	int fd;
+
+	sst.file = add_file(&l0->bf, size, rd);
+	sst.lo = 0;
+	sst.hi = LSM_KEYSPACE;
+	sst.compacting = 0;
+
+	fd = fhopencreate(sst.file->name, ft, fs);
+	writefile_helper(fd, size, ft_get_write_blocksize(ft), buf, ft, fs);
+	lsm_fsync(fd);
+	fhclose(fd, ft, fs);
+
+	/* holes handed back by add_file keep their old size */
+	sst.file->size = size;
+	unlock_file_writer(sst.file);
+
+	pthread_mutex_lock(&tree->lock);
+	level_insert(l0, &sst, 0);
+	pthread_cond_broadcast(&tree->work);
+	pthread_mutex_unlock(&tree->lock);
+
+	ft_incr_op(ft, opnum, 1, size);
+	ft_add_writebytes(ft, size);
+}
+
+/* Starts the next output file, outputs split the job's key range in
+ * proportion to the bytes they hold
+ */
+static int start_output(ffsb_thread_t *ft, ffsb_fs_t *fs,
+			struct lsm_level *next, struct lsm_job *job,
+			struct lsm_sst *out, uint64_t written)
+{
+	out->file = add_file(&next->bf, 0, ft_get_randdata(ft));
+	out->lo = job->lo + (uint64_t)((double)(job->hi - job->lo) *
+				       written / job->bytes);
+	out->compacting = 0;
+	return fhopencreate(out->file->name, ft, fs);
+}
+
+static void finish_output(ffsb_thread_t *ft, ffsb_fs_t *fs,
+			  struct lsm_job *job, struct lsm_sst *out, int fd,
+			  uint64_t size, uint64_t written)
+{
+	lsm_fsync(fd);
+	fhclose(fd, ft, fs);
+	out->file->size = size;
+	out->hi = job->lo + (uint64_t)((double)(job->hi - job->lo) *
+				       written / job->bytes);
+	if (written == job->bytes)
+		out->hi = job->hi;
+	unlock_file_writer(out->file);
+}
+
+/* Merge: reads the inputs a block at a time in turn, like a merging
+ * iterator would, and writes the result out as SSTs of sst_size.
+ * Returns the number of outputs, all unlocked and ready to install.
+ */
+static unsigned run_job(ffsb_thread_t *ft, ffsb_fs_t *fs,
+			struct lsm_tree *tree, struct lsm_job *job,
+			struct lsm_sst *outs)
+{
+	struct lsm_level *next = &tree->levels[job->level + 1];
+	uint32_t blocksize = ft_get_write_blocksize(ft);
+	char *buf = ft_getbuf(ft);
+	int *fds = ffsb_malloc(job->num_inputs * sizeof(int));
+	uint64_t *left = ffsb_malloc(job->num_inputs * sizeof(uint64_t));
+	uint64_t written = 0, out_size = 0;
+	unsigned i, num_outs = 0;
+	int outfd;
+
+	for (i = 0; i < job->num_inputs; i++) {
+		fds[i] = fhopenread(job->inputs[i].file->name, ft, fs);
+		left[i] = job->inputs[i].file->size;
+	}
+
+	outfd = start_output(ft, fs, next, job, &outs[0], 0);
+	i = 0;
+	while (written < job->bytes) {
+		uint32_t chunk;
+
+		while (left[i] == 0)
+			i = (i + 1) % job->num_inputs;
+
+		chunk = min(blocksize, left[i]);
+		chunk = min(chunk, tree->sst_size - out_size);
+
+		fhread(fds[i], buf, chunk, ft, fs);
+		fhwrite(outfd, buf, chunk, ft, fs);
+		ft_add_readbytes(ft, chunk);
+		ft_add_writebytes(ft, chunk);
+
+		left[i] -= chunk;
+		out_size += chunk;
+		written += chunk;
+		i = (i + 1) % job->num_inputs;
+
+		if (out_size == tree->sst_size || written == job->bytes) {
+			finish_output(ft, fs, job, &outs[num_outs], outfd,
+				      out_size, written);
+			num_outs++;
+			out_size = 0;
+			if (written < job->bytes)
+				outfd = start_output(ft, fs, next, job,
+						     &outs[num_outs], written);
+		}
+	}
+
+	for (i = 0; i < job->num_inputs; i++)
+		fhclose(fds[i], ft, fs);
+	free(fds);
+	free(left);
+	return num_outs;
+}
+
+static void delete_input(ffsb_thread_t *ft, ffsb_fs_t *fs,
+			 struct lsm_level *lvl, struct ffsb_file *file)
+{
+	struct timeval start, end;
+	int need_stats = ft_needs_stats(ft, SYS_UNLINK) ||
+		fs_needs_stats(fs, SYS_UNLINK);
+
+	/* wait out any lsm_get still reading it */
+	rw_lock_write(&file->lock);
+
+	if (need_stats)
+		gettimeofday(&start, NULL);
+
+	if (unlink(file->name) == -1) {
+		perror(file->name);
+		exit(1);
+	}
+
+	if (need_stats) {
+		gettimeofday(&end, NULL);
+		do_stats(&start, &end, ft, fs, SYS_UNLINK);
+	}
+
+	remove_file(&lvl->bf, file);
+	rw_unlock_write(&file->lock);
+}
+
+void ffsb_lsm_compact(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
+{
+	struct lsm_tree *tree = (struct lsm_tree *)fs_get_opdata(fs, opnum);
+	struct lsm_level *lvl, *next;
+	struct lsm_sst *outs;
+	struct lsm_job job;
+	struct timeval start, end;
+	unsigned i, num_outs;
+
+	pthread_mutex_lock(&tree->lock);
+	if (!pick_job(tree, &job)) {
+		wait_for_work(tree);
+		pthread_mutex_unlock(&tree->lock);
+		ft_incr_op(ft, opnum, 0, 0);
+		return;
+	}
+	pthread_mutex_unlock(&tree->lock);
+
+	gettimeofday(&start, NULL);
+
+	lvl = &tree->levels[job.level];
+	next = &tree->levels[job.level + 1];
+	outs = ffsb_malloc((job.bytes / tree->sst_size + 1) *
+			   sizeof(struct lsm_sst));
+	num_outs = run_job(ft, fs, tree, &job, outs);
+
+	/* Swap the outputs in for the inputs in one go */
+	pthread_mutex_lock(&tree->lock);
+	for (i = 0; i < job.num_inputs; i++)
+		level_remove(i < job.num_upper ? lvl : next,
+			     job.inputs[i].file);
+	for (i = 0; i < num_outs; i++)
+		level_insert(next, &outs[i], 1);
+	if (job.level == 0)
+		tree->l0_compacting = 0;
+	pthread_cond_broadcast(&tree->work);
+	pthread_mutex_unlock(&tree->lock);
+
+	for (i = 0; i < job.num_inputs; i++)
+		delete_input(ft, fs, i < job.num_upper ? lvl : next,
+			     job.inputs[i].file);
+
+	gettimeofday(&end, NULL);
+
+	ft_incr_op(ft, opnum, 1, job.bytes);
+	ft_add_lsm_compact(ft, tvdiff_usec(&start, &end));
+
+	free(outs);
+	free(job.inputs);
+}
+
+void ffsb_lsm_get(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
+{
+	struct lsm_tree *tree = (struct lsm_tree *)fs_get_opdata(fs, opnum);
+	randdata_t *rd = ft_get_randdata(ft);
+	uint32_t blocksize = ft_get_read_blocksize(ft);
+	char *buf = ft_getbuf(ft);
+	struct lsm_level *lvl;
+	struct ffsb_file *file;
+	struct timeval start, end;
+	uint64_t total = 0, pick, offset = 0, blocks;
+	uint32_t size;
+	unsigned i;
+	int fd;
+
+	pthread_mutex_lock(&tree->lock);
+	for (i = 0; i < tree->num_levels; i++)
+		total += tree->levels[i].bytes;
+	if (total == 0) {
+		wait_for_work(tree);
+		pthread_mutex_unlock(&tree->lock);
+		ft_incr_op(ft, opnum, 0, 0);
+		return;
+	}
+
+	/* Keys live in a level in proportion to its share of the
+	 * data, bloom filters keep us from reading the others
+	 */
+	pick = getllrandom(rd, total);
+	for (i = 0; pick >= tree->levels[i].bytes; i++)
+		pick -= tree->levels[i].bytes;
+	lvl = &tree->levels[i];
+	file = lvl->ssts[getrandom(rd, lvl->count)].file;
+	rw_lock_read(&file->lock);
+	pthread_mutex_unlock(&tree->lock);
+
+	size = min(blocksize, file->size);
+	blocks = file->size / size;
+	if (blocks > 1)
+		offset = getllrandom(rd, blocks) * size;
+
+	gettimeofday(&start, NULL);
+	fd = fhopenread(file->name, ft, fs);
+	fhseek(fd, offset, SEEK_SET, ft, fs);
+	fhread(fd, buf, size, ft, fs);
+	fhclose(fd, ft, fs);
+	gettimeofday(&end, NULL);
+
+	rw_unlock_read(&file->lock);
+
+	ft_incr_op(ft, opnum, 1, size);
+	ft_add_readbytes(ft, size);
+	ft_add_lsm_get(ft, tvdiff_usec(&start, &end));
+}
+
+void ffsb_lsm_flush_print_exl(struct ffsb_op_results *results, double secs,
+			      unsigned op_num)
+{
+	char buf[256];
+
+	printf("%s: %u SSTs, %s flushed\n", op_get_name(op_num),
+	       results->ops[op_num],
+	       ffsb_printsize(buf, results->bytes[op_num], 256));
+}
+
+void ffsb_lsm_compact_print_exl(struct ffsb_op_results *results,
+				double secs, unsigned op_num)
+{
+	int flush = ops_find_op("lsm_flush");
+	uint64_t moved = results->bytes[op_num];
+	double busy = (double)results->lsm_compact_usec / 1000000.0;
+	char buf[256], rate[256];
+
+	printf("%s: %u compactions, %s merged, %s/sec while compacting\n",
+	       op_get_name(op_num), results->ops[op_num],
+	       ffsb_printsize(buf, moved, 256),
+	       ffsb_printsize(rate, busy ? 2 * moved / busy : 0, 256));
+
+	/* Only meaningful where flushes and compactions were both
+	 * counted, which is usually just the total
+	 */
+	if (results->bytes[flush])
+		printf("%s: write amplification %.2lf\n", op_get_name(op_num),
+		       (double)(results->bytes[flush] + moved) /
+		       results->bytes[flush]);
+}
+
+void ffsb_lsm_get_print_exl(struct ffsb_op_results *results, double secs,
+			    unsigned op_num)
+{
+	ffsb_hist_t *h = &results->lsm_get_lat;
+
+	printf("%s: %u lookups, latency avg %.3lf p50 %.3lf p95 %.3lf "
+	       "p99 %.3lf max %.3lf msec\n", op_get_name(op_num),
+	       results->ops[op_num], ffsb_hist_mean(h) / 1000.0,
+	       ffsb_hist_percentile(h, 50.0) / 1000.0,
+	       ffsb_hist_percentile(h, 95.0) / 1000.0,
+	       ffsb_hist_percentile(h, 99.0) / 1000.0, h->max / 1000.0);
+}
+
+static struct lsm_tree *lsm_create(ffsb_fs_t *fs)
+{
+	struct lsm_tree *tree = ffsb_malloc(sizeof(struct lsm_tree));
+	char buf[FILENAME_MAX * 3];
+	char dir[FILENAME_MAX], name[16];
+	unsigned i;
+
+	memset(tree, 0, sizeof(struct lsm_tree));
+	pthread_mutex_init(&tree->lock, NULL);
+	pthread_cond_init(&tree->work, NULL);
+	tree->sst_size = fs->lsm_sst_size;
+	tree->fanout = fs->lsm_fanout;
+	tree->l0_files = fs->lsm_l0_files;
+	tree->num_levels = fs->lsm_levels;
+
+	/* Nothing survives from an earlier run, reuse or not */
+	snprintf(dir, FILENAME_MAX, "%s/%s", fs->basedir, LSM_BASE);
+	snprintf(buf, FILENAME_MAX * 3, "rm -rf %s", dir);
+	if (ffsb_system(buf) < 0) {
+		perror(buf);
+		exit(1);
+	}
+	ffsb_mkdir(dir);
+
+	for (i = 0; i < tree->num_levels; i++) {
+		snprintf(name, sizeof(name), "L%u", i);
+		snprintf(dir, FILENAME_MAX, "%s/%s/%s", fs->basedir,
+			 LSM_BASE, name);
+		init_filelist(&tree->levels[i].bf, dir, name, 0, 1);
+	}
+	return tree;
+}
+
+void lsm_bench(ffsb_fs_t *fs, unsigned opnum)
+{
+	if (!fs_get_op_used(fs, opnum))
+		return;
+	if (fs->lsm == NULL)
+		fs->lsm = lsm_create(fs);
+	fs_set_opdata(fs, fs->lsm, opnum);
+}
+
+void lsm_destroy(ffsb_fs_t *fs)
+{
+	struct lsm_tree *tree = fs->lsm;
+	unsigned i;
+
+	if (tree == NULL)
+		return;
+
+	for (i = 0; i < tree->num_levels; i++) {
+		destroy_filelist(&tree->levels[i].bf);
+		free(tree->levels[i].ssts);
+	}
+	free(tree);
+	fs->lsm = NULL;
+}
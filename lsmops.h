@@ -0,0 +1,50 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef _LSMOPS_H_
+#define _LSMOPS_H_
+
+#include "ffsb.h"
+#include "fileops.h"
+
+/* The lsm ops emulate the i/o of a leveled LSM-tree key-value store.
+ * lsm_flush writes a memtable out as a new L0 SST, lsm_compact merges
+ * a level that is over its target size into the next one (reading
+ * the inputs a block at a time in turn, as a merge would, writing
+ * the merged output and deleting the inputs) and lsm_get reads one
+ * block from the SST holding a key.
+ * All three share one tree per filesystem, so flush, compaction and
+ * foreground threads are simply threadgroups weighted on these ops.
+ */
+void ffsb_lsm_flush(struct ffsb_thread *, ffsb_fs_t *, unsigned);
+void ffsb_lsm_compact(struct ffsb_thread *, ffsb_fs_t *, unsigned);
+void ffsb_lsm_get(struct ffsb_thread *, ffsb_fs_t *, unsigned);
+
+void ffsb_lsm_flush_print_exl(struct ffsb_op_results *, double secs,
+			      unsigned op_num);
+void ffsb_lsm_compact_print_exl(struct ffsb_op_results *, double secs,
+				unsigned op_num);
+void ffsb_lsm_get_print_exl(struct ffsb_op_results *, double secs,
+			    unsigned op_num);
+
+/* Builds the per-fs tree under <basedir>/lsm, only if some
+ * threadgroup uses the op
+ */
+void lsm_bench(ffsb_fs_t *fs, unsigned opnum);
+void lsm_destroy(ffsb_fs_t *fs);
+
+#endif /* _LSMOPS_H_ */
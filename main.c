@@ -33,124 +33,142 @@
 #include "ffsb.h"
 #include "util.h"
 #include "parser.h"
+#include "oplog.h"
+#include "ramp.h"
 
 /* State information for the polling function below */
 struct ffsb_time_poll {
 	struct timeval starttime;
-	int wait_time;
+	uint64_t start;		/* nsecs */
+	ffsb_config_t *fc;
+
+	/* When the measurement starts, 0 until the main thread knows
+	 * (it waits for steady state)
+	 */
+	uint64_t measure;
+
+	/* When the measurement ended, because its time was up or the
+	 * stop target was reached (reached is set), 0 until then
+	 */
+	uint64_t done;
+	int reached;
 };
 
+/* Whether the threads have done the work the phase stops after */
+static int ffsb_stop_reached(ffsb_config_t *fc)
+{
+	ffsb_stop_t *stop = &fc->stop;
+	uint64_t ops[FFSB_NUMOPS], total = 0, bytes = 0;
+	int i;
+
+	memset(ops, 0, sizeof(ops));
+	for (i = 0; i < fc->num_threadgroups; i++)
+		tg_add_progress(&fc->groups[i], ops, &bytes);
+
+	for (i = 0; i < FFSB_NUMOPS; i++) {
+		if (stop->op[i] && ops[i] >= stop->op[i])
+			return 1;
+		total += ops[i];
+	}
+	return (stop->ops && total >= stop->ops) ||
+		(stop->bytes && bytes >= stop->bytes);
+}
+
 /* This is the polling function used by the threadgroups to check
- * elapsed time, when it returns 1 they know it is time to stop
+ * elapsed time, when it returns 1 they know it is time to stop.  The
+ * main thread also calls it to see when the measurement is over.
  */
 static int ffsb_poll_fn(void *ptr)
 {
 	struct ffsb_time_poll *data = (struct ffsb_time_poll *)ptr;
-	struct timeval curtime, difftime;
-	gettimeofday(&curtime, NULL);
+	ffsb_config_t *fc = data->fc;
+	uint64_t now = ffsb_clock_nsec();
+	uint64_t measure = data->measure;
+	uint64_t end = measure + fc->time * 1000000000ULL;
 
-	timersub(&curtime, &data->starttime, &difftime);
-	if (difftime.tv_sec >= data->wait_time)
-		return 1;
-	return 0;
+	if (!measure)
+		return 0;
+	if (!data->done) {
+		if (fc->time && now >= end)
+			__sync_bool_compare_and_swap(&data->done, 0, end);
+		else if (fc->stop.set && now >= measure &&
+			 ffsb_stop_reached(fc) &&
+			 __sync_bool_compare_and_swap(&data->done, 0, now))
+			data->reached = 1;
+	}
+	return data->done &&
+		now >= data->done + fc->cooldown * 1000000000ULL;
 }
 
-int main(int argc, char *argv[])
+/* What a phase did, for the sweep table */
+struct run_summary {
+	double secs;
+	double trans;			/* per sec */
+	double read;			/* bytes per sec */
+	double write;
+};
+
+static void set_window(ffsb_config_t *fc, int window)
 {
 	int i;
-	ffsb_config_t fc;
+
+	for (i = 0; i < fc->num_threadgroups; i++)
+		tg_set_window(&fc->groups[i], window);
+}
+
+/* Runs the current phase's threadgroups and prints their results.
+ * With a warmup, steady state rounds or a cooldown only the time in
+ * between is measured.
+ */
+static void run_phase(ffsb_config_t *fc, struct run_summary *sum)
+{
+	int i;
+	int windows = (fc->warmup || fc->cooldown || fc->steady.window);
+	int warmup = (fc->warmup || fc->steady.window);
+	unsigned steady_rounds = 0;
+	struct timeval measure_start, measure_end;
 	ffsb_barrier_t thread_barrier, tg_barrier;
 	tg_run_params_t *params;
 	struct ffsb_time_poll pdata;
-	struct timeval starttime, endtime, difftime;
+	struct timeval endtime, difftime;
 	pthread_attr_t attr;
 	ffsb_op_results_t total_results;
 	double totaltime = 0.0f, usertime = 0.0f, systime = 0.0f;
 	struct rusage before_self, before_children, after_self, after_children;
-	pthread_t *fs_pts; /* threads to do filesystem creates in parallel */
-	char *callout = NULL;
 
 	char ctime_start_buf[32];
 	char ctime_end_buf[32];
 
+	memset(&measure_start, 0, sizeof(measure_start));
+	memset(&measure_end, 0, sizeof(measure_end));
 	memset(&before_self, 0, sizeof(before_self));
 	memset(&before_children, 0, sizeof(before_children));
 	memset(&after_self, 0, sizeof(after_self));
 	memset(&after_children, 0, sizeof(after_children));
 
-	ffsb_unbuffer_stdout();
-
-	if (argc < 2) {
-		fprintf(stderr, "usage: %s <config file>\n",
-			argv[0]);
-		exit(1);
-	}
-
-	/* VERSION comes from config.h (which is autogenerated by autoconf) */
-	printf("FFSB version %s started\n\n", VERSION);
-
-	ffsb_parse_newconfig(&fc, argv[1]);
-	pdata.wait_time = fc.time;
-
-	if (fc.time)
-		printf("benchmark time = %u\n", fc.time);
-	 else
-		printf("Only creating the fileset, not running benchmark.\n");
-
 	pthread_attr_init(&attr);
 	pthread_attr_setscope(&attr, PTHREAD_SCOPE_SYSTEM);
 
-	for (i = 0; i < fc.num_threadgroups; i++)
-		tg_print_config(&fc.groups[i]);
-
-	fs_pts = ffsb_malloc(sizeof(pthread_t) * fc.num_filesys);
-
-	gettimeofday(&starttime, NULL);
-	for (i = 0; i < fc.num_filesys; i++) {
-		fs_print_config(&fc.filesystems[i]);
-		pthread_create(fs_pts + i, &attr, construct_ffsb_fs,
-			       &fc.filesystems[i]);
-	}
-
-	fflush(stdout);
-	for (i = 0; i < fc.num_filesys; i++)
-		pthread_join(fs_pts[i], NULL);
-
-	gettimeofday(&endtime, NULL);
-	timersub(&endtime, &starttime, &difftime);
-	printf("fs setup took %ld secs\n", difftime.tv_sec);
-	free(fs_pts);
-
-	if (fc.time == 0) {
-		printf("Setup complete, exiting\n");
-		return 0;
-	}
-
-	params = ffsb_malloc(sizeof(tg_run_params_t) * fc.num_threadgroups);
+	memset(&pdata, 0, sizeof(pdata));
+	pdata.fc = fc;
+	if (warmup)
+		set_window(fc, FFSB_WINDOW_WARMUP);
+	params = ffsb_malloc(sizeof(tg_run_params_t) * fc->num_threadgroups);
 
 	init_ffsb_op_results(&total_results);
-	ffsb_barrier_init(&thread_barrier, fc.num_totalthreads);
-	ffsb_barrier_init(&tg_barrier, fc.num_threadgroups + 1);
+	ffsb_barrier_init(&thread_barrier, fc->num_totalthreads);
+	ffsb_barrier_init(&tg_barrier, fc->num_threadgroups + 1);
 
 	ffsb_sync();
 
-	/* Execute the callout if any and wait for it to return */
-	callout = fc_get_callout(&fc);
-	if (callout) {
-		printf("executing callout: \n %s\n", callout);
-		if (ffsb_system(callout) < 0) {
-			perror("system");
-			exit(1);
-		}
-	}
-
 	/* Spawn all of the threadgroup master threads */
-	for (i = 0; i < fc.num_threadgroups; i++) {
-		params[i].tg = &fc.groups[i];
-		params[i].fc = &fc;
+	for (i = 0; i < fc->num_threadgroups; i++) {
+		params[i].tg = &fc->groups[i];
+		params[i].fc = fc;
 		params[i].poll_fn = ffsb_poll_fn;
 		params[i].poll_data = &pdata;
-		params[i].wait_time = FFSB_TG_WAIT_TIME;
+		/* poll often enough to stop close to the target */
+		params[i].wait_time = fc->stop.set ? 0 : FFSB_TG_WAIT_TIME;
 		params[i].tg_barrier = &tg_barrier;
 		params[i].thread_barrier = &thread_barrier;
 
@@ -159,19 +177,46 @@ int main(int argc, char *argv[])
 
 	ffsb_getrusage(&before_self, &before_children);
 	gettimeofday(&pdata.starttime, NULL);
+	pdata.start = ffsb_clock_nsec();
+	if (!fc->steady.window)
+		pdata.measure = pdata.start + fc->warmup * 1000000000ULL;
 
 	ffsb_barrier_wait(&tg_barrier);  /* sync with tg's to start*/
 	printf("Starting Actual Benchmark At: %s\n",
 	       ctime_r(&pdata.starttime.tv_sec, ctime_start_buf));
 	fflush(stdout);
 
+	if (windows) {
+		if (fc->warmup)
+			ffsb_sleep_until(pdata.start +
+					 fc->warmup * 1000000000ULL);
+		if (fc->steady.window) {
+			steady_rounds = steady_wait(&fc->steady, fc,
+				pdata.start + fc->warmup * 1000000000ULL);
+			pdata.measure = ffsb_clock_nsec();
+		}
+		if (warmup)
+			set_window(fc, FFSB_WINDOW_MEASURE);
+		gettimeofday(&measure_start, NULL);
+		ffsb_getrusage(&before_self, &before_children);
+
+		while (!pdata.done) {
+			ffsb_milli_sleep(FFSB_TG_POLL_MSEC);
+			ffsb_poll_fn(&pdata);
+		}
+		set_window(fc, FFSB_WINDOW_COOLDOWN);
+		gettimeofday(&measure_end, NULL);
+		ffsb_getrusage(&after_self, &after_children);
+	}
+
 	/* Wait for all of the threadgroup master threads to finish */
-	for (i = 0; i < fc.num_threadgroups; i++)
+	for (i = 0; i < fc->num_threadgroups; i++)
 		pthread_join(params[i].pt, NULL);
 
 	ffsb_sync();
 	gettimeofday(&endtime, NULL);
-	ffsb_getrusage(&after_self, &after_children);
+	if (!windows)
+		ffsb_getrusage(&after_self, &after_children);
 
 	printf("FFSB benchmark finished   at: %s\n",
 	       ctime_r(&endtime.tv_sec, ctime_end_buf));
@@ -183,18 +228,41 @@ int main(int argc, char *argv[])
 	totaltime = tvtodouble(&difftime);
 
 	printf("Benchmark took %.2lf sec\n", totaltime);
+	if (windows) {
+		timersub(&measure_end, &measure_start, &difftime);
+		totaltime = tvtodouble(&difftime);
+		printf("Measured %.2lf sec, leaving out %.2lf sec of warmup "
+		       "and %u sec of cooldown\n", totaltime,
+		       (pdata.measure - pdata.start) / 1000000000.0,
+		       fc->cooldown);
+		if (steady_rounds)
+			printf("Steady state reached after %u rounds\n",
+			       steady_rounds);
+		else if (fc->steady.window)
+			printf("Steady state not reached, measured after "
+			       "%u rounds\n", fc->steady.max_rounds);
+		printf("Measurement started at: %s",
+		       ctime_r(&measure_start.tv_sec, ctime_start_buf));
+		printf("Measurement ended   at: %s",
+		       ctime_r(&measure_end.tv_sec, ctime_end_buf));
+	}
+	if (pdata.reached)
+		printf("Stop target reached after %.2lf sec\n",
+		       (pdata.done - pdata.measure) / 1000000000.0);
+	else if (fc->stop.set)
+		printf("Stop target not reached in %u sec\n", fc->time);
 	printf("\n");
 
-	for (i = 0; i < fc.num_threadgroups; i++) {
+	for (i = 0; i < fc->num_threadgroups; i++) {
 		struct ffsb_op_results tg_results;
-		ffsb_tg_t *tg = fc.groups + i;
+		ffsb_tg_t *tg = fc->groups + i;
 
 		init_ffsb_op_results(&tg_results);
 
 		/* Grab the individual tg results */
 		tg_collect_results(tg, &tg_results);
 
-		if (fc.num_threadgroups == 1)
+		if (fc->num_threadgroups == 1)
 			printf("Total Results\n");
 		else
 			printf("ThreadGroup %d\n", i);
@@ -208,17 +276,27 @@ int main(int argc, char *argv[])
 			ffsb_statsd_print(&fsd);
 		}
 		printf("\n");
+		if (tg_get_ramp(tg))
+			ramp_print(tg_get_ramp(tg));
 
 		/* Add the tg results to the total */
-		tg_collect_results(&fc.groups[i], &total_results);
+		tg_collect_results(&fc->groups[i], &total_results);
 	}
 
-	if (fc.num_threadgroups > 1) {
+	if (fc->num_threadgroups > 1) {
 		printf("Total Results\n");
 		printf("===============\n");
 		print_results(&total_results, totaltime);
 	}
 
+	sum->secs = totaltime;
+	sum->trans = 0;
+	for (i = 0; i < FFSB_NUMOPS; i++)
+		sum->trans += total_results.ops[i];
+	sum->trans /= totaltime;
+	sum->read = total_results.read_bytes / totaltime;
+	sum->write = total_results.write_bytes / totaltime;
+
 #define USEC_PER_SEC ((double)(1000000.0f))
 
 	/* sum up self and children after */
@@ -252,6 +330,225 @@ int main(int argc, char *argv[])
 	printf("%.1f%% CPU Utilization\n", 100 * (usertime + systime) /
 	       totaltime);
 	free(params);
+}
+
+static void print_stop(ffsb_stop_t *stop)
+{
+	int i;
+
+	if (!stop->set)
+		return;
+	printf("stop after");
+	if (stop->ops)
+		printf(" %llu ops", (unsigned long long)stop->ops);
+	if (stop->bytes)
+		printf(" %llu bytes", (unsigned long long)stop->bytes);
+	for (i = 0; i < FFSB_NUMOPS; i++)
+		if (stop->op[i])
+			printf(" %llu %s", (unsigned long long)stop->op[i],
+			       op_get_name(i));
+	printf(", whichever comes first\n");
+}
+
+static void print_phase_header(ffsb_config_t *fc, unsigned num)
+{
+	ffsb_phase_t *ph = &fc->phases[num];
+
+	printf("Phase %u", num);
+	if (ph->name)
+		printf(" (%s)", ph->name);
+	printf(", time = %u\n", ph->time);
+	print_stop(&ph->stop);
+	steady_print_config(&ph->steady);
+	printf("================\n");
+}
+
+static unsigned sweep_value(ffsb_config_t *fc, unsigned run, unsigned num)
+{
+	unsigned i, div = fc->num_runs;
+
+	for (i = 0; i <= num; i++)
+		div /= fc->sweeps[i].num_values;
+	return (run / div) % fc->sweeps[num].num_values;
+}
+
+static void print_sweep_header(ffsb_config_t *fc, unsigned run)
+{
+	ffsb_sweep_t *sw;
+	unsigned i;
+
+	printf("\nSweep run %u of %u:", run + 1, fc->num_runs);
+	for (i = 0; i < fc->num_sweeps; i++) {
+		sw = &fc->sweeps[i];
+		printf(" %s=%s", sw->option,
+		       sw->values[sweep_value(fc, run, i)]);
+	}
+	printf("\n================\n");
+}
+
+/* One line per run and phase */
+static void print_sweep_table(ffsb_config_t *fc, struct run_summary *sums)
+{
+	struct run_summary *sum;
+	ffsb_sweep_t *sw;
+	unsigned r, p, i;
+	char buf[256], buf2[256];
+
+	printf("\nSweep Results\n");
+	printf("===============\n");
+	printf("%5s", "run");
+	for (i = 0; i < fc->num_sweeps; i++)
+		printf(" %14s", fc->sweeps[i].option);
+	if (fc->num_phases > 1)
+		printf(" %10s", "phase");
+	printf(" %10s %12s %12s %12s\n", "secs", "trans/sec", "read/sec",
+	       "write/sec");
+
+	for (r = 0; r < fc->num_runs; r++) {
+		for (p = 0; p < fc->num_phases; p++) {
+			sum = &sums[r * fc->num_phases + p];
+			printf("%5u", r + 1);
+			for (i = 0; i < fc->num_sweeps; i++) {
+				sw = &fc->sweeps[i];
+				printf(" %14s",
+				       sw->values[sweep_value(fc, r, i)]);
+			}
+			if (fc->num_phases > 1)
+				printf(" %10s", fc->phases[p].name ?
+				       fc->phases[p].name : "");
+			printf(" %10.2lf %12.2lf %12s %12s\n", sum->secs,
+			       sum->trans,
+			       ffsb_printsize(buf, sum->read, 256),
+			       ffsb_printsize(buf2, sum->write, 256));
+		}
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int i, p;
+	unsigned r;
+	struct run_summary *sums;
+	ffsb_config_t fc;
+	struct timeval starttime, endtime, difftime;
+	pthread_attr_t attr;
+	pthread_t *fs_pts; /* threads to do filesystem creates in parallel */
+	char *callout = NULL;
+
+	ffsb_unbuffer_stdout();
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <config file>\n",
+			argv[0]);
+		exit(1);
+	}
+
+	/* VERSION comes from config.h (which is autogenerated by autoconf) */
+	printf("FFSB version %s started\n\n", VERSION);
+
+	ffsb_parse_newconfig(&fc, argv[1]);
+
+	if (fc.num_runs > 1) {
+		printf("%u runs, sweeping", fc.num_runs);
+		for (i = 0; i < fc.num_sweeps; i++)
+			printf(" %s", fc.sweeps[i].option);
+		printf("\n");
+	}
+
+	if (fc.num_phases > 1)
+		printf("%u phases\n", fc.num_phases);
+	else if (fc.time || fc.stop.set) {
+		if (fc.time)
+			printf("benchmark time = %u\n", fc.time);
+		print_stop(&fc.stop);
+		steady_print_config(&fc.steady);
+	} else
+		printf("Only creating the fileset, not running benchmark.\n");
+
+	pthread_attr_init(&attr);
+	pthread_attr_setscope(&attr, PTHREAD_SCOPE_SYSTEM);
+
+	for (p = 0; p < fc.num_phases; p++) {
+		fc_set_phase(&fc, p);
+		if (fc.num_phases > 1)
+			print_phase_header(&fc, p);
+		for (i = 0; i < fc.num_threadgroups; i++)
+			tg_print_config(&fc.groups[i]);
+	}
+
+	fs_pts = ffsb_malloc(sizeof(pthread_t) * fc.num_filesys);
+
+	gettimeofday(&starttime, NULL);
+	for (i = 0; i < fc.num_filesys; i++) {
+		fs_print_config(&fc.filesystems[i]);
+		pthread_create(fs_pts + i, &attr, construct_ffsb_fs,
+			       &fc.filesystems[i]);
+	}
+
+	fflush(stdout);
+	for (i = 0; i < fc.num_filesys; i++)
+		pthread_join(fs_pts[i], NULL);
+
+	gettimeofday(&endtime, NULL);
+	timersub(&endtime, &starttime, &difftime);
+	printf("fs setup took %ld secs\n", difftime.tv_sec);
+	free(fs_pts);
+
+	fc_set_phase(&fc, 0);
+	if (fc.time == 0 && !fc.stop.set) {
+		printf("Setup complete, exiting\n");
+		return 0;
+	}
+
+	/* Execute the callout if any and wait for it to return */
+	callout = fc_get_callout(&fc);
+	if (callout) {
+		printf("executing callout: \n %s\n", callout);
+		if (ffsb_system(callout) < 0) {
+			perror("system");
+			exit(1);
+		}
+	}
+
+	/* The fileset carries over from one phase to the next, and from
+	 * one run of a sweep to the next
+	 */
+	sums = ffsb_malloc(sizeof(*sums) * fc.num_runs * fc.num_phases);
+	for (r = 0; r < fc.num_runs; r++) {
+		if (r) {
+			ffsb_sweep_config(&fc, r);
+
+			/* The run may use ops the last one didn't, and
+			 * its replays are new
+			 */
+			for (i = 0; i < fc.num_filesys; i++) {
+				if (fc.sweep_reage)
+					fs_reage(&fc.filesystems[i]);
+				ops_setup_bench(&fc.filesystems[i]);
+			}
+		}
+		if (fc.num_runs > 1)
+			print_sweep_header(&fc, r);
+		if (fc.sweep_drop_caches)
+			ffsb_drop_caches();
+
+		for (p = 0; p < fc.num_phases; p++) {
+			fc_set_phase(&fc, p);
+			if (fc.num_phases > 1) {
+				printf("\n");
+				print_phase_header(&fc, p);
+			}
+			run_phase(&fc, &sums[r * fc.num_phases + p]);
+		}
+	}
+	if (fc.num_runs > 1)
+		print_sweep_table(&fc, sums);
+	free(sums);
+
+	if (oplog_get_diverged())
+		printf("\noplog: %u file choices diverged from the "
+		       "recording\n", oplog_get_diverged());
+
 	destroy_ffsb_config(&fc);
 
 	return 0;
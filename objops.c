@@ -0,0 +1,348 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#define _LARGEFILE64_SOURCE
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include "ffsb.h"
+#include "objops.h"
+#include "fh.h"
+#include "util.h"
+
+#define OBJ_BASE "objects"
+#define OBJ_TMP  "tmp"
+
+/* 128-bit hashes, as hex */
+#define OBJ_HASH_LEN 32
+
+/* Objects are struct ffsb_files, the lock keeps an object from being
+ * deleted while it's read
+ */
+struct obj_store {
+	pthread_mutex_t lock;
+	char *basedir;
+	unsigned levels;
+
+	struct ffsb_file **objs;
+	unsigned count, size;
+
+	/* Objects get hashed from a unique number */
+	uint32_t next_id;
+};
+
+/* splitmix64 finalizer, enough to spread names evenly over the
+ * fan-out directories
+ */
+static uint64_t mix64(uint64_t x)
+{
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+/* Builds "<basedir>/aa/bb/<hash>", the directory part is the
+ * leading levels * 2 characters of the path's tail
+ */
+static char *obj_name(struct obj_store *os, uint32_t id)
+{
+	char hash[OBJ_HASH_LEN + 1];
+	char buf[FILENAME_MAX];
+	int len;
+	unsigned i;
+
+	snprintf(hash, sizeof(hash), "%016llx%016llx",
+		 (unsigned long long)mix64(id),
+		 (unsigned long long)mix64(~(uint64_t)id));
+
+	len = snprintf(buf, FILENAME_MAX, "%s", os->basedir);
+	for (i = 0; i < os->levels; i++)
+		len += snprintf(buf + len, FILENAME_MAX - len, "/%.2s",
+				hash + 2 * i);
+	snprintf(buf + len, FILENAME_MAX - len, "/%s", hash);
+	return ffsb_strdup(buf);
+}
+
+/* Creates the fan-out directories above name, other threads may be
+ * racing us for them
+ */
+static void obj_mkdirs(char *name)
+{
+	char *p = name;
+
+	while ((p = strchr(p + 1, '/')) != NULL) {
+		*p = '\0';
+		if (mkdir(name, S_IRWXU) < 0 && errno != EEXIST) {
+			perror(name);
+			exit(1);
+		}
+		*p = '/';
+	}
+}
+
+static struct ffsb_file *obj_new(struct obj_store *os, uint64_t size)
+{
+	struct ffsb_file *obj = ffsb_malloc(sizeof(struct ffsb_file));
+
+	pthread_mutex_lock(&os->lock);
+	obj->num = os->next_id++;
+	pthread_mutex_unlock(&os->lock);
+
+	obj->name = obj_name(os, obj->num);
+	obj->size = size;
+	init_rwlock(&obj->lock);
+	return obj;
+}
+
+static void obj_insert(struct obj_store *os, struct ffsb_file *obj)
+{
+	pthread_mutex_lock(&os->lock);
+	if (os->count == os->size) {
+		os->size = os->size ? os->size * 2 : 1024;
+		os->objs = ffsb_realloc(os->objs,
+					os->size * sizeof(struct ffsb_file *));
+	}
+	os->objs[os->count++] = obj;
+	pthread_mutex_unlock(&os->lock);
+}
+
+static void obj_free(struct ffsb_file *obj)
+{
+	free(obj->name);
+	free(obj);
+}
+
+void ffsb_obj_put(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
+{
+	struct obj_store *os = (struct obj_store *)fs_get_opdata(fs, opnum);
+	randdata_t *rd = ft_get_randdata(ft);
+	char tmpname[FILENAME_MAX];
+	struct ffsb_file *obj;
+	struct timeval start, end;
+	uint64_t size;
+	int fd;
+
+	size = choose_create_size(fs, rd);
+	obj = obj_new(os, size);
+	snprintf(tmpname, FILENAME_MAX, "%s/%s/%llu", os->basedir, OBJ_TMP,
+		 (unsigned long long)obj->num);
+
+	gettimeofday(&start, NULL);
+
+	fd = fhopencreate(tmpname, ft, fs);
+	writefile_helper(fd, size, ft_get_write_blocksize(ft), ft_getbuf(ft),
+			 ft, fs);
+	fhfsync(fd, ft, fs);
+	fhclose(fd, ft, fs);
+
+	if (fhrename(tmpname, obj->name, ft, fs) < 0) {
+		obj_mkdirs(obj->name);
+		if (fhrename(tmpname, obj->name, ft, fs) < 0) {
+			perror(obj->name);
+			exit(1);
+		}
+	}
+
+	gettimeofday(&end, NULL);
+
+	obj_insert(os, obj);
+
+	ft_incr_op(ft, opnum, 1, size);
+	ft_add_writebytes(ft, size);
+	ft_add_obj_lat(ft, 0, tvdiff_usec(&start, &end));
+}
+
+void ffsb_obj_get(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
+{
+	struct obj_store *os = (struct obj_store *)fs_get_opdata(fs, opnum);
+	randdata_t *rd = ft_get_randdata(ft);
+	uint32_t blocksize = ft_get_read_blocksize(ft);
+	char *buf = ft_getbuf(ft);
+	struct ffsb_file *obj;
+	struct timeval start, end;
+	uint64_t left;
+	int fd;
+
+	pthread_mutex_lock(&os->lock);
+	if (os->count == 0) {
+		pthread_mutex_unlock(&os->lock);
+		ft_incr_op(ft, opnum, 0, 0);
+		return;
+	}
+	obj = os->objs[getrandom(rd, os->count)];
+	rw_lock_read(&obj->lock);
+	pthread_mutex_unlock(&os->lock);
+
+	gettimeofday(&start, NULL);
+
+	fd = fhopenread(obj->name, ft, fs);
+	for (left = obj->size; left > blocksize; left -= blocksize)
+		fhread(fd, buf, blocksize, ft, fs);
+	if (left)
+		fhread(fd, buf, left, ft, fs);
+	fhclose(fd, ft, fs);
+
+	gettimeofday(&end, NULL);
+
+	ft_incr_op(ft, opnum, 1, obj->size);
+	ft_add_readbytes(ft, obj->size);
+	ft_add_obj_lat(ft, 1, tvdiff_usec(&start, &end));
+
+	rw_unlock_read(&obj->lock);
+}
+
+void ffsb_obj_delete(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
+{
+	struct obj_store *os = (struct obj_store *)fs_get_opdata(fs, opnum);
+	randdata_t *rd = ft_get_randdata(ft);
+	struct ffsb_file *obj;
+	struct timeval start, end;
+	unsigned idx;
+
+	pthread_mutex_lock(&os->lock);
+	if (os->count == 0) {
+		pthread_mutex_unlock(&os->lock);
+		ft_incr_op(ft, opnum, 0, 0);
+		return;
+	}
+	idx = getrandom(rd, os->count);
+	obj = os->objs[idx];
+	os->objs[idx] = os->objs[--os->count];
+	pthread_mutex_unlock(&os->lock);
+
+	/* wait out any obj_get still reading it */
+	rw_lock_write(&obj->lock);
+
+	gettimeofday(&start, NULL);
+	if (unlink(obj->name) < 0) {
+		perror(obj->name);
+		exit(1);
+	}
+	gettimeofday(&end, NULL);
+
+	do_stats(&start, &end, ft, fs, SYS_UNLINK);
+
+	ft_incr_op(ft, opnum, 1, 0);
+	ft_add_obj_lat(ft, 2, tvdiff_usec(&start, &end));
+
+	rw_unlock_write(&obj->lock);
+	obj_free(obj);
+}
+
+void ffsb_obj_print_exl(struct ffsb_op_results *results, double secs,
+			unsigned op_num)
+{
+	ffsb_hist_t *h = &results->obj_lat[op_num - ops_find_op("obj_put")];
+
+	printf("%s: %.2lf objects/sec, latency avg %.3lf p50 %.3lf "
+	       "p95 %.3lf p99 %.3lf max %.3lf msec\n", op_get_name(op_num),
+	       results->ops[op_num] / secs, ffsb_hist_mean(h) / 1000.0,
+	       ffsb_hist_percentile(h, 50.0) / 1000.0,
+	       ffsb_hist_percentile(h, 95.0) / 1000.0,
+	       ffsb_hist_percentile(h, 99.0) / 1000.0, h->max / 1000.0);
+}
+
+/* Initial objects go straight to their final name, there's nothing
+ * to measure yet
+ */
+static void obj_populate(ffsb_fs_t *fs, struct obj_store *os)
+{
+	uint32_t blocksize = fs_get_create_blocksize(fs);
+	char *buf = ffsb_malloc(blocksize);
+	int has_directio = fs_get_directio(fs);
+	struct ffsb_file *obj;
+	randdata_t rd;
+	uint32_t i;
+	int fd;
+
+	if (has_directio)
+		fs_set_directio(fs, 0);
+	init_random(&rd, 0);
+
+	for (i = 0; i < fs->num_objects; i++) {
+		obj = obj_new(os, choose_create_size(fs, &rd));
+		obj_mkdirs(obj->name);
+		fd = fhopencreate(obj->name, NULL, fs);
+		writefile_helper(fd, obj->size, blocksize, buf, NULL, fs);
+		fhclose(fd, NULL, fs);
+		obj_insert(os, obj);
+	}
+
+	destroy_random(&rd);
+	if (has_directio)
+		fs_set_directio(fs, 1);
+	free(buf);
+}
+
+static struct obj_store *obj_create(ffsb_fs_t *fs)
+{
+	struct obj_store *os = ffsb_malloc(sizeof(struct obj_store));
+	char buf[FILENAME_MAX * 3];
+
+	memset(os, 0, sizeof(struct obj_store));
+	pthread_mutex_init(&os->lock, NULL);
+	os->levels = fs->obj_levels;
+
+	snprintf(buf, FILENAME_MAX, "%s/%s", fs->basedir, OBJ_BASE);
+	os->basedir = ffsb_strdup(buf);
+
+	/* Objects aren't kept across runs */
+	snprintf(buf, FILENAME_MAX * 3, "rm -rf %s", os->basedir);
+	if (ffsb_system(buf) < 0) {
+		perror(buf);
+		exit(1);
+	}
+	ffsb_mkdir(os->basedir);
+	snprintf(buf, FILENAME_MAX, "%s/%s", os->basedir, OBJ_TMP);
+	ffsb_mkdir(buf);
+
+	obj_populate(fs, os);
+	return os;
+}
+
+void obj_bench(ffsb_fs_t *fs, unsigned opnum)
+{
+	if (!fs_get_op_used(fs, opnum))
+		return;
+	if (fs->objects == NULL)
+		fs->objects = obj_create(fs);
+	fs_set_opdata(fs, fs->objects, opnum);
+}
+
+void obj_destroy(ffsb_fs_t *fs)
+{
+	struct obj_store *os = fs->objects;
+	unsigned i;
+
+	if (os == NULL)
+		return;
+
+	for (i = 0; i < os->count; i++)
+		obj_free(os->objs[i]);
+	free(os->objs);
+	free(os->basedir);
+	free(os);
+	fs->objects = NULL;
+}
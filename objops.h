@@ -0,0 +1,47 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef _OBJOPS_H_
+#define _OBJOPS_H_
+
+#include "ffsb.h"
+#include "fileops.h"
+
+/* The obj ops emulate a content-addressed object store.  Objects are
+ * named by a 128-bit hash and stored under obj_levels levels of
+ * 256-way fan-out directories named after the leading hash bytes,
+ * e.g. objects/3f/a0/3fa0...  Directories are created the first time
+ * an object needs them.
+ *
+ * obj_put writes the object to a temporary file, fsyncs it and
+ * renames it into place.  obj_get reads a whole object, obj_delete
+ * unlinks one.  Sizes come from size_weight (or min/max_filesize).
+ */
+void ffsb_obj_put(struct ffsb_thread *, ffsb_fs_t *, unsigned);
+void ffsb_obj_get(struct ffsb_thread *, ffsb_fs_t *, unsigned);
+void ffsb_obj_delete(struct ffsb_thread *, ffsb_fs_t *, unsigned);
+
+void ffsb_obj_print_exl(struct ffsb_op_results *, double secs,
+			unsigned op_num);
+
+/* Builds the store under <basedir>/objects, with num_objects initial
+ * objects, only if some threadgroup uses the op
+ */
+void obj_bench(ffsb_fs_t *fs, unsigned opnum);
+void obj_destroy(ffsb_fs_t *fs);
+
+#endif /* _OBJOPS_H_ */
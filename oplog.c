@@ -0,0 +1,184 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "oplog.h"
+#include "util.h"
+
+#define OPLOG_MAGIC "FFSBOPL1"
+#define OPLOG_BUFSIZE (1024 * 1024)
+
+struct oplog {
+	FILE *f;
+	char *name;
+	int replay;
+	int eof;
+	uint64_t entries;
+	char *buf;
+};
+
+static pthread_mutex_t diverged_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned diverged;
+
+static void put_varint(FILE *f, uint64_t v)
+{
+	do {
+		uint8_t byte = v & 0x7f;
+
+		v >>= 7;
+		if (v)
+			byte |= 0x80;
+		putc(byte, f);
+	} while (v);
+}
+
+/* Returns 0 at end of file */
+static int get_varint(FILE *f, uint64_t *v)
+{
+	int c, shift = 0;
+
+	*v = 0;
+	do {
+		c = getc(f);
+		if (c == EOF)
+			return 0;
+		*v |= (uint64_t)(c & 0x7f) << shift;
+		shift += 7;
+	} while (c & 0x80);
+	return 1;
+}
+
+struct oplog *oplog_open(char *prefix, int replay, unsigned tg,
+			 unsigned thread)
+{
+	struct oplog *log = ffsb_malloc(sizeof(struct oplog));
+	char name[FILENAME_MAX];
+	char magic[sizeof(OPLOG_MAGIC)];
+	uint64_t logtg, logthread;
+
+	snprintf(name, FILENAME_MAX, "%s.%u.%u", prefix, tg, thread);
+	memset(log, 0, sizeof(struct oplog));
+	log->name = ffsb_strdup(name);
+	log->replay = replay;
+	log->f = fopen(name, replay ? "r" : "w");
+	if (log->f == NULL) {
+		perror(name);
+		exit(1);
+	}
+	log->buf = ffsb_malloc(OPLOG_BUFSIZE);
+	setvbuf(log->f, log->buf, _IOFBF, OPLOG_BUFSIZE);
+
+	if (!replay) {
+		fwrite(OPLOG_MAGIC, 1, strlen(OPLOG_MAGIC), log->f);
+		put_varint(log->f, tg);
+		put_varint(log->f, thread);
+		return log;
+	}
+
+	memset(magic, 0, sizeof(magic));
+	if (fread(magic, 1, strlen(OPLOG_MAGIC), log->f) !=
+	    strlen(OPLOG_MAGIC) || strcmp(magic, OPLOG_MAGIC) ||
+	    !get_varint(log->f, &logtg) || !get_varint(log->f, &logthread)) {
+		printf("Error: %s is not an oplog\n", name);
+		exit(1);
+	}
+	if (logtg != tg || logthread != thread) {
+		printf("Error: %s was recorded by threadgroup %llu thread "
+		       "%llu\n", name, (unsigned long long)logtg,
+		       (unsigned long long)logthread);
+		exit(1);
+	}
+	return log;
+}
+
+void oplog_close(struct oplog *log)
+{
+	if (!log)
+		return;
+	if (fclose(log->f)) {
+		perror(log->name);
+		exit(1);
+	}
+	free(log->buf);
+	free(log->name);
+	free(log);
+}
+
+int oplog_replaying(struct oplog *log)
+{
+	return log && log->replay;
+}
+
+int oplog_done(struct oplog *log)
+{
+	int c;
+
+	if (!oplog_replaying(log))
+		return 0;
+	if (log->eof)
+		return 1;
+	c = getc(log->f);
+	if (c == EOF) {
+		log->eof = 1;
+		return 1;
+	}
+	ungetc(c, log->f);
+	return 0;
+}
+
+void oplog_put(struct oplog *log, int kind, uint64_t value)
+{
+	if (!log || log->replay)
+		return;
+	put_varint(log->f, value << 2 | kind);
+	log->entries++;
+}
+
+uint64_t oplog_get(struct oplog *log, int kind)
+{
+	uint64_t v;
+
+	if (!get_varint(log->f, &v)) {
+		printf("Error: %s ended in the middle of an op, after %llu "
+		       "entries\n", log->name,
+		       (unsigned long long)log->entries);
+		exit(1);
+	}
+	if ((v & 3) != kind) {
+		printf("Error: %s doesn't match this profile at entry "
+		       "%llu\n", log->name, (unsigned long long)log->entries);
+		exit(1);
+	}
+	log->entries++;
+	return v >> 2;
+}
+
+void oplog_diverged(struct oplog *log)
+{
+	pthread_mutex_lock(&diverged_lock);
+	diverged++;
+	pthread_mutex_unlock(&diverged_lock);
+}
+
+unsigned oplog_get_diverged(void)
+{
+	return diverged;
+}
@@ -0,0 +1,59 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef _OPLOG_H_
+#define _OPLOG_H_
+
+#include <inttypes.h>
+
+/* The oplog records every decision a thread makes -- which op on
+ * which fs, which file, and every other random number (offsets,
+ * sizes, directories...) -- so a later run can make exactly the same
+ * ones.  Each thread has its own log, <prefix>.<tg>.<thread>, a short
+ * header followed by one LEB128 varint per decision, the value
+ * shifted left two bits with its kind in the low bits.
+ *
+ * When replaying, decisions are read back instead of drawn.  A thread
+ * whose log runs out stops issuing ops.  File choices wait for the
+ * logged file if another thread holds it; if this run's interleaving
+ * has deleted it, a random file is used instead and the divergence is
+ * counted.
+ */
+#define OPLOG_RAND 0
+#define OPLOG_OP   1
+#define OPLOG_FS   2
+#define OPLOG_FILE 3
+
+struct oplog;
+
+/* Exits if the log can't be opened, or isn't the one for tg/thread */
+struct oplog *oplog_open(char *prefix, int replay, unsigned tg,
+			 unsigned thread);
+void oplog_close(struct oplog *);
+
+/* These all accept a NULL log, which records nothing */
+int oplog_replaying(struct oplog *);
+int oplog_done(struct oplog *);
+void oplog_put(struct oplog *, int kind, uint64_t value);
+
+/* Next logged value, which must be of this kind */
+uint64_t oplog_get(struct oplog *, int kind);
+
+void oplog_diverged(struct oplog *);
+unsigned oplog_get_diverged(void);
+
+#endif /* _OPLOG_H_ */
@@ -0,0 +1,295 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#define _LARGEFILE64_SOURCE
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ffsb.h"
+#include "pageops.h"
+#include "fh.h"
+#include "util.h"
+
+#define PAGE_BASE "pages"
+
+/* Dirty pages are tracked in units of the smallest page we allow */
+#define PAGE_UNIT 4096
+
+struct page_file {
+	char *name;
+	int fd;
+
+	/* One byte per PAGE_UNIT, and a clean spare that is swapped
+	 * in when a checkpoint starts
+	 */
+	uint8_t *dirty;
+	uint8_t *spare;
+};
+
+struct page_store {
+	pthread_mutex_t lock;
+
+	/* Only one checkpoint runs at a time */
+	pthread_mutex_t ckpt_lock;
+
+	/* Bumped when a checkpoint starts and when it ends, so it is
+	 * odd while one is running.  Page ops only peek at it.
+	 */
+	volatile unsigned ckpt_gen;
+
+	unsigned num_files;
+	uint64_t file_size;
+	struct page_file *files;
+};
+
+static void page_io(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum,
+		    int write)
+{
+	struct page_store *ps = (struct page_store *)fs_get_opdata(fs, opnum);
+	randdata_t *rd = ft_get_randdata(ft);
+	uint32_t size = ft_get_page_size(ft);
+	char *buf = ft_getbuf(ft);
+	struct page_file *pf;
+	struct timeval start, end;
+	uint64_t offset;
+	unsigned gen;
+	int during;
+
+	pf = &ps->files[getrandom(rd, ps->num_files)];
+	offset = getllrandom(rd, ps->file_size / size) * size;
+
+	gen = ps->ckpt_gen;
+	gettimeofday(&start, NULL);
+	if (write)
+		fhpwrite(pf->fd, buf, size, offset, ft, fs);
+	else
+		fhpread(pf->fd, buf, size, offset, ft, fs);
+	gettimeofday(&end, NULL);
+	during = (gen & 1) || gen != ps->ckpt_gen;
+
+	if (write) {
+		pthread_mutex_lock(&ps->lock);
+		memset(pf->dirty + offset / PAGE_UNIT, 1, size / PAGE_UNIT);
+		pthread_mutex_unlock(&ps->lock);
+		ft_add_writebytes(ft, size);
+	} else
+		ft_add_readbytes(ft, size);
+
+	ft_incr_op(ft, opnum, 1, size);
+	ft_add_page_lat(ft, write, during, tvdiff_usec(&start, &end));
+}
+
+void ffsb_page_read(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
+{
+	page_io(ft, fs, opnum, 0);
+}
+
+void ffsb_page_write(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
+{
+	page_io(ft, fs, opnum, 1);
+}
+
+/* Writes out the dirty runs of one file, returns the bytes written */
+static uint64_t checkpoint_file(ffsb_thread_t *ft, ffsb_fs_t *fs,
+				struct page_store *ps, struct page_file *pf)
+{
+	uint64_t units = ps->file_size / PAGE_UNIT;
+	uint64_t max_units = ft_get_write_blocksize(ft) / PAGE_UNIT;
+	char *buf = ft_getbuf(ft);
+	uint64_t i = 0, run, written = 0;
+
+	while (i < units) {
+		if (!pf->spare[i]) {
+			i++;
+			continue;
+		}
+		for (run = 1; i + run < units && run < max_units; run++)
+			if (!pf->spare[i + run])
+				break;
+
+		fhpwrite(pf->fd, buf, run * PAGE_UNIT, i * PAGE_UNIT, ft, fs);
+		written += run * PAGE_UNIT;
+		i += run;
+	}
+
+	if (written)
+		fhfsync(pf->fd, ft, fs);
+	memset(pf->spare, 0, units);
+	return written;
+}
+
+void ffsb_checkpoint(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
+{
+	struct page_store *ps = (struct page_store *)fs_get_opdata(fs, opnum);
+	struct timeval start, end;
+	uint64_t written = 0;
+	unsigned i;
+
+	pthread_mutex_lock(&ps->ckpt_lock);
+
+	gettimeofday(&start, NULL);
+
+	/* Everything dirtied from here on belongs to the next one */
+	pthread_mutex_lock(&ps->lock);
+	for (i = 0; i < ps->num_files; i++) {
+		uint8_t *tmp = ps->files[i].dirty;
+		ps->files[i].dirty = ps->files[i].spare;
+		ps->files[i].spare = tmp;
+	}
+	ps->ckpt_gen++;
+	pthread_mutex_unlock(&ps->lock);
+
+	for (i = 0; i < ps->num_files; i++)
+		written += checkpoint_file(ft, fs, ps, &ps->files[i]);
+
+	ps->ckpt_gen++;
+	gettimeofday(&end, NULL);
+
+	pthread_mutex_unlock(&ps->ckpt_lock);
+
+	ft_incr_op(ft, opnum, 1, written);
+	ft_add_writebytes(ft, written);
+	ft_add_checkpoint(ft, tvdiff_usec(&start, &end));
+}
+
+static void print_lat(ffsb_hist_t *h, char *when)
+{
+	printf("\t%s checkpoints: %llu ops, avg %.3lf msec, "
+	       "p99 %.3lf msec, max %.3lf msec\n", when,
+	       (unsigned long long)h->count,
+	       ffsb_hist_mean(h) / 1000.0,
+	       ffsb_hist_percentile(h, 99.0) / 1000.0, h->max / 1000.0);
+}
+
+void ffsb_page_print_exl(struct ffsb_op_results *results, double secs,
+			 unsigned op_num)
+{
+	int write = (op_num == ops_find_op("page_write"));
+
+	printf("%s latency:\n", op_get_name(op_num));
+	print_lat(&results->page_lat[write][0], "outside");
+	print_lat(&results->page_lat[write][1], " during");
+}
+
+void ffsb_checkpoint_print_exl(struct ffsb_op_results *results,
+			       double secs, unsigned op_num)
+{
+	unsigned ckpts = results->ops[op_num];
+	char buf[256];
+
+	printf("%s: %u checkpoints, %s written, avg %.2lf sec each\n",
+	       op_get_name(op_num), ckpts,
+	       ffsb_printsize(buf, results->bytes[op_num], 256),
+	       (double)results->checkpoint_usec / ckpts / 1000000.0);
+}
+
+/* The data files are written out in full so page reads hit real
+ * blocks rather than holes.  That's setup, not the benchmark, so
+ * they're written buffered whatever the fs is set to, and not
+ * counted in its stats.
+ */
+static void page_create_file(ffsb_fs_t *fs, char *name, uint64_t size)
+{
+	uint32_t blocksize = fs_get_create_blocksize(fs);
+	char *buf = ffsb_malloc(blocksize);
+	int fd;
+
+	memset(buf, 0, blocksize);
+	fd = open(name, O_CREAT | O_WRONLY | O_TRUNC | O_LARGEFILE, 0644);
+	if (fd < 0) {
+		perror(name);
+		exit(1);
+	}
+	writefile_helper(fd, size, blocksize, buf, NULL, NULL);
+	fhfsync(fd, NULL, NULL);
+	fhclose(fd, NULL, NULL);
+	free(buf);
+}
+
+static struct page_store *page_create(ffsb_fs_t *fs)
+{
+	struct page_store *ps = ffsb_malloc(sizeof(struct page_store));
+	char buf[FILENAME_MAX];
+	struct stat st;
+	uint64_t units;
+	unsigned i;
+
+	memset(ps, 0, sizeof(struct page_store));
+	pthread_mutex_init(&ps->lock, NULL);
+	pthread_mutex_init(&ps->ckpt_lock, NULL);
+	ps->num_files = fs->page_files;
+	ps->file_size = fs->page_file_size;
+	ps->files = ffsb_malloc(ps->num_files * sizeof(struct page_file));
+
+	snprintf(buf, FILENAME_MAX, "%s/%s", fs->basedir, PAGE_BASE);
+	ffsb_mkdir(buf);
+
+	units = ps->file_size / PAGE_UNIT;
+	for (i = 0; i < ps->num_files; i++) {
+		struct page_file *pf = &ps->files[i];
+
+		snprintf(buf, FILENAME_MAX, "%s/%s/%s%u", fs->basedir,
+			 PAGE_BASE, PAGE_BASE, i);
+		pf->name = ffsb_strdup(buf);
+
+		if (!fs_get_reuse_fs(fs) || stat(pf->name, &st) ||
+		    st.st_size != ps->file_size)
+			page_create_file(fs, pf->name, ps->file_size);
+
+		pf->fd = fhopenrw(pf->name, NULL, fs);
+		pf->dirty = ffsb_malloc(units);
+		pf->spare = ffsb_malloc(units);
+		memset(pf->dirty, 0, units);
+		memset(pf->spare, 0, units);
+	}
+	return ps;
+}
+
+void page_bench(ffsb_fs_t *fs, unsigned opnum)
+{
+	if (!fs_get_op_used(fs, opnum))
+		return;
+	if (fs->pages == NULL)
+		fs->pages = page_create(fs);
+	fs_set_opdata(fs, fs->pages, opnum);
+}
+
+void page_destroy(ffsb_fs_t *fs)
+{
+	struct page_store *ps = fs->pages;
+	unsigned i;
+
+	if (ps == NULL)
+		return;
+
+	for (i = 0; i < ps->num_files; i++) {
+		close(ps->files[i].fd);
+		free(ps->files[i].name);
+		free(ps->files[i].dirty);
+		free(ps->files[i].spare);
+	}
+	free(ps->files);
+	free(ps);
+	fs->pages = NULL;
+}
@@ -0,0 +1,47 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef _PAGEOPS_H_
+#define _PAGEOPS_H_
+
+#include "ffsb.h"
+#include "fileops.h"
+
+/* The page ops emulate a buffer-pool database on top of a few large
+ * preallocated data files per filesystem.  page_read and page_write
+ * do random page_size i/o anywhere in them, page writes are also
+ * remembered as dirty.  checkpoint writes every page dirtied since
+ * the last one back out in offset order, coalesced into ranges of up
+ * to write_blocksize, then fsyncs each file.  Page latencies are kept
+ * apart depending on whether a checkpoint was running at the time.
+ */
+void ffsb_page_read(struct ffsb_thread *, ffsb_fs_t *, unsigned);
+void ffsb_page_write(struct ffsb_thread *, ffsb_fs_t *, unsigned);
+void ffsb_checkpoint(struct ffsb_thread *, ffsb_fs_t *, unsigned);
+
+void ffsb_page_print_exl(struct ffsb_op_results *, double secs,
+			 unsigned op_num);
+void ffsb_checkpoint_print_exl(struct ffsb_op_results *, double secs,
+			       unsigned op_num);
+
+/* Creates (or with reuse, keeps) the data files under
+ * <basedir>/pages, only if some threadgroup uses the op
+ */
+void page_bench(ffsb_fs_t *fs, unsigned opnum);
+void page_destroy(ffsb_fs_t *fs);
+
+#endif /* _PAGEOPS_H_ */
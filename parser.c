@@ -27,6 +27,12 @@
 #include "ffsb_stats.h"
 #include "util.h"
 #include "list.h"
+#include "verify.h"
+#include "replayops.h"
+#include "oplog.h"
+#include "schedule.h"
+#include "burst.h"
+#include "ramp.h"
 
 #define BUFSIZE 1024
 
@@ -34,6 +40,8 @@ config_options_t global_options[] = GLOBAL_OPTIONS;
 config_options_t tg_options[] = THREADGROUP_OPTIONS;
 config_options_t fs_options[] = FILESYSTEM_OPTIONS;
 config_options_t stats_options[] = STATS_OPTIONS;
+config_options_t schedule_options[] = SCHEDULE_OPTIONS;
+config_options_t phase_options[] = PHASE_OPTIONS;
 container_desc_t container_desc[] = CONTAINER_DESC;
 
 /* strips out whitespace and comments, returns NULL on eof */
@@ -204,8 +212,9 @@ static char *get_optstr(char *buf, char string[])
 	sprintf(search_str, "%s=%%%ds\\n", string, BUFSIZE - len-1);
 	if (1 == sscanf(line, search_str, &temp)) {
 		len = strnlen(temp, 4096);
-		ret_buf = malloc(len);
-		strncpy(ret_buf, temp, len);
+		ret_buf = malloc(len + 1);
+		memcpy(ret_buf, temp, len);
+		ret_buf[len] = '\0';
 		return ret_buf;
 		}
 	free(line);
@@ -313,6 +322,7 @@ static container_t *init_container(void)
 	container = malloc(sizeof(container_t));
 	container->config = NULL;
 	container->type = 0;
+	container->child = NULL;
 	container->next = NULL;
 	return container;
 }
@@ -502,6 +512,22 @@ container_t *search_group(char *buf, FILE *f)
 								desc->type,
 								options);
 					break;
+				case SCHEDULE:
+					options = malloc(sizeof(schedule_options));
+					memcpy(options, schedule_options,
+					       sizeof(schedule_options));
+					return handle_container(buf, f,
+								desc->type,
+								options);
+					break;
+				case PHASE:
+					options = malloc(sizeof(phase_options));
+					memcpy(options, phase_options,
+					       sizeof(phase_options));
+					return handle_container(buf, f,
+								desc->type,
+								options);
+					break;
 				case END:
 					ret_container = init_container();
 					ret_container->type = END;
@@ -575,6 +601,7 @@ static profile_config_t *parse(FILE *f)
 	memcpy(profile_conf->global, global_options, sizeof(global_options));
 	profile_conf->fs_container = NULL;
 	profile_conf->tg_container = NULL;
+	profile_conf->phase_container = NULL;
 	int is_option;
 	buf = get_next_line(f);
 
@@ -597,6 +624,13 @@ static profile_config_t *parse(FILE *f)
 					insert_container(profile_conf->tg_container,
 							 tmp_container);
 				break;
+			case PHASE:
+				if (profile_conf->phase_container == NULL)
+					profile_conf->phase_container = tmp_container;
+				else
+					insert_container(profile_conf->phase_container,
+							 tmp_container);
+				break;
 			default:
 				break;
 			}
@@ -669,6 +703,26 @@ static int verify_tg(ffsb_tg_t *tg)
 	uint32_t delete_weight    = tg_get_op_weight(tg, "delete");
 	uint32_t writeall_weight = tg_get_op_weight(tg, "writeall");
 	uint32_t writeall_fsync_weight = tg_get_op_weight(tg, "writeall_fsync");
+	uint32_t create_tmpfile_weight = tg_get_op_weight(tg, "create_tmpfile");
+	uint32_t create_tmpfile_fsync_weight =
+		tg_get_op_weight(tg, "create_tmpfile_fsync");
+
+	uint32_t lock_weight = tg_get_op_weight(tg, "lock");
+	uint32_t flock_weight = tg_get_op_weight(tg, "flock");
+	uint32_t rmw_weight = tg_get_op_weight(tg, "rmw");
+	uint32_t rmw_fdatasync_weight = tg_get_op_weight(tg, "rmw_fdatasync");
+	uint32_t scan_weight = tg_get_op_weight(tg, "scan");
+	uint32_t lsm_flush_weight = tg_get_op_weight(tg, "lsm_flush");
+	uint32_t lsm_compact_weight = tg_get_op_weight(tg, "lsm_compact");
+	uint32_t lsm_get_weight = tg_get_op_weight(tg, "lsm_get");
+	uint32_t page_read_weight = tg_get_op_weight(tg, "page_read");
+	uint32_t page_write_weight = tg_get_op_weight(tg, "page_write");
+	uint32_t checkpoint_weight = tg_get_op_weight(tg, "checkpoint");
+	uint32_t obj_put_weight = tg_get_op_weight(tg, "obj_put");
+	uint32_t obj_get_weight = tg_get_op_weight(tg, "obj_get");
+	uint32_t stream_read_weight = tg_get_op_weight(tg, "stream_read");
+	uint32_t stream_write_weight = tg_get_op_weight(tg, "stream_write");
+	uint32_t replay_weight = tg_get_op_weight(tg, "replay");
 
 	uint32_t sum_weight = get_weight_total(tg);
 	
@@ -685,25 +739,114 @@ static int verify_tg(ffsb_tg_t *tg)
 		return 1;
 	}
 
-	if ((read_weight || readall_weight) && !(read_blocksize)) {
-		printf("Error: read and readall operations require a "
-		       "read_blocksize\n");
+	if ((read_weight || readall_weight || scan_weight ||
+	     lsm_get_weight || obj_get_weight || stream_read_weight) &&
+	    !(read_blocksize)) {
+		printf("Error: read, readall, scan, lsm_get, obj_get and "
+		       "stream_read operations require a read_blocksize\n");
 		return 1;
 	}
 
 	if ((write_weight || create_weight || append_weight || writeall_weight 
-	     || writeall_fsync_weight) && !(write_blocksize)) {
-		printf("Error: write, writeall, create, append"
+	     || writeall_fsync_weight || create_tmpfile_weight ||
+	     create_tmpfile_fsync_weight || lsm_flush_weight ||
+	     lsm_compact_weight || obj_put_weight || stream_write_weight) &&
+	    !(write_blocksize)) {
+		printf("Error: write, writeall, create, create_tmpfile, append"
+		       ", lsm_flush, lsm_compact, obj_put and stream_write "
 		       "operations require a write_blocksize\n");
 		return 1;
 	}
 
+	if (lock_weight || flock_weight) {
+		uint32_t write_percent = tg_get_lock_write_percent(tg);
+
+		if (tg_get_lock_overlap(tg) > 100 || write_percent > 100) {
+			printf("Error: lock_overlap and lock_write_percent "
+			       "are percentages, they can't exceed 100\n");
+			return 1;
+		}
+		if (tg_get_lock_io(tg) &&
+		    ((write_percent < 100 && !read_blocksize) ||
+		     (write_percent > 0 && !write_blocksize))) {
+			printf("Error: lock_io requires a read_blocksize for "
+			       "read locks and a write_blocksize for write "
+			       "locks\n");
+			return 1;
+		}
+	}
+
+	if ((rmw_weight || rmw_fdatasync_weight) &&
+	    !(tg_get_rmw_recordsize(tg))) {
+		printf("Error: rmw operations require a rmw_recordsize\n");
+		return 1;
+	}
+
+	if ((page_read_weight || page_write_weight) &&
+	    tg_get_page_size(tg) % 4096) {
+		printf("Error: page_size must be a multiple of 4096\n");
+		return 1;
+	}
+
+	if (checkpoint_weight && (!write_blocksize || write_blocksize % 4096)) {
+		printf("Error: checkpoint operations require a write_blocksize "
+		       "that is a multiple of 4096\n");
+		return 1;
+	}
+
+	if ((stream_read_weight || stream_write_weight) &&
+	    !(tg_get_stream_rate(tg))) {
+		printf("Error: stream operations require a stream_rate\n");
+		return 1;
+	}
+
+	if (replay_weight && !tg_get_replay(tg)) {
+		printf("Error: replay operations require a replay_trace\n");
+		return 1;
+	}
+
+	if (tg_get_replay(tg) && replay_weight != sum_weight) {
+		printf("Error: a replay_trace threadgroup can only run "
+		       "replay operations\n");
+		return 1;
+	}
+
+	/* Open loop threads don't think between ops, they wait for the
+	 * next arrival
+	 */
+	if (tg_get_arrival_rate(tg) > 0 &&
+	    tg_get_thinktime(tg)->type != FFSB_THINK_NONE) {
+		printf("Error: arrival_rate can't be combined with op_delay "
+		       "or think_time\n");
+		return 1;
+	}
+
 	if (read_random && read_skip) {
 		printf("Error: read_random and read_skip are mutually "
 		       "exclusive\n");
 		return 1;
 	}
 
+	if (tg->read_offsets.type != FFSB_OFF_DEFAULT &&
+	    (read_random || read_skip)) {
+		printf("Error: read_offsets replaces read_random and "
+		       "read_skip, don't combine them\n");
+		return 1;
+	}
+
+	if (tg->write_offsets.type != FFSB_OFF_DEFAULT &&
+	    tg_get_write_random(tg)) {
+		printf("Error: write_offsets replaces write_random, "
+		       "don't combine them\n");
+		return 1;
+	}
+
+	if (read_skip && tg->size_dists[FFSB_READ_BLOCKSIZE].type !=
+	    FFSB_SIZE_FIXED) {
+		printf("Error: read_skip needs a fixed read_blocksize\n");
+		return 1;
+	}
+
 	if (read_skip && !(read_skipsize)) {
 		printf("Error: read_skip specified but read_skipsize is "
 		       "zero\n");
@@ -733,28 +876,6 @@ static unsigned get_num_filesystems(profile_config_t *profile_conf)
 	return get_num_containers(profile_conf->fs_container);
 }
 
-static int get_num_totalthreads(profile_config_t *profile_conf)
-{
-	int num_threads = 0;
-	container_t *tg = profile_conf->tg_container;
-	config_options_t *tg_config;
-
-	while (tg) {
-		tg_config = tg->config;
-		while (tg_config->name) {
-			if (!strcmp(tg_config->name, "num_threads"))
-				num_threads += *(uint32_t *) tg_config->value;
-			tg_config++;
-		}
-		if (tg->next)
-			tg = tg->next;
-		else
-			break;
-	}
-
-	return num_threads;
-}
-
 container_t *get_container(container_t *head_cont, int pos)
 {
 	int count = 0;
@@ -801,14 +922,502 @@ container_t *get_tg_container(ffsb_config_t *fc, int pos)
 	return get_container(fc->profile_conf->tg_container, pos);
 }
 
+static void init_file_popularity(ffsb_tg_t *tg, config_options_t *config)
+{
+	char *name = get_config_str(config, "file_popularity");
+	ffsb_popularity_t pop;
+
+	memset(&pop, 0, sizeof(pop));
+	if (name) {
+		pop.type = ffsb_popularity_type(name);
+		if (pop.type < 0) {
+			printf("Error: unknown file_popularity %s, use uniform,"
+			       " zipf, hotspot, exponential or sequential\n",
+			       name);
+			exit(1);
+		}
+	}
+
+	if (get_config_double(config, "file_zipf_theta"))
+		ffsb_zipf_init(&pop.zipf,
+			       get_config_double(config, "file_zipf_theta"));
+	else
+		ffsb_zipf_init(&pop.zipf, FFSB_POP_DEFAULT_ZIPF_THETA);
+	if (pop.zipf.theta <= 0 || pop.zipf.theta >= 1) {
+		printf("Error: file_zipf_theta must be between 0 and 1\n");
+		exit(1);
+	}
+
+	if (get_config_u32(config, "file_hot_ops"))
+		pop.hot_ops = get_config_u32(config, "file_hot_ops");
+	else
+		pop.hot_ops = FFSB_POP_DEFAULT_HOT_OPS;
+	if (get_config_u32(config, "file_hot_files"))
+		pop.hot_files = get_config_u32(config, "file_hot_files");
+	else
+		pop.hot_files = FFSB_POP_DEFAULT_HOT_FILES;
+	if (pop.hot_ops > 100 || pop.hot_files > 100) {
+		printf("Error: file_hot_ops and file_hot_files are "
+		       "percentages, they can't exceed 100\n");
+		exit(1);
+	}
+
+	if (get_config_double(config, "file_exp_mean"))
+		pop.exp_mean = get_config_double(config, "file_exp_mean");
+	else
+		pop.exp_mean = FFSB_POP_DEFAULT_EXP_MEAN;
+	if (pop.exp_mean < 0) {
+		printf("Error: file_exp_mean must be positive\n");
+		exit(1);
+	}
+
+	tg_set_file_popularity(tg, &pop);
+}
+
+static int offsets_type(config_options_t *config, char *option)
+{
+	char *name = get_config_str(config, option);
+	int type;
+
+	if (!name)
+		return FFSB_OFF_DEFAULT;
+	type = ffsb_offsets_type(name);
+	if (type < 0) {
+		printf("Error: unknown %s %s, use default, zipf, hotregion,"
+		       " streams or strided\n", option, name);
+		exit(1);
+	}
+	return type;
+}
+
+static void init_offsets(ffsb_tg_t *tg, config_options_t *config)
+{
+	ffsb_offsets_t off, read, write;
+
+	memset(&off, 0, sizeof(off));
+
+	if (get_config_double(config, "offset_zipf_theta"))
+		ffsb_zipf_init(&off.zipf,
+			       get_config_double(config, "offset_zipf_theta"));
+	else
+		ffsb_zipf_init(&off.zipf, FFSB_POP_DEFAULT_ZIPF_THETA);
+	if (off.zipf.theta <= 0 || off.zipf.theta >= 1) {
+		printf("Error: offset_zipf_theta must be between 0 and 1\n");
+		exit(1);
+	}
+
+	if (get_config_u32(config, "offset_hot_ops"))
+		off.hot_ops = get_config_u32(config, "offset_hot_ops");
+	else
+		off.hot_ops = FFSB_POP_DEFAULT_HOT_OPS;
+	if (get_config_u32(config, "offset_hot_region"))
+		off.hot_region = get_config_u32(config, "offset_hot_region");
+	else
+		off.hot_region = FFSB_POP_DEFAULT_HOT_FILES;
+	if (off.hot_ops > 100 || off.hot_region > 100) {
+		printf("Error: offset_hot_ops and offset_hot_region are "
+		       "percentages, they can't exceed 100\n");
+		exit(1);
+	}
+
+	if (get_config_u32(config, "offset_streams"))
+		off.streams = get_config_u32(config, "offset_streams");
+	else
+		off.streams = FFSB_OFF_DEFAULT_STREAMS;
+	if (off.streams > FFSB_OFF_MAX_STREAMS) {
+		printf("Error: offset_streams can't exceed %d\n",
+		       FFSB_OFF_MAX_STREAMS);
+		exit(1);
+	}
+
+	off.stride = get_config_u64(config, "offset_stride");
+	off.jitter = get_config_u64(config, "offset_jitter");
+
+	read = write = off;
+	read.type = offsets_type(config, "read_offsets");
+	write.type = offsets_type(config, "write_offsets");
+	tg_set_offsets(tg, &read, &write);
+}
+
+static void sizedist_error(char *option, char *spec)
+{
+	printf("Error: bad %s %s, use uniform:<min>:<max>, "
+	       "lognormal:<median>:<sigma>:<max> or "
+	       "bimodal:<small>:<large>:<percent small>\n", option, spec);
+	exit(1);
+}
+
+/* The <name>_weight list or <name>_dist string for one of read_size,
+ * read_blocksize, write_size or write_blocksize.  Returns the largest
+ * size it can draw, or 0 if neither was given.
+ */
+static uint64_t init_sizedist(ffsb_sizedist_t *sd, config_options_t *config,
+			      char *name, uint32_t align)
+{
+	value_list_t *tmp_list, *list_head;
+	char option[64], *spec, *copy, *args[4];
+	int nargs = 0;
+	unsigned i;
+
+	memset(sd, 0, sizeof(*sd));
+	sd->align = align;
+
+	sprintf(option, "%s_weight", name);
+	list_head = (value_list_t *)get_value(config, option);
+	sprintf(option, "%s_dist", name);
+	spec = get_config_str(config, option);
+
+	if (list_head && spec) {
+		printf("Error: give either %s_weight or %s_dist\n", name,
+		       name);
+		exit(1);
+	}
+
+	if (list_head) {
+		sd->type = FFSB_SIZE_WEIGHTED;
+		list_for_each_entry(tmp_list, &list_head->list, list)
+			sd->num_weights++;
+		sd->sizes = ffsb_malloc(sizeof(uint64_t) * sd->num_weights);
+		sd->weights = ffsb_malloc(sizeof(unsigned) * sd->num_weights);
+
+		i = 0;
+		list_for_each_entry(tmp_list, &list_head->list, list) {
+			size_weight_t *sizew = tmp_list->value;
+
+			if (!sizew->size || sizew->weight <= 0) {
+				printf("Error: %s_weight needs a size and a "
+				       "positive weight\n", name);
+				exit(1);
+			}
+			sd->sizes[i] = sizew->size;
+			sd->weights[i] = sizew->weight;
+			sd->sum_weights += sizew->weight;
+			sd->max = max(sd->max, sizew->size);
+			i++;
+		}
+		return sd->max;
+	}
+
+	if (!spec)
+		return 0;
+
+	copy = ffsb_strdup(spec);
+	for (args[0] = strtok(copy, ":"); args[nargs] && nargs < 3; )
+		args[++nargs] = strtok(NULL, ":");
+	if (args[nargs])
+		nargs++;
+
+	sd->type = args[0] ? ffsb_sizedist_type(args[0]) : -1;
+	switch (sd->type) {
+	case FFSB_SIZE_UNIFORM:
+		if (nargs != 3)
+			sizedist_error(option, spec);
+		sd->min = size64_convert(args[1]);
+		sd->max = size64_convert(args[2]);
+		break;
+	case FFSB_SIZE_LOGNORMAL:
+		if (nargs != 4)
+			sizedist_error(option, spec);
+		sd->median = size64_convert(args[1]);
+		sd->sigma = atof(args[2]);
+		sd->max = size64_convert(args[3]);
+		sd->min = sd->median;
+		if (sd->sigma <= 0)
+			sizedist_error(option, spec);
+		break;
+	case FFSB_SIZE_BIMODAL:
+		if (nargs != 4)
+			sizedist_error(option, spec);
+		sd->min = size64_convert(args[1]);
+		sd->max = size64_convert(args[2]);
+		sd->percent = atoi(args[3]);
+		if (sd->percent > 100)
+			sizedist_error(option, spec);
+		break;
+	default:
+		sizedist_error(option, spec);
+	}
+	if (!sd->min || sd->min > sd->max)
+		sizedist_error(option, spec);
+
+	free(copy);
+	return sd->max;
+}
+
+static void init_sizedists(ffsb_config_t *fc, ffsb_tg_t *tg,
+			   config_options_t *config)
+{
+	uint32_t align = 0;
+	uint64_t max;
+
+	if (get_config_bool(fc->profile_conf->global, "alignio"))
+		align = 4096;
+
+	max = init_sizedist(&tg->size_dists[FFSB_READ_SIZE], config,
+			    "read_size", align);
+	if (max)
+		tg->read_size = max;
+	max = init_sizedist(&tg->size_dists[FFSB_WRITE_SIZE], config,
+			    "write_size", align);
+	if (max)
+		tg->write_size = max;
+
+	max = init_sizedist(&tg->size_dists[FFSB_READ_BLOCKSIZE], config,
+			    "read_blocksize", align);
+	if (max > UINT32_MAX) {
+		printf("Error: read_blocksize can't exceed 4GB\n");
+		exit(1);
+	}
+	if (max)
+		tg_set_read_blocksize(tg, max);
+	max = init_sizedist(&tg->size_dists[FFSB_WRITE_BLOCKSIZE], config,
+			    "write_blocksize", align);
+	if (max > UINT32_MAX) {
+		printf("Error: write_blocksize can't exceed 4GB\n");
+		exit(1);
+	}
+	if (max)
+		tg_set_write_blocksize(tg, max);
+}
+
+static void thinktime_error(char *spec)
+{
+	printf("Error: bad think_time %s, use fixed:<usec>, "
+	       "exponential:<mean usec>, uniform:<min usec>:<max usec>, "
+	       "lognormal:<median usec>:<sigma> or empirical:<file>\n",
+	       spec);
+	exit(1);
+}
+
+/* think_time, or op_delay as a fixed one */
+static void init_thinktime(ffsb_tg_t *tg, config_options_t *config)
+{
+	char *spec = get_config_str(config, "think_time");
+	char *copy, *arg, *arg2;
+	ffsb_thinktime_t tt;
+
+	memset(&tt, 0, sizeof(tt));
+	if (spec && tg->wait_time) {
+		printf("Error: give either op_delay or think_time\n");
+		exit(1);
+	}
+
+	if (tg->wait_time) {
+		tt.type = FFSB_THINK_FIXED;
+		tt.a = tg->wait_time * 1000.0;
+	}
+
+	if (spec) {
+		copy = ffsb_strdup(spec);
+		arg = strchr(copy, ':');
+		if (!arg)
+			thinktime_error(spec);
+		*arg++ = '\0';
+		arg2 = strchr(arg, ':');
+		tt.type = ffsb_thinktime_type(copy);
+
+		switch (tt.type) {
+		case FFSB_THINK_FIXED:
+		case FFSB_THINK_EXPONENTIAL:
+			if (arg2)
+				thinktime_error(spec);
+			tt.a = atof(arg);
+			break;
+		case FFSB_THINK_UNIFORM:
+		case FFSB_THINK_LOGNORMAL:
+			if (!arg2)
+				thinktime_error(spec);
+			*arg2++ = '\0';
+			tt.a = atof(arg);
+			if (tt.type == FFSB_THINK_UNIFORM)
+				tt.b = atof(arg2);
+			else
+				tt.sigma = atof(arg2);
+			if (tt.b < tt.a && tt.type == FFSB_THINK_UNIFORM)
+				thinktime_error(spec);
+			if (tt.sigma <= 0 && tt.type == FFSB_THINK_LOGNORMAL)
+				thinktime_error(spec);
+			break;
+		case FFSB_THINK_EMPIRICAL:
+			ffsb_thinktime_load(&tt, arg);
+			break;
+		default:
+			thinktime_error(spec);
+		}
+		if (tt.a < 0)
+			thinktime_error(spec);
+		free(copy);
+	}
+
+	tg_set_thinktime(tg, &tt);
+}
+
+/* Open loop ops, instead of each thread going as fast as it can */
+static void init_arrivals(ffsb_tg_t *tg, config_options_t *config)
+{
+	double rate = get_config_double(config, "arrival_rate");
+	char *process = get_config_str(config, "arrival_process");
+	int poisson = 1;
+
+	if (process && !strcmp(process, "constant"))
+		poisson = 0;
+	else if (process && strcmp(process, "poisson")) {
+		printf("Error: arrival_process must be poisson or "
+		       "constant\n");
+		exit(1);
+	}
+
+	if (!rate) {
+		if (process) {
+			printf("Error: arrival_process needs an "
+			       "arrival_rate\n");
+			exit(1);
+		}
+		return;
+	}
+	if (rate < 0) {
+		printf("Error: arrival_rate must be positive\n");
+		exit(1);
+	}
+	tg_set_arrivals(tg, rate, poisson);
+}
+
+/* Any two of burst_on, burst_off, burst_period and burst_duty, all
+ * in msecs but the duty cycle, a percentage
+ */
+static void init_bursts(ffsb_tg_t *tg, config_options_t *config)
+{
+	uint64_t on = get_config_u32(config, "burst_on");
+	uint64_t off = get_config_u32(config, "burst_off");
+	uint64_t period = get_config_u32(config, "burst_period");
+	uint32_t duty = get_config_u32(config, "burst_duty");
+	int given = (on != 0) + (off != 0) + (period != 0) + (duty != 0);
+
+	if (!given) {
+		if (get_config_bool(config, "burst_random") ||
+		    get_config_bool(config, "burst_independent")) {
+			printf("Error: burst_random and burst_independent "
+			       "need burst_on and burst_off\n");
+			exit(1);
+		}
+		return;
+	}
+	if (given != 2) {
+		printf("Error: give two of burst_on, burst_off, burst_period "
+		       "and burst_duty\n");
+		exit(1);
+	}
+	if (duty >= 100) {
+		printf("Error: burst_duty must be between 1 and 99\n");
+		exit(1);
+	}
+
+	if (duty && period) {
+		on = period * duty / 100;
+		off = period - on;
+	} else if (duty && on) {
+		off = on * (100 - duty) / duty;
+	} else if (duty) {
+		on = off * duty / (100 - duty);
+	} else if (period && on) {
+		off = (period > on) ? period - on : 0;
+	} else if (period) {
+		on = (period > off) ? period - off : 0;
+	}
+	if (!on || !off) {
+		printf("Error: bursts need both an on and an off time\n");
+		exit(1);
+	}
+	if (tg_get_arrival_rate(tg)) {
+		printf("Error: bursts can't be combined with arrival_rate\n");
+		exit(1);
+	}
+
+	tg_set_burst(tg, burst_alloc(on * 1000000ULL, off * 1000000ULL,
+				     get_config_bool(config, "burst_random"),
+				     get_config_bool(config,
+						     "burst_independent")));
+}
+
+static void init_ramp(ffsb_tg_t *tg, config_options_t *config)
+{
+	unsigned interval = get_config_u32(config, "ramp_interval");
+	unsigned start = get_config_u32(config, "ramp_start");
+	unsigned step = get_config_u32(config, "ramp_step");
+	double knee = RAMP_KNEE;
+	double latency = RAMP_LATENCY;
+
+	if (!interval) {
+		if (start || step) {
+			printf("Error: ramp_start and ramp_step need "
+			       "ramp_interval\n");
+			exit(1);
+		}
+		return;
+	}
+	if (!start)
+		start = 1;
+	if (!step)
+		step = 1;
+	if (start > tg_get_numthreads(tg)) {
+		printf("Error: ramp_start must be at most num_threads\n");
+		exit(1);
+	}
+	if (get_value(config, "ramp_knee")) {
+		knee = get_config_double(config, "ramp_knee");
+		if (knee <= 0) {
+			printf("Error: ramp_knee must be above 0\n");
+			exit(1);
+		}
+	}
+	if (get_value(config, "ramp_latency")) {
+		latency = get_config_double(config, "ramp_latency");
+		if (latency <= 1) {
+			printf("Error: ramp_latency must be above 1\n");
+			exit(1);
+		}
+	}
+
+	tg_set_ramp(tg, ramp_alloc(start, step, interval, knee, latency));
+}
+
+static void init_limits(ffsb_tg_t *tg, config_options_t *config)
+{
+	uint64_t burst = get_config_u32(config, "limit_burst") * 1000000ULL;
+	double ops = get_config_double(config, "ops_limit");
+
+	if (ops < 0) {
+		printf("Error: ops_limit must be positive\n");
+		exit(1);
+	}
+	tg_set_limit(tg, FFSB_LIMIT_OPS, ops, burst);
+	tg_set_limit(tg, FFSB_LIMIT_READ,
+		     get_config_u64(config, "read_bw_limit"), burst);
+	tg_set_limit(tg, FFSB_LIMIT_WRITE,
+		     get_config_u64(config, "write_bw_limit"), burst);
+}
+
 static void init_threadgroup(ffsb_config_t *fc, config_options_t *config,
 			    ffsb_tg_t *tg, int tg_num)
 {
 	int num_threads;
+	struct replay_trace *rt = NULL;
 	memset(tg, 0, sizeof(ffsb_tg_t));
 
 	num_threads = get_config_u32(config, "num_threads");
 
+	/* A replay runs one thread per traced thread */
+	if (get_config_str(config, "replay_trace")) {
+		rt = replay_load(get_config_str(config, "replay_trace"));
+		if (num_threads && num_threads != replay_num_threads(rt)) {
+			printf("Error: num_threads is %d but the trace has "
+			       "%u threads\n", num_threads,
+			       replay_num_threads(rt));
+			exit(1);
+		}
+		num_threads = replay_num_threads(rt);
+	}
+
 	init_ffsb_tg(tg, num_threads, tg_num);
 
 	if (get_config_str(config, "bindfs")) {
@@ -840,9 +1449,69 @@ static void init_threadgroup(ffsb_config_t *fc, config_options_t *config,
 	tg->fsync_file = get_config_bool(config, "fsync_file");
 
 	tg->wait_time = get_config_u32(config, "op_delay");
+	init_thinktime(tg, config);
+	init_arrivals(tg, config);
+	init_limits(tg, config);
+	init_bursts(tg, config);
+	init_ramp(tg, config);
+
+	if (get_config_u64(config, "lock_range_size"))
+		tg->lock_range_size = get_config_u64(config, "lock_range_size");
+	else
+		tg->lock_range_size = FFSB_TG_DEFAULT_LOCK_RANGE_SIZE;
+	tg->lock_overlap = get_config_u32(config, "lock_overlap");
+	tg->lock_write_percent = get_config_u32(config, "lock_write_percent");
+	tg->lock_io = get_config_bool(config, "lock_io");
+
+	tg_set_rmw_recordsize(tg, get_config_u32(config, "rmw_recordsize"));
+	if (get_config_u32(config, "rmw_records"))
+		tg->rmw_records = get_config_u32(config, "rmw_records");
+	else
+		tg->rmw_records = 1;
+
+	if (get_config_u32(config, "page_size"))
+		tg_set_page_size(tg, get_config_u32(config, "page_size"));
+	else
+		tg_set_page_size(tg, FFSB_TG_DEFAULT_PAGE_SIZE);
+
+	tg_set_stream_rate(tg, get_config_u64(config, "stream_rate"));
+
+	if (rt) {
+		char *timing = get_config_str(config, "replay_timing");
+		double scale = get_config_double(config, "replay_scale");
+		int mode = REPLAY_RECORDED;
+
+		if (timing && !strcmp(timing, "fast"))
+			mode = REPLAY_FAST;
+		else if (timing && !strcmp(timing, "scaled"))
+			mode = REPLAY_SCALED;
+		else if (timing && strcmp(timing, "recorded")) {
+			printf("Error: replay_timing must be recorded, fast "
+			       "or scaled\n");
+			exit(1);
+		}
+		if (mode == REPLAY_SCALED && scale <= 0) {
+			printf("Error: scaled replay_timing requires a "
+			       "positive replay_scale\n");
+			exit(1);
+		}
+		replay_set_timing(rt, mode, scale);
+		replay_attach(rt, &fc->filesystems[max(tg->bindfs, 0)],
+			      tg_num);
+		tg_set_replay(tg, rt);
+	}
+
+	init_file_popularity(tg, config);
+	init_offsets(tg, config);
+
+	if (get_config_u32(config, "scan_threads"))
+		tg->scan_threads = get_config_u32(config, "scan_threads");
+	else
+		tg->scan_threads = 1;
 
 	tg_set_read_blocksize(tg, get_config_u32(config, "read_blocksize"));
 	tg_set_write_blocksize(tg, get_config_u32(config, "write_blocksize"));
+	init_sizedists(fc, tg, config);
 
 	set_weight(tg, config);
 
@@ -902,6 +1571,9 @@ static void init_filesys(ffsb_config_t *fc, int num)
 	if (get_config_bool(profile_conf->global, "alignio"))
 		fs->flags |= FFSB_FS_ALIGNIO4K;
 
+	if (get_config_bool(profile_conf->global, "verify"))
+		fs->flags |= FFSB_FS_VERIFY;
+
 	if (get_config_bool(config, "agefs")) {
 		container_t *age_cont = get_fs_container(fc, num);
 		if (!age_cont->child) {
@@ -927,6 +1599,63 @@ static void init_filesys(ffsb_config_t *fc, int num)
 	else
 		fs->age_blocksize = FFSB_FS_DEFAULT_AGE_BLOCKSIZE;
 
+	if (get_config_u64(config, "lsm_sst_size"))
+		fs->lsm_sst_size = get_config_u64(config, "lsm_sst_size");
+	else
+		fs->lsm_sst_size = FFSB_FS_DEFAULT_LSM_SST_SIZE;
+
+	if (get_config_u32(config, "lsm_fanout"))
+		fs->lsm_fanout = get_config_u32(config, "lsm_fanout");
+	else
+		fs->lsm_fanout = FFSB_FS_DEFAULT_LSM_FANOUT;
+
+	if (get_config_u32(config, "lsm_l0_files"))
+		fs->lsm_l0_files = get_config_u32(config, "lsm_l0_files");
+	else
+		fs->lsm_l0_files = FFSB_FS_DEFAULT_LSM_L0_FILES;
+
+	if (get_config_u32(config, "lsm_levels"))
+		fs->lsm_levels = get_config_u32(config, "lsm_levels");
+	else
+		fs->lsm_levels = FFSB_FS_DEFAULT_LSM_LEVELS;
+
+	if (fs->lsm_levels < 2 || fs->lsm_levels > FFSB_FS_MAX_LSM_LEVELS) {
+		printf("Error: lsm_levels must be between 2 and %d\n",
+		       FFSB_FS_MAX_LSM_LEVELS);
+		exit(1);
+	}
+	if (fs->lsm_fanout < 2) {
+		printf("Error: lsm_fanout must be at least 2\n");
+		exit(1);
+	}
+
+	if (get_config_u32(config, "page_files"))
+		fs->page_files = get_config_u32(config, "page_files");
+	else
+		fs->page_files = FFSB_FS_DEFAULT_PAGE_FILES;
+
+	if (get_config_u64(config, "page_file_size"))
+		fs->page_file_size = get_config_u64(config, "page_file_size");
+	else
+		fs->page_file_size = FFSB_FS_DEFAULT_PAGE_FILE_SIZE;
+
+	if (fs->page_file_size % 4096) {
+		printf("Error: page_file_size must be a multiple of 4096\n");
+		exit(1);
+	}
+
+	if (get_config_u32(config, "obj_levels"))
+		fs->obj_levels = get_config_u32(config, "obj_levels");
+	else
+		fs->obj_levels = FFSB_FS_DEFAULT_OBJ_LEVELS;
+	fs->num_objects = get_config_u32(config, "num_objects");
+
+	if (fs->obj_levels > FFSB_FS_MAX_OBJ_LEVELS) {
+		printf("Error: obj_levels can't exceed %d\n",
+		       FFSB_FS_MAX_OBJ_LEVELS);
+		exit(1);
+	}
+
 	list_head = (value_list_t *) get_value(config, "size_weight");
 	if (list_head) {
 		int count = 0;
@@ -959,48 +1688,626 @@ static void init_tg_stats(ffsb_config_t *fc, int num)
 	range_t *bucket_range;
 	uint32_t min, max;
 
-	tmp_cont = get_tg_container(fc, num);
-	if (tmp_cont->child) {
-		tmp_cont = tmp_cont->child;
-		if (tmp_cont->type == STATS) {
-			config = tmp_cont->config;
-			if (get_config_bool(config, "enable_stats")) {
-
-				list_head = (value_list_t *) get_value(config, "ignore");
-				if (list_head)
-					list_for_each_entry(tmp_list,
-							    &list_head->list, list) {
-						sys_name = (char *)tmp_list->value;
-						ffsb_stats_str2syscall(sys_name, &sys);
-						ffsb_statsc_ignore_sys(&fsc, sys);
-					}
-
-				list_head = (value_list_t *) get_value(config, "msec_range");
-				if (list_head && get_config_bool(config, "enable_range"))
-					list_for_each_entry(tmp_list,
-							    &list_head->list, list) {
-						bucket_range = (range_t *)tmp_list->value;
-						min = (uint32_t)(bucket_range->a * 1000.0f);
-						max = (uint32_t)(bucket_range->b * 1000.0f);
-						ffsb_statsc_addbucket(&fsc, min, max);
-					}
-
-				tg_set_statsc(&fc->groups[num], &fsc);
+	/* the stats may be any of the tg's sections */
+	tmp_cont = get_tg_container(fc, num)->child;
+	while (tmp_cont && tmp_cont->type != STATS)
+		tmp_cont = tmp_cont->next;
+	if (!tmp_cont)
+		return;
+
+	config = tmp_cont->config;
+	if (get_config_bool(config, "enable_stats")) {
+
+		list_head = (value_list_t *) get_value(config, "ignore");
+		if (list_head)
+			list_for_each_entry(tmp_list,
+					    &list_head->list, list) {
+				sys_name = (char *)tmp_list->value;
+				ffsb_stats_str2syscall(sys_name, &sys);
+				ffsb_statsc_ignore_sys(&fsc, sys);
 			}
+
+		list_head = (value_list_t *) get_value(config, "msec_range");
+		if (list_head && get_config_bool(config, "enable_range"))
+			list_for_each_entry(tmp_list,
+					    &list_head->list, list) {
+				bucket_range = (range_t *)tmp_list->value;
+				min = (uint32_t)(bucket_range->a * 1000.0f);
+				max = (uint32_t)(bucket_range->b * 1000.0f);
+				ffsb_statsc_addbucket(&fsc, min, max);
+			}
+
+		tg_set_statsc(&fc->groups[num], &fsc);
+	}
+}
+
+/* Verify mode stamps and checks whole 4k blocks, so every size and
+ * offset used for i/o has to be a multiple of that.
+ */
+static int verify_size_aligned(char *name, uint64_t size)
+{
+	if (size % VERIFY_BLOCKSIZE) {
+		printf("Error: verify requires %s to be a multiple of %u\n",
+		       name, VERIFY_BLOCKSIZE);
+		return 0;
+	}
+	return 1;
+}
+
+/* These ops share files between threads without taking the file
+ * locks, so a block could be read while another thread rewrites it
+ */
+static char *verify_unlocked_ops[] = {
+	"lsm_flush", "lsm_compact", "lsm_get", "stream_read", "stream_write",
+	"page_read", "page_write", "checkpoint", NULL
+};
+
+static int verify_tg_ops(ffsb_tg_t *tg)
+{
+	int i;
+
+	for (i = 0; verify_unlocked_ops[i]; i++)
+		if (tg_get_op_weight(tg, verify_unlocked_ops[i])) {
+			printf("Error: verify can't be used with %s\n",
+			       verify_unlocked_ops[i]);
+			return 0;
 		}
+	return 1;
+}
+
+static int verify_tg_aligned(ffsb_tg_t *tg)
+{
+	return verify_tg_ops(tg) &&
+		verify_size_aligned("read_size", tg->read_size) &&
+		verify_size_aligned("read_blocksize", tg->read_blocksize) &&
+		verify_size_aligned("read_skipsize", tg->read_skipsize) &&
+		verify_size_aligned("write_size", tg->write_size) &&
+		verify_size_aligned("write_blocksize", tg->write_blocksize) &&
+		verify_size_aligned("lock_range_size", tg->lock_range_size) &&
+		verify_size_aligned("rmw_recordsize", tg->rmw_recordsize);
+}
+
+static void verify_config_aligned(ffsb_config_t *fc)
+{
+	int i, j;
+	int ok = 1;
+
+	if (!get_config_bool(fc->profile_conf->global, "alignio")) {
+		printf("Error: verify requires alignio\n");
+		ok = 0;
+	}
+
+	for (i = 0; i < fc->num_filesys; i++) {
+		ffsb_fs_t *fs = &fc->filesystems[i];
+
+		ok = ok && verify_size_aligned("min_filesize", fs->minfilesize);
+		ok = ok && verify_size_aligned("max_filesize", fs->maxfilesize);
+		ok = ok && verify_size_aligned("create_blocksize",
+					       fs->create_blocksize);
+		ok = ok && verify_size_aligned("age_blocksize",
+					       fs->age_blocksize);
+		ok = ok && verify_size_aligned("lsm_sst_size",
+					       fs->lsm_sst_size);
+		for (j = 0; j < fs->num_weights; j++)
+			ok = ok && verify_size_aligned("size_weight",
+						fs->size_weights[j].size);
+		if (fs->aging_tg)
+			ok = ok && verify_tg_aligned(fs->aging_tg);
 	}
+
+	for (i = 0; i < fc->num_threadgroups; i++)
+		ok = ok && verify_tg_aligned(&fc->groups[i]);
+
+	if (!ok)
+		exit(1);
 }
 
-static void init_config(ffsb_config_t *fc, profile_config_t *profile_conf)
+/* rmw picks its records inside an existing file, every file it
+ * may pick has to hold one
+ */
+static void verify_tg_filesizes(ffsb_config_t *fc, ffsb_tg_t *tg)
+{
+	uint32_t recordsize = tg_get_rmw_recordsize(tg);
+	uint64_t smallest;
+	ffsb_fs_t *fs;
+	int i, j;
+
+	if (!tg_get_op_weight(tg, "rmw") &&
+	    !tg_get_op_weight(tg, "rmw_fdatasync"))
+		return;
+
+	for (i = 0; i < fc->num_filesys; i++) {
+		if (tg->bindfs >= 0 && tg->bindfs != i)
+			continue;
+		fs = &fc->filesystems[i];
+		smallest = fs->minfilesize;
+		if (fs->num_weights) {
+			smallest = fs->size_weights[0].size;
+			for (j = 1; j < fs->num_weights; j++)
+				smallest = min(smallest,
+					       fs->size_weights[j].size);
+		}
+		if (smallest < recordsize) {
+			printf("Error: rmw_recordsize %u is larger than the "
+			       "smallest file (%llu bytes) of filesystem "
+			       "%d\n", recordsize,
+			       (unsigned long long)smallest, i);
+			exit(1);
+		}
+	}
+}
+
+/* Tell each filesystem which ops may run on it, unbound threadgroups
+ * run on all of them
+ */
+static void mark_ops_used(ffsb_config_t *fc, ffsb_tg_t *tg)
+{
+	int i, op;
+
+	for (op = 0; op < FFSB_NUMOPS; op++) {
+		if (!tg->op_weights[op])
+			continue;
+		for (i = 0; i < fc->num_filesys; i++)
+			if (tg->bindfs < 0 || tg->bindfs == i)
+				fs_set_op_used(&fc->filesystems[i], op);
+	}
+}
+
+/* Gives every benchmark thread its own oplog.  Threadgroups are
+ * numbered across the phases.
+ */
+static void init_oplogs(ffsb_config_t *fc, config_options_t *global)
+{
+	char *record = get_config_str(global, "oplog_record");
+	char *replay = get_config_str(global, "oplog_replay");
+	ffsb_phase_t *ph;
+	ffsb_tg_t *tg;
+	int i, j, p, num = 0;
+
+	if (record && replay) {
+		printf("Error: oplog_record and oplog_replay are mutually "
+		       "exclusive\n");
+		exit(1);
+	}
+	if (!record && !replay)
+		return;
+
+	printf("%s oplog %s\n", record ? "recording" : "replaying",
+	       record ? record : replay);
+	for (p = 0; p < fc->num_phases; p++) {
+		ph = &fc->phases[p];
+		for (i = 0; i < ph->num_threadgroups; i++, num++) {
+			tg = &ph->groups[i];
+			for (j = 0; j < tg_get_numthreads(tg); j++)
+				ft_get_randdata(tg->threads + j)->log =
+					oplog_open(record ? record : replay,
+						   replay != NULL, num, j);
+		}
+	}
+}
+
+/* op_weights=<op>:<weight>,... on top of the tg's own weights.  Only
+ * ops the tg already runs can be reweighted, everything they need
+ * has been checked.
+ */
+static struct sched_weights *init_sched_weights(ffsb_tg_t *tg, char *spec)
+{
+	struct sched_weights *w = ffsb_malloc(sizeof(*w));
+	char *copy = ffsb_strdup(spec);
+	char *item, *colon;
+	int op, i;
+
+	memcpy(w->weights, tg->op_weights, sizeof(w->weights));
+	for (item = strtok(copy, ","); item; item = strtok(NULL, ",")) {
+		colon = strchr(item, ':');
+		if (colon)
+			*colon++ = '\0';
+		op = ops_find_op(item);
+		if (!colon || op < 0) {
+			printf("Error: bad op_weights %s, use "
+			       "<op>:<weight>,...\n", spec);
+			exit(1);
+		}
+		if (!tg_get_op_weight(tg, item)) {
+			printf("Error: a schedule can only reweight ops the "
+			       "threadgroup has a weight for, not %s\n",
+			       item);
+			exit(1);
+		}
+		w->weights[op] = atoi(colon);
+	}
+	free(copy);
+
+	w->sum = 0;
+	for (i = 0; i < FFSB_NUMOPS; i++)
+		w->sum += w->weights[i];
+	if (!w->sum) {
+		printf("Error: op_weights %s leaves no ops to run\n", spec);
+		exit(1);
+	}
+	return w;
+}
+
+static void init_tg_schedule(ffsb_config_t *fc, int num)
+{
+	ffsb_tg_t *tg = &fc->groups[num];
+	config_options_t *config = get_tg_config(fc, num);
+	container_t *cont = get_tg_container(fc, num)->child;
+	struct schedule *s = NULL;
+	struct sched_seg seg;
+	char *str;
+
+	for (; cont; cont = cont->next) {
+		if (cont->type != SCHEDULE)
+			continue;
+		if (!s)
+			s = schedule_alloc(max(get_config_u32(config,
+							"schedule_interval"),
+					       1),
+					   get_config_bool(config,
+							   "schedule_repeat"));
+
+		memset(&seg, 0, sizeof(seg));
+		seg.duration = get_config_u32(cont->config, "duration");
+		if (!seg.duration) {
+			printf("Error: every schedule section needs a "
+			       "duration\n");
+			exit(1);
+		}
+
+		str = get_config_str(cont->config, "shape");
+		seg.shape = str ? schedule_shape(str) : SCHED_CONSTANT;
+		if (seg.shape < 0) {
+			printf("Error: unknown schedule shape %s, use "
+			       "constant, ramp or diurnal\n", str);
+			exit(1);
+		}
+		seg.period = get_config_u32(cont->config, "period");
+		if (seg.shape == SCHED_DIURNAL && !seg.period) {
+			printf("Error: a diurnal schedule needs a period\n");
+			exit(1);
+		}
+
+		seg.rate = get_config_double(cont->config, "rate");
+		seg.rate_end = get_config_double(cont->config, "rate_end");
+		if (!seg.rate_end)
+			seg.rate_end = seg.rate;
+		if (seg.rate < 0 || seg.rate_end < 0 ||
+		    (seg.rate_end && !seg.rate)) {
+			printf("Error: schedule rate and rate_end must be "
+			       "positive\n");
+			exit(1);
+		}
+
+		seg.threads = get_config_u32(cont->config, "threads");
+		seg.threads_end = get_config_u32(cont->config, "threads_end");
+		if (!seg.threads_end)
+			seg.threads_end = seg.threads;
+		if (max(seg.threads, seg.threads_end) >
+		    tg_get_numthreads(tg) || (seg.threads_end && !seg.threads)) {
+			printf("Error: schedule threads must be between 1 "
+			       "and num_threads\n");
+			exit(1);
+		}
+
+		str = get_config_str(cont->config, "op_weights");
+		if (str)
+			seg.weights = init_sched_weights(tg, str);
+
+		schedule_add(s, &seg);
+	}
+
+	if (s && tg_get_ramp(tg)) {
+		printf("Error: a threadgroup can't both ramp and follow a "
+		       "schedule\n");
+		exit(1);
+	}
+	if (s)
+		tg_set_schedule(tg, s);
+}
+
+/* stop_ops, stop_bytes and stop_op_counts=<op>:<count>,...  Leaves
+ * stop alone if none of them are given.
+ */
+static void init_stop(ffsb_stop_t *stop, config_options_t *config)
+{
+	char *spec = get_config_str(config, "stop_op_counts");
+	char *copy, *item, *colon;
+	int op;
+
+	if (!get_config_u64(config, "stop_ops") &&
+	    !get_config_u64(config, "stop_bytes") && !spec)
+		return;
+
+	memset(stop, 0, sizeof(*stop));
+	stop->set = 1;
+	stop->ops = get_config_u64(config, "stop_ops");
+	stop->bytes = get_config_u64(config, "stop_bytes");
+	if (!spec)
+		return;
+
+	copy = ffsb_strdup(spec);
+	for (item = strtok(copy, ","); item; item = strtok(NULL, ",")) {
+		colon = strchr(item, ':');
+		if (colon)
+			*colon++ = '\0';
+		op = ops_find_op(item);
+		if (!colon || op < 0 || !strtoull(colon, NULL, 10)) {
+			printf("Error: bad stop_op_counts %s, use "
+			       "<op>:<count>,...\n", spec);
+			exit(1);
+		}
+		stop->op[op] = strtoull(colon, NULL, 10);
+	}
+	free(copy);
+}
+
+/* steady_window and friends.  A phase keeps what it inherited from
+ * the global options unless it gives its own.
+ */
+static void init_steady(ffsb_steady_t *st, config_options_t *config)
+{
+	if (get_value(config, "steady_window"))
+		st->window = get_config_u32(config, "steady_window");
+	if (get_value(config, "steady_rounds"))
+		st->rounds = get_config_u32(config, "steady_rounds");
+	if (get_value(config, "steady_max_rounds"))
+		st->max_rounds = get_config_u32(config, "steady_max_rounds");
+	if (get_value(config, "steady_excursion"))
+		st->excursion = get_config_double(config, "steady_excursion");
+	if (get_value(config, "steady_slope"))
+		st->slope = get_config_double(config, "steady_slope");
+	if (!st->window)
+		return;
+
+	if (!st->rounds)
+		st->rounds = STEADY_ROUNDS;
+	if (!st->max_rounds)
+		st->max_rounds = max(STEADY_MAX_ROUNDS, st->rounds);
+	if (st->excursion <= 0)
+		st->excursion = STEADY_EXCURSION;
+	if (st->slope <= 0)
+		st->slope = STEADY_SLOPE;
+	if (st->rounds < 2 || st->max_rounds < st->rounds) {
+		printf("Error: steady_rounds must be at least 2 and no more "
+		       "than steady_max_rounds\n");
+		exit(1);
+	}
+}
+
+/* Sets up a phase's threadgroups.  cont is its [phase] section, or
+ * NULL for the top level threadgroups of a profile without phases.
+ */
+static void init_phase(ffsb_config_t *fc, container_t *cont, unsigned num)
 {
+	ffsb_phase_t *ph = &fc->phases[num];
+	container_t *tmp_cont;
 	config_options_t *config;
+	int i;
+
+	memset(ph, 0, sizeof(*ph));
+	ph->time = fc->time;
+	ph->warmup = fc->warmup;
+	ph->cooldown = fc->cooldown;
+	ph->stop = fc->stop;
+	ph->steady = fc->steady;
+	if (cont) {
+		ph->name = get_config_str(cont->config, "name");
+		if (get_config_u32(cont->config, "time"))
+			ph->time = get_config_u32(cont->config, "time");
+		if (get_value(cont->config, "warmup"))
+			ph->warmup = get_config_u32(cont->config, "warmup");
+		if (get_value(cont->config, "cooldown"))
+			ph->cooldown = get_config_u32(cont->config,
+						      "cooldown");
+		init_stop(&ph->stop, cont->config);
+		init_steady(&ph->steady, cont->config);
+		if (!ph->time && !ph->stop.set) {
+			printf("Error: phase %u needs a time or a stop "
+			       "target\n", num);
+			exit(1);
+		}
+		for (tmp_cont = cont->child; tmp_cont;
+		     tmp_cont = tmp_cont->next)
+			if (tmp_cont->type != THREAD_GROUP) {
+				printf("Error: phase %u may only hold "
+				       "threadgroups\n", num);
+				exit(1);
+			}
+
+		/* get_tg_container() and friends look here */
+		fc->profile_conf->tg_container = cont->child;
+	}
+
+	fc->num_threadgroups = get_num_threadgroups(fc->profile_conf);
+	fc->groups = ffsb_malloc(sizeof(ffsb_tg_t) * fc->num_threadgroups);
+	for (i = 0; i < fc->num_threadgroups; i++) {
+		config = get_tg_config(fc, i);
+		init_threadgroup(fc, config, &fc->groups[i], i);
+		init_tg_stats(fc, i);
+		init_tg_schedule(fc, i);
+		mark_ops_used(fc, &fc->groups[i]);
+		verify_tg_filesizes(fc, &fc->groups[i]);
+	}
+
+	/* Replay threadgroups size themselves from their trace */
+	fc->num_totalthreads = 0;
+	for (i = 0; i < fc->num_threadgroups; i++)
+		fc->num_totalthreads += tg_get_numthreads(&fc->groups[i]);
+
+	if (get_config_bool(fc->profile_conf->global, "verify"))
+		verify_config_aligned(fc);
+
+	ph->num_threadgroups = fc->num_threadgroups;
+	ph->num_totalthreads = fc->num_totalthreads;
+	ph->groups = fc->groups;
+}
+
+/* Everything a run is made of, on top of the filesystems: its times
+ * and targets, and the phases with their threadgroups
+ */
+static void init_phases(ffsb_config_t *fc)
+{
+	profile_config_t *profile_conf = fc->profile_conf;
 	container_t *tmp_cont;
 	int i;
 
 	fc->time = get_config_u32(profile_conf->global, "time");
+	fc->warmup = get_config_u32(profile_conf->global, "warmup");
+	fc->cooldown = get_config_u32(profile_conf->global, "cooldown");
+	memset(&fc->stop, 0, sizeof(fc->stop));
+	init_stop(&fc->stop, profile_conf->global);
+	memset(&fc->steady, 0, sizeof(fc->steady));
+	init_steady(&fc->steady, profile_conf->global);
+
+	if (profile_conf->phase_container) {
+		fc->num_phases = get_num_containers(
+			profile_conf->phase_container);
+		fc->phases = ffsb_malloc(sizeof(ffsb_phase_t) *
+					 fc->num_phases);
+		for (i = 0, tmp_cont = profile_conf->phase_container;
+		     tmp_cont; i++, tmp_cont = tmp_cont->next)
+			init_phase(fc, tmp_cont, i);
+	} else {
+		fc->num_phases = 1;
+		fc->phases = ffsb_malloc(sizeof(ffsb_phase_t));
+		init_phase(fc, NULL, 0);
+	}
+	fc_set_phase(fc, 0);
+}
+
+static int has_option(config_options_t *options, char *name)
+{
+	for (; options->name; options++)
+		if (!strcmp(options->name, name))
+			return 1;
+	return 0;
+}
+
+/* Sets one option in a section to value, as if the profile said so */
+static void sweep_set(config_options_t *config, char *name, char *value)
+{
+	char buf[BUFSIZE];
+	void *old;
+
+	for (; config->name; config++)
+		if (!strcmp(config->name, name))
+			break;
+	old = config->value;
+	snprintf(buf, BUFSIZE, "%s=%s\n", name, value);
+	if (!set_option(buf, config)) {
+		printf("Error: bad sweep value %s for %s\n", value, name);
+		exit(1);
+	}
+	free(old);
+}
+
+/* Threadgroup options go to every threadgroup, in every phase.  The
+ * others are the global ones a phase may also set, where a phase's
+ * own value still wins.
+ */
+static void sweep_apply(ffsb_config_t *fc, ffsb_sweep_t *sw, char *value)
+{
+	profile_config_t *profile_conf = fc->profile_conf;
+	container_t *phase, *tg;
+
+	if (!has_option(tg_options, sw->option)) {
+		sweep_set(profile_conf->global, sw->option, value);
+		return;
+	}
+	phase = profile_conf->phase_container;
+	tg = phase ? phase->child : profile_conf->tg_container;
+	while (tg) {
+		if (tg->type == THREAD_GROUP)
+			sweep_set(tg->config, sw->option, value);
+		tg = tg->next;
+		if (!tg && phase && (phase = phase->next))
+			tg = phase->child;
+	}
+}
+
+/* sweep=<option>:<value>,... */
+static void init_sweeps(ffsb_config_t *fc, config_options_t *global)
+{
+	value_list_t *list_head = get_value(global, "sweep");
+	value_list_t *tmp_list;
+	ffsb_sweep_t *sw;
+	char *spec, *values, *value;
+	unsigned i;
+
+	fc->num_runs = 1;
+	fc->sweep_drop_caches = get_config_bool(global, "sweep_drop_caches");
+	fc->sweep_reage = get_config_bool(global, "sweep_reage");
+	if (!list_head)
+		return;
+
+	list_for_each_entry(tmp_list, &list_head->list, list)
+		fc->num_sweeps++;
+	fc->sweeps = ffsb_malloc(sizeof(ffsb_sweep_t) * fc->num_sweeps);
+	memset(fc->sweeps, 0, sizeof(ffsb_sweep_t) * fc->num_sweeps);
+
+	/* The list is in reverse order */
+	i = fc->num_sweeps;
+	list_for_each_entry(tmp_list, &list_head->list, list) {
+		sw = &fc->sweeps[--i];
+		spec = ffsb_strdup(tmp_list->value);
+		values = strchr(spec, ':');
+		if (!values || !values[1]) {
+			printf("Error: bad sweep %s, use "
+			       "<option>:<value>,...\n", spec);
+			exit(1);
+		}
+		*values++ = '\0';
+		sw->option = spec;
+
+		if (!has_option(tg_options, spec) &&
+		    (!has_option(phase_options, spec) ||
+		     !strcmp(spec, "name"))) {
+			printf("Error: can't sweep %s, only threadgroup "
+			       "options and the global ones a phase may "
+			       "set\n", spec);
+			exit(1);
+		}
+		for (value = strtok(values, ","); value;
+		     value = strtok(NULL, ",")) {
+			sw->values = ffsb_realloc(sw->values,
+						  (sw->num_values + 1) *
+						  sizeof(char *));
+			sw->values[sw->num_values++] = value;
+		}
+		if (!sw->num_values) {
+			printf("Error: sweep of %s has no values\n", spec);
+			exit(1);
+		}
+		fc->num_runs *= sw->num_values;
+	}
+
+	if (get_config_str(global, "oplog_record") ||
+	    get_config_str(global, "oplog_replay")) {
+		printf("Error: oplogs can't be combined with sweeps\n");
+		exit(1);
+	}
+}
+
+void ffsb_sweep_config(ffsb_config_t *fc, unsigned run)
+{
+	unsigned i, div = fc->num_runs;
+
+	for (i = 0; i < fc->num_sweeps; i++) {
+		div /= fc->sweeps[i].num_values;
+		sweep_apply(fc, &fc->sweeps[i], fc->sweeps[i].values[
+				    (run / div) % fc->sweeps[i].num_values]);
+	}
+	if (fc->phases)
+		fc_free_phases(fc);
+	init_phases(fc);
+}
+
+static void init_config(ffsb_config_t *fc, profile_config_t *profile_conf)
+{
+	int i;
+
 	fc->num_filesys = get_num_filesystems(profile_conf);
-	fc->num_threadgroups = get_num_threadgroups(profile_conf);
-	fc->num_totalthreads = get_num_totalthreads(profile_conf);
 	fc->profile_conf = profile_conf;
 	fc->callout = get_config_str(profile_conf->global, "callout");
 
@@ -1008,12 +2315,15 @@ static void init_config(ffsb_config_t *fc, profile_config_t *profile_conf)
 	for (i = 0; i < fc->num_filesys; i++)
 		init_filesys(fc, i);
 
-	fc->groups = ffsb_malloc(sizeof(ffsb_tg_t) * fc->num_threadgroups);
-	for (i = 0; i < fc->num_threadgroups; i++) {
-		config = get_tg_config(fc, i);
-		init_threadgroup(fc, config, &fc->groups[i], i);
-		init_tg_stats(fc, i);
+	if (profile_conf->phase_container && profile_conf->tg_container) {
+		printf("Error: with [phase] sections every threadgroup goes "
+		       "in a phase\n");
+		exit(1);
 	}
+	init_sweeps(fc, profile_conf->global);
+	ffsb_sweep_config(fc, 0);
+
+	init_oplogs(fc, profile_conf->global);
 }
 
 void ffsb_parse_newconfig(ffsb_config_t *fc, char *filename)
@@ -1030,5 +2340,6 @@ void ffsb_parse_newconfig(ffsb_config_t *fc, char *filename)
 	profile_conf = parse(f);
 	fclose(f);
 
+	memset(fc, 0, sizeof(*fc));
 	init_config(fc, profile_conf);
 }
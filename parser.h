@@ -43,16 +43,34 @@
 #define FILESYSTEM		0x0004
 #define END			0x0008
 #define STATS			0x0010
+#define SCHEDULE		0x0020
+#define PHASE			0x0040
 
 #define GLOBAL_OPTIONS {						\
 	{"num_filesystems", NULL, TYPE_DEPRECATED, STORE_SINGLE},	\
 	{"num_threadgroups", NULL, TYPE_DEPRECATED, STORE_SINGLE},	\
 	{"verbose", NULL, TYPE_BOOLEAN, STORE_SINGLE},			\
 	{"time", NULL, TYPE_U32, STORE_SINGLE},				\
+	{"warmup", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"cooldown", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"stop_ops", NULL, TYPE_U64, STORE_SINGLE},			\
+	{"stop_bytes", NULL, TYPE_SIZE64, STORE_SINGLE},		\
+	{"stop_op_counts", NULL, TYPE_STRING, STORE_SINGLE},		\
+	{"steady_window", NULL, TYPE_U32, STORE_SINGLE},		\
+	{"steady_rounds", NULL, TYPE_U32, STORE_SINGLE},		\
+	{"steady_max_rounds", NULL, TYPE_U32, STORE_SINGLE},		\
+	{"steady_excursion", NULL, TYPE_DOUBLE, STORE_SINGLE},		\
+	{"steady_slope", NULL, TYPE_DOUBLE, STORE_SINGLE},		\
 	{"directio", NULL, TYPE_BOOLEAN, STORE_SINGLE},			\
 	{"bufferio", NULL, TYPE_BOOLEAN, STORE_SINGLE},			\
 	{"alignio", NULL, TYPE_BOOLEAN, STORE_SINGLE},			\
 	{"callout", NULL, TYPE_STRING, STORE_SINGLE},			\
+	{"verify", NULL, TYPE_BOOLEAN, STORE_SINGLE},			\
+	{"oplog_record", NULL, TYPE_STRING, STORE_SINGLE},		\
+	{"oplog_replay", NULL, TYPE_STRING, STORE_SINGLE},		\
+	{"sweep", NULL, TYPE_STRING, STORE_LIST},			\
+	{"sweep_drop_caches", NULL, TYPE_BOOLEAN, STORE_SINGLE},	\
+	{"sweep_reage", NULL, TYPE_BOOLEAN, STORE_SINGLE},		\
 	{NULL, NULL, 0, 0} }
 
 #define THREADGROUP_OPTIONS {						\
@@ -83,6 +101,78 @@
 	{"writeall_weight", NULL, TYPE_WEIGHT, STORE_SINGLE},		\
 	{"writeall_fsync_weight", NULL, TYPE_WEIGHT, STORE_SINGLE},	\
 	{"open_close_weight", NULL, TYPE_WEIGHT, STORE_SINGLE},		\
+	{"create_tmpfile_weight", NULL, TYPE_WEIGHT, STORE_SINGLE},	\
+	{"create_tmpfile_fsync_weight", NULL, TYPE_WEIGHT, STORE_SINGLE}, \
+	{"lock_weight", NULL, TYPE_WEIGHT, STORE_SINGLE},		\
+	{"flock_weight", NULL, TYPE_WEIGHT, STORE_SINGLE},		\
+	{"lock_range_size", NULL, TYPE_SIZE64, STORE_SINGLE},		\
+	{"lock_overlap", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"lock_write_percent", NULL, TYPE_U32, STORE_SINGLE},		\
+	{"lock_io", NULL, TYPE_BOOLEAN, STORE_SINGLE},			\
+	{"rmw_weight", NULL, TYPE_WEIGHT, STORE_SINGLE},		\
+	{"rmw_fdatasync_weight", NULL, TYPE_WEIGHT, STORE_SINGLE},	\
+	{"rmw_recordsize", NULL, TYPE_SIZE32, STORE_SINGLE},		\
+	{"rmw_records", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"scan_weight", NULL, TYPE_WEIGHT, STORE_SINGLE},		\
+	{"scan_threads", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"lsm_flush_weight", NULL, TYPE_WEIGHT, STORE_SINGLE},		\
+	{"lsm_compact_weight", NULL, TYPE_WEIGHT, STORE_SINGLE},	\
+	{"lsm_get_weight", NULL, TYPE_WEIGHT, STORE_SINGLE},		\
+	{"page_read_weight", NULL, TYPE_WEIGHT, STORE_SINGLE},		\
+	{"page_write_weight", NULL, TYPE_WEIGHT, STORE_SINGLE},		\
+	{"checkpoint_weight", NULL, TYPE_WEIGHT, STORE_SINGLE},		\
+	{"page_size", NULL, TYPE_SIZE32, STORE_SINGLE},			\
+	{"obj_put_weight", NULL, TYPE_WEIGHT, STORE_SINGLE},		\
+	{"obj_get_weight", NULL, TYPE_WEIGHT, STORE_SINGLE},		\
+	{"obj_delete_weight", NULL, TYPE_WEIGHT, STORE_SINGLE},		\
+	{"stream_read_weight", NULL, TYPE_WEIGHT, STORE_SINGLE},	\
+	{"stream_write_weight", NULL, TYPE_WEIGHT, STORE_SINGLE},	\
+	{"stream_rate", NULL, TYPE_SIZE64, STORE_SINGLE},		\
+	{"replay_weight", NULL, TYPE_WEIGHT, STORE_SINGLE},		\
+	{"replay_trace", NULL, TYPE_STRING, STORE_SINGLE},		\
+	{"replay_timing", NULL, TYPE_STRING, STORE_SINGLE},		\
+	{"replay_scale", NULL, TYPE_DOUBLE, STORE_SINGLE},		\
+	{"file_popularity", NULL, TYPE_STRING, STORE_SINGLE},		\
+	{"file_zipf_theta", NULL, TYPE_DOUBLE, STORE_SINGLE},		\
+	{"file_hot_ops", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"file_hot_files", NULL, TYPE_U32, STORE_SINGLE},		\
+	{"file_exp_mean", NULL, TYPE_DOUBLE, STORE_SINGLE},		\
+	{"read_offsets", NULL, TYPE_STRING, STORE_SINGLE},		\
+	{"write_offsets", NULL, TYPE_STRING, STORE_SINGLE},		\
+	{"offset_zipf_theta", NULL, TYPE_DOUBLE, STORE_SINGLE},		\
+	{"offset_hot_ops", NULL, TYPE_U32, STORE_SINGLE},		\
+	{"offset_hot_region", NULL, TYPE_U32, STORE_SINGLE},		\
+	{"offset_streams", NULL, TYPE_U32, STORE_SINGLE},		\
+	{"offset_stride", NULL, TYPE_SIZE64, STORE_SINGLE},		\
+	{"offset_jitter", NULL, TYPE_SIZE64, STORE_SINGLE},		\
+	{"read_size_dist", NULL, TYPE_STRING, STORE_SINGLE},		\
+	{"read_size_weight", NULL, TYPE_SIZEWEIGHT, STORE_LIST},	\
+	{"read_blocksize_dist", NULL, TYPE_STRING, STORE_SINGLE},	\
+	{"read_blocksize_weight", NULL, TYPE_SIZEWEIGHT, STORE_LIST},	\
+	{"write_size_dist", NULL, TYPE_STRING, STORE_SINGLE},		\
+	{"write_size_weight", NULL, TYPE_SIZEWEIGHT, STORE_LIST},	\
+	{"write_blocksize_dist", NULL, TYPE_STRING, STORE_SINGLE},	\
+	{"write_blocksize_weight", NULL, TYPE_SIZEWEIGHT, STORE_LIST},	\
+	{"think_time", NULL, TYPE_STRING, STORE_SINGLE},		\
+	{"arrival_rate", NULL, TYPE_DOUBLE, STORE_SINGLE},		\
+	{"arrival_process", NULL, TYPE_STRING, STORE_SINGLE},		\
+	{"ops_limit", NULL, TYPE_DOUBLE, STORE_SINGLE},			\
+	{"read_bw_limit", NULL, TYPE_SIZE64, STORE_SINGLE},		\
+	{"write_bw_limit", NULL, TYPE_SIZE64, STORE_SINGLE},		\
+	{"limit_burst", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"burst_on", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"burst_off", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"burst_period", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"burst_duty", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"burst_random", NULL, TYPE_BOOLEAN, STORE_SINGLE},		\
+	{"burst_independent", NULL, TYPE_BOOLEAN, STORE_SINGLE},	\
+	{"ramp_start", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"ramp_step", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"ramp_interval", NULL, TYPE_U32, STORE_SINGLE},		\
+	{"ramp_knee", NULL, TYPE_DOUBLE, STORE_SINGLE},			\
+	{"ramp_latency", NULL, TYPE_DOUBLE, STORE_SINGLE},		\
+	{"schedule_interval", NULL, TYPE_U32, STORE_SINGLE},		\
+	{"schedule_repeat", NULL, TYPE_BOOLEAN, STORE_SINGLE},		\
 	{NULL, NULL, 0} }
 
 #define FILESYSTEM_OPTIONS {						\
@@ -100,6 +190,14 @@
 	{"init_util", NULL, TYPE_DOUBLE, STORE_SINGLE},			\
 	{"init_size", NULL, TYPE_SIZE64, STORE_SINGLE},			\
 	{"clone", NULL, TYPE_STRING, STORE_SINGLE},			\
+	{"lsm_sst_size", NULL, TYPE_SIZE64, STORE_SINGLE},		\
+	{"lsm_fanout", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"lsm_l0_files", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"lsm_levels", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"page_files", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"page_file_size", NULL, TYPE_SIZE64, STORE_SINGLE},		\
+	{"obj_levels", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"num_objects", NULL, TYPE_U32, STORE_SINGLE},			\
 	{NULL, NULL, 0} }
 
 #define STATS_OPTIONS {							\
@@ -109,11 +207,39 @@
 	{"msec_range", NULL, TYPE_RANGE, STORE_LIST},			\
 	{NULL, NULL, 0} }
 
+#define SCHEDULE_OPTIONS {						\
+	{"duration", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"shape", NULL, TYPE_STRING, STORE_SINGLE},			\
+	{"rate", NULL, TYPE_DOUBLE, STORE_SINGLE},			\
+	{"rate_end", NULL, TYPE_DOUBLE, STORE_SINGLE},			\
+	{"threads", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"threads_end", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"period", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"op_weights", NULL, TYPE_STRING, STORE_SINGLE},		\
+	{NULL, NULL, 0} }
+
+#define PHASE_OPTIONS {							\
+	{"name", NULL, TYPE_STRING, STORE_SINGLE},			\
+	{"time", NULL, TYPE_U32, STORE_SINGLE},				\
+	{"warmup", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"cooldown", NULL, TYPE_U32, STORE_SINGLE},			\
+	{"stop_ops", NULL, TYPE_U64, STORE_SINGLE},			\
+	{"stop_bytes", NULL, TYPE_SIZE64, STORE_SINGLE},		\
+	{"stop_op_counts", NULL, TYPE_STRING, STORE_SINGLE},		\
+	{"steady_window", NULL, TYPE_U32, STORE_SINGLE},		\
+	{"steady_rounds", NULL, TYPE_U32, STORE_SINGLE},		\
+	{"steady_max_rounds", NULL, TYPE_U32, STORE_SINGLE},		\
+	{"steady_excursion", NULL, TYPE_DOUBLE, STORE_SINGLE},		\
+	{"steady_slope", NULL, TYPE_DOUBLE, STORE_SINGLE},		\
+	{NULL, NULL, 0} }
+
 #define CONTAINER_DESC {				\
 	{"filesystem", FILESYSTEM, 10},			\
 	{"threadgroup", THREAD_GROUP, 11},		\
 	{"end", END, 3},				\
 	{"stats", STATS, 5},				\
+	{"schedule", SCHEDULE, 8},			\
+	{"phase", PHASE, 5},				\
 	{NULL, 0, 0} }
 
 typedef struct container {
@@ -148,4 +274,10 @@ typedef struct value_list {
 
 void ffsb_parse_newconfig(ffsb_config_t *fc, char *filename);
 
+/* Sets the swept options to their values for run number run (from 0
+ * to fc->num_runs - 1) and rebuilds the threadgroups of every phase
+ * from them.  The filesystems are left as they are.
+ */
+void ffsb_sweep_config(ffsb_config_t *fc, unsigned run);
+
 #endif
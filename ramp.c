@@ -0,0 +1,179 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ramp.h"
+#include "ffsb_tg.h"
+#include "util.h"
+
+struct ramp *ramp_alloc(unsigned start, unsigned step, unsigned interval,
+			double knee, double latency)
+{
+	struct ramp *r = ffsb_malloc(sizeof(*r));
+
+	memset(r, 0, sizeof(*r));
+	r->start = start;
+	r->step = step;
+	r->interval = interval;
+	r->knee = knee;
+	r->latency = latency;
+	return r;
+}
+
+void ramp_free(struct ramp *r)
+{
+	free(r->steps);
+	free(r);
+}
+
+void ramp_print_config(struct ramp *r)
+{
+	printf("\t ramp             = %u threads, then %u more every "
+	       "%u sec\n", r->start, r->step, r->interval);
+	printf("\t ramp knee        = gain under %g%% per thread or p99 "
+	       "over %gx\n", r->knee, r->latency);
+}
+
+static void ramp_sample(struct ramp *r, uint64_t *ops, uint64_t *nsec,
+			ffsb_hist_t *lat)
+{
+	*ops = *nsec = 0;
+	ffsb_hist_init(lat);
+	tg_add_done(r->tg, ops, nsec);
+	tg_add_ramp_lat(r->tg, lat);
+}
+
+/* Records a step and looks for the knee: the step before the first
+ * one that didn't pay for its threads
+ */
+static void ramp_add(struct ramp *r, unsigned threads, uint64_t ops,
+		     uint64_t nsec, ffsb_hist_t *lat)
+{
+	struct ramp_step *s, *prev, *first;
+	double gain;
+
+	r->steps = ffsb_realloc(r->steps, (r->num_steps + 1) * sizeof(*s));
+	s = &r->steps[r->num_steps++];
+	s->threads = threads;
+	s->ops = (double)ops / r->interval;
+	s->mean = ops ? nsec / 1000.0 / ops : 0;
+	s->p99 = ffsb_hist_percentile(lat, 99.0);
+
+	if (r->knee_why || r->num_steps < 2)
+		return;
+	first = &r->steps[0];
+	prev = s - 1;
+
+	gain = (s->ops - prev->ops) / (s->threads - prev->threads);
+	if (gain < r->knee / 100.0 * first->ops / first->threads)
+		r->knee_why = RAMP_KNEE_GAIN;
+	else if (first->p99 && s->p99 > r->latency * first->p99)
+		r->knee_why = RAMP_KNEE_LATENCY;
+	if (r->knee_why)
+		r->knee_step = r->num_steps - 2;
+}
+
+static void *ramp_run(void *data)
+{
+	struct ramp *r = data;
+	ffsb_tg_t *tg = r->tg;
+	unsigned total = tg_get_numthreads(tg);
+	unsigned threads = tg_get_active_threads(tg);
+	ffsb_hist_t *last, *cur, *diff, *tmp;
+	uint64_t ops, nsec, last_ops, last_nsec;
+	uint64_t next = ffsb_clock_nsec();
+
+	last = ffsb_malloc(sizeof(*last));
+	cur = ffsb_malloc(sizeof(*cur));
+	diff = ffsb_malloc(sizeof(*diff));
+
+	ramp_sample(r, &last_ops, &last_nsec, last);
+	for (;;) {
+		next += r->interval * 1000000000ULL;
+		if (!tg_wait_until(tg, next))
+			break;
+		ramp_sample(r, &ops, &nsec, cur);
+		ffsb_hist_diff(diff, cur, last);
+		ramp_add(r, threads, ops - last_ops, nsec - last_nsec, diff);
+		last_ops = ops;
+		last_nsec = nsec;
+		tmp = last;
+		last = cur;
+		cur = tmp;
+
+		if (threads == total)
+			break;
+		threads = min(threads + r->step, total);
+		tg_set_active_threads(tg, threads);
+	}
+
+	free(last);
+	free(cur);
+	free(diff);
+	return NULL;
+}
+
+void ramp_start(struct ramp *r, ffsb_tg_t *tg)
+{
+	r->tg = tg;
+	pthread_create(&r->thread, NULL, ramp_run, r);
+}
+
+void ramp_stop(struct ramp *r)
+{
+	pthread_join(r->thread, NULL);
+}
+
+void ramp_print(struct ramp *r)
+{
+	struct ramp_step *s;
+	unsigned i;
+
+	printf("Thread ramp, %u sec per step\n", r->interval);
+	if (!r->num_steps) {
+		printf("The run ended before the first step\n\n");
+		return;
+	}
+	printf("%10s %12s %12s %12s %12s\n", "threads", "ops/sec",
+	       "per thread", "avg usec", "p99 usec");
+	for (i = 0; i < r->num_steps; i++) {
+		s = &r->steps[i];
+		printf("%10u %12.1lf %12.1lf %12.1lf %12llu%s\n", s->threads,
+		       s->ops, s->ops / s->threads, s->mean,
+		       (unsigned long long)s->p99,
+		       (r->knee_why && i == r->knee_step) ? "  <- knee" : "");
+	}
+
+	s = &r->steps[r->knee_step];
+	if (r->knee_why == RAMP_KNEE_GAIN)
+		printf("Knee at %u threads: past it each thread added less "
+		       "than %g%% of the first step's per thread ops/sec\n",
+		       s->threads, r->knee);
+	else if (r->knee_why == RAMP_KNEE_LATENCY)
+		printf("Knee at %u threads: past it p99 latency went over "
+		       "%g times the first step's\n", s->threads, r->latency);
+	else
+		printf("No knee found up to %u threads\n",
+		       r->steps[r->num_steps - 1].threads);
+	if (r->steps[r->num_steps - 1].threads < tg_get_numthreads(r->tg))
+		printf("The run ended before all %u threads were going\n",
+		       tg_get_numthreads(r->tg));
+	printf("\n");
+}
@@ -0,0 +1,82 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef _RAMP_H_
+#define _RAMP_H_
+
+#include <pthread.h>
+#include <inttypes.h>
+
+#include "ffsb_hist.h"
+
+struct ffsb_tg;
+
+/* A threadgroup can ramp up its thread count within one run, on the
+ * same fileset: it starts with ramp_start threads and adds ramp_step
+ * more every ramp_interval secs until all of num_threads are going.
+ * The threads are all created when the run starts, those not needed
+ * yet stay parked (see ft_run()).
+ *
+ * A controller thread records each step's throughput and op latency,
+ * and the knee is the last step before the throughput gained per
+ * added thread drops below knee percent of what each thread did at
+ * the first step, or p99 latency grows past latency times the first
+ * step's.  The scaling curve is printed with the tg's results.
+ */
+#define RAMP_KNEE	10.0
+#define RAMP_LATENCY	5.0
+
+#define RAMP_KNEE_NONE		0
+#define RAMP_KNEE_GAIN		1
+#define RAMP_KNEE_LATENCY	2
+
+struct ramp_step {
+	unsigned threads;
+	double ops;			/* per sec */
+	uint64_t p99;			/* usecs */
+	double mean;
+};
+
+struct ramp {
+	unsigned start;
+	unsigned step;
+	unsigned interval;		/* secs */
+	double knee;			/* percent */
+	double latency;
+
+	struct ramp_step *steps;
+	unsigned num_steps;
+	unsigned knee_step;
+	int knee_why;
+
+	struct ffsb_tg *tg;
+	pthread_t thread;
+};
+
+struct ramp *ramp_alloc(unsigned start, unsigned step, unsigned interval,
+			double knee, double latency);
+void ramp_free(struct ramp *);
+void ramp_print_config(struct ramp *);
+void ramp_print(struct ramp *);
+
+/* Called by tg_run() once its threads are going, and after they've
+ * been told to stop
+ */
+void ramp_start(struct ramp *, struct ffsb_tg *);
+void ramp_stop(struct ramp *);
+
+#endif /* _RAMP_H_ */
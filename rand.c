@@ -29,6 +29,7 @@
 #include "config.h"
 #include "rand.h"
 #include "util.h"
+#include "oplog.h"
 
 #define RANDSRC "/dev/urandom"
 
@@ -71,14 +72,33 @@ static void sgenrand(randdata_t *state)
 	state->mti = 0;
 }
 
+/* Once the bits from RANDSRC are used up, refill the array from
+ * lrand48_r().  Starting over from the same bits would make every
+ * thread repeat itself every few thousand numbers, which skewed
+ * distributions (see ffsb_dist.h) can't live with.
+ */
+static void regenrand(randdata_t *state)
+{
+#ifdef HAVE_LRAND48_R
+	long int rand = 0;
+	int i;
+
+	/* lrand48 gives 31 bits, use 24 of them */
+	for (i = 0; i < state->size; i++) {
+		if (i % 3 == 0)
+			lrand48_r(&state->data, &rand);
+		state->mt[i] = (rand >> (8 * (i % 3))) & 0xff;
+	}
+#endif
+	state->mti = 0;
+}
+
 /* returns 8 random bits */
 static uint8_t genrand8(randdata_t *state)
 {
 	unsigned long ret = 0;
-	if (state->mti >= state->size) {
-/*		sgenrand(state); */
-		state->mti = 0;
-	}
+	if (state->mti >= state->size)
+		regenrand(state);
 	ret = state->mt[state->mti];
 	state->mti++;
 	return ret;
@@ -110,6 +130,8 @@ void init_random(randdata_t *state, uint32_t iter)
 		state->size = iter * AVG_ITR_RNDBTS;
 
 	state->mt = ffsb_malloc(state->size);
+	state->log = NULL;
+	state->pop = NULL;
 
 	/* !!!! racy? add pthread_once stuff later  */
 	if ((randfd < 0) && (randfd = open(RANDSRC, O_RDONLY)) < 0) {
@@ -118,8 +140,10 @@ void init_random(randdata_t *state, uint32_t iter)
 	}
 	sgenrand(state);
 	gettimeofday(&time, NULL);
-#ifdef HAVE_LRAND48
-	srand48_r(time.tv_sec, &state->data);
+#ifdef HAVE_LRAND48_R
+	/* Seeded apart for each thread */
+	srand48_r(time.tv_sec ^ time.tv_usec ^ *(long *)state->mt,
+		  &state->data);
 #endif
 }
 
@@ -140,12 +164,16 @@ uint32_t getrandom(randdata_t *state, uint32_t mod)
 
     uint8_t bytes[4] = { 0, 0, 0, 0 };
     uint32_t ret;
+    uint64_t range, limit;
     int num_bytes = 4;
     int i;
 
     if ((mod == 0) || (mod == 1))
 	    return 0;
 
+    if (oplog_replaying(state->log))
+	    return oplog_get(state->log, OPLOG_RAND) % mod;
+
     if (!(mod >> 8))
 	    num_bytes = 1;
     else if (!(mod >> 16))
@@ -153,12 +181,22 @@ uint32_t getrandom(randdata_t *state, uint32_t mod)
     else if (!(mod >> 24))
 	    num_bytes = 3;
 
-    for (i = 0; i < num_bytes; i++)
-	    bytes[i] = genrand8(state);
-
-    ret = (bytes[3] << 24) + (bytes[2] << 16) + (bytes[1] << 8) + bytes[0];
-
-    return ret % mod;
+    /* Redraw values past the last whole multiple of mod, or the low
+     * results come up more often (a byte mod 100 picks 0-55 half
+     * again as often as 56-99)
+     */
+    range = (num_bytes == 4) ? 0x100000000ULL : 1ULL << (8 * num_bytes);
+    limit = range - range % mod;
+    do {
+	    for (i = 0; i < num_bytes; i++)
+		    bytes[i] = genrand8(state);
+	    ret = (bytes[3] << 24) + (bytes[2] << 16) + (bytes[1] << 8) +
+		    bytes[0];
+    } while (ret >= limit);
+    ret %= mod;
+
+    oplog_put(state->log, OPLOG_RAND, ret);
+    return ret;
 }
 
 uint64_t getllrandom(randdata_t *state, uint64_t mod)
@@ -170,10 +208,13 @@ uint64_t getllrandom(randdata_t *state, uint64_t mod)
 	if (mod == 0)
 		return 0;
 
-	/* ULONG_MAX comes from limits.h */
-	if (mod < ULONG_MAX)
+	/* getrandom() only takes 32 bits */
+	if (mod <= UINT32_MAX)
 		return (uint64_t)getrandom(state, (uint32_t)mod);
 
+	if (oplog_replaying(state->log))
+		return oplog_get(state->log, OPLOG_RAND) % mod;
+
 	high = genrand32(state);
 
 	low  = genrand32(state);
@@ -184,5 +225,16 @@ uint64_t getllrandom(randdata_t *state, uint64_t mod)
 	assert(result != 0);
 	assert(result > 0);
 
-	return result % mod;
+	result %= mod;
+	oplog_put(state->log, OPLOG_RAND, result);
+	return result;
+}
+
+/* 62 random bits, from two draws of 31 */
+double getdrandom(randdata_t *state)
+{
+	uint64_t high = getrandom(state, 1U << 31);
+	uint64_t low = getrandom(state, 1U << 31);
+
+	return (double)(high << 31 | low) / (double)(1ULL << 62);
 }
@@ -37,6 +37,9 @@
 #define MIN_RANDBUF_SIZE 1024
 
 
+struct oplog;
+struct ffsb_popularity;
+
 typedef struct randdata {
 	int size;
 	uint8_t *mt; /* the array of random bits  */
@@ -46,11 +49,22 @@ typedef struct randdata {
 #ifdef HAVE_LRAND48_R
 	struct drand48_data data;
 #endif
+
+	/* Numbers drawn are recorded here, or read back from it when
+	 * replaying, see oplog.h
+	 */
+	struct oplog *log;
+
+	/* How choose_file() picks files, uniformly if NULL */
+	struct ffsb_popularity *pop;
 } randdata_t;
 
 uint32_t getrandom(randdata_t *rd, uint32_t mod);
 uint64_t getllrandom(randdata_t *rd, uint64_t mod);
 
+/* Uniform in [0, 1) */
+double getdrandom(randdata_t *rd);
+
 /* pass in thread-local state, and est. number of "uses" */
 /* pass in 0 for size if size is unknown/not important */
 void init_random(randdata_t *state, uint32_t size);
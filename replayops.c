@@ -0,0 +1,924 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#define _LARGEFILE64_SOURCE
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include "ffsb.h"
+#include "replayops.h"
+#include "fh.h"
+#include "util.h"
+
+enum replay_call {
+	REPLAY_OPEN,
+	REPLAY_CLOSE,
+	REPLAY_READ,
+	REPLAY_WRITE,
+	REPLAY_PREAD,
+	REPLAY_PWRITE,
+	REPLAY_LSEEK,
+	REPLAY_FSYNC,
+	REPLAY_FDATASYNC,
+	REPLAY_UNLINK,
+	REPLAY_RMDIR,
+	REPLAY_RENAME,
+	REPLAY_MKDIR,
+	REPLAY_STAT
+};
+
+/* One traced call.  fd is the descriptor number in the trace, path
+ * and path2 index the trace's path table.
+ */
+struct replay_rec {
+	uint64_t nsec;		/* since the first call in the trace */
+	uint64_t offset;
+	uint32_t size;
+	int fd;
+	int path;
+	int path2;
+	int flags;
+	uint8_t call;
+};
+
+struct replay_thread {
+	unsigned tid;
+	struct replay_rec *recs;
+	unsigned count, size;
+};
+
+struct replay_path {
+	char *name;
+	unsigned index;
+	struct replay_path *next;	/* hash chain */
+
+	/* Used before the trace creates it, so it's made at setup */
+	int preexist;
+	int is_dir;
+	uint64_t init_size;
+	int known;
+};
+
+#define REPLAY_HASH_SIZE 65536
+
+struct replay_trace {
+	char *filename;
+	int mode;
+	double scale;
+
+	struct replay_thread *threads;
+	unsigned num_threads;
+	unsigned num_recs;
+	uint32_t max_iosize;
+
+	struct replay_path **paths;
+	unsigned num_paths;
+
+	/* Descriptors are shared by all threads of the traced process,
+	 * fds maps the traced ones to ours
+	 */
+	pthread_mutex_t lock;
+	int *fds;
+	int num_fds;
+
+	/* Where and when it's being replayed */
+	ffsb_fs_t *fs;
+	char *dir;
+	uint64_t start;
+	struct replay_trace *next;	/* on fs->replays */
+};
+
+/* Parse time state */
+struct replay_parser {
+	struct replay_trace *rt;
+	struct replay_path **hash;
+	uint64_t first_nsec;
+	int have_first;
+
+	/* What each traced fd refers to, and its file position */
+	int *fdpath;
+	uint64_t *fdpos;
+	int num_fds;
+
+	/* Calls strace split across lines: "<unfinished ...>" */
+	struct {
+		unsigned tid;
+		uint64_t nsec;
+		char *head;
+	} *pending;
+	unsigned num_pending;
+};
+
+static unsigned hash_str(char *s)
+{
+	unsigned h = 5381;
+
+	while (*s)
+		h = h * 33 + (unsigned char)*s++;
+	return h % REPLAY_HASH_SIZE;
+}
+
+static struct replay_path *path_lookup(struct replay_parser *rp, char *name)
+{
+	struct replay_trace *rt = rp->rt;
+	unsigned h = hash_str(name);
+	struct replay_path *p;
+
+	for (p = rp->hash[h]; p; p = p->next)
+		if (!strcmp(p->name, name))
+			return p;
+
+	p = ffsb_malloc(sizeof(struct replay_path));
+	memset(p, 0, sizeof(struct replay_path));
+	p->name = ffsb_strdup(name);
+	p->index = rt->num_paths;
+	p->next = rp->hash[h];
+	rp->hash[h] = p;
+
+	if ((rt->num_paths & 1023) == 0)
+		rt->paths = ffsb_realloc(rt->paths, sizeof(*rt->paths) *
+					 (rt->num_paths + 1024));
+	rt->paths[rt->num_paths++] = p;
+	return p;
+}
+
+/* First use of a path the trace hasn't created means it existed
+ * before the trace started
+ */
+static void path_use(struct replay_path *p, int creates, int is_dir)
+{
+	if (!p->known && !creates) {
+		p->preexist = 1;
+		p->is_dir = is_dir;
+	}
+	p->known = 1;
+}
+
+static int valid_path(char *name)
+{
+	return strncmp(name, "/proc/", 6) && strncmp(name, "/sys/", 5) &&
+		strncmp(name, "/dev/", 5);
+}
+
+static void fd_grow(struct replay_parser *rp, int fd)
+{
+	int i;
+
+	if (fd < rp->num_fds)
+		return;
+	rp->fdpath = ffsb_realloc(rp->fdpath, sizeof(int) * (fd + 1));
+	rp->fdpos = ffsb_realloc(rp->fdpos, sizeof(uint64_t) * (fd + 1));
+	for (i = rp->num_fds; i <= fd; i++)
+		rp->fdpath[i] = -1;
+	rp->num_fds = fd + 1;
+}
+
+/* Path the traced fd was opened on, -1 if it wasn't opened in the
+ * trace (stdio, sockets, pipes...)
+ */
+static int fd_path(struct replay_parser *rp, int fd)
+{
+	if (fd < 0 || fd >= rp->num_fds)
+		return -1;
+	return rp->fdpath[fd];
+}
+
+/* Splits the argument list following '(' in place, honoring quotes
+ * and brackets.  Returns the number of args and points *after past
+ * the closing ')', or returns -1 if there isn't one.
+ */
+static int split_args(char *p, char **args, int max, char **after)
+{
+	int depth = 0, quoted = 0, n = 0;
+
+	while (*p == ' ')
+		p++;
+	if (*p == ')') {
+		*after = p + 1;
+		return 0;
+	}
+	args[n++] = p;
+	for (; *p; p++) {
+		if (quoted) {
+			if (*p == '\\' && p[1])
+				p++;
+			else if (*p == '"')
+				quoted = 0;
+			continue;
+		}
+		switch (*p) {
+		case '"':
+			quoted = 1;
+			break;
+		case '(': case '{': case '[':
+			depth++;
+			break;
+		case '}': case ']':
+			depth--;
+			break;
+		case ')':
+			if (depth-- == 0) {
+				*p = '\0';
+				*after = p + 1;
+				return n;
+			}
+			break;
+		case ',':
+			if (depth == 0) {
+				*p = '\0';
+				while (p[1] == ' ')
+					p++;
+				if (n == max)
+					return -1;
+				args[n++] = p + 1;
+			}
+			break;
+		}
+	}
+	return -1;
+}
+
+/* Unquotes a "path" arg in place, NULL if it isn't one */
+static char *get_path(char *arg)
+{
+	char *in, *out;
+
+	if (*arg != '"')
+		return NULL;
+	for (in = arg + 1, out = arg; *in && *in != '"'; in++) {
+		if (*in == '\\' && in[1])
+			in++;
+		*out++ = *in;
+	}
+	*out = '\0';
+	return arg;
+}
+
+static int get_open_flags(char *arg)
+{
+	static struct {
+		char *name;
+		int flag;
+	} names[] = {
+		{"O_WRONLY", O_WRONLY}, {"O_RDWR", O_RDWR},
+		{"O_CREAT", O_CREAT}, {"O_TRUNC", O_TRUNC},
+		{"O_APPEND", O_APPEND}, {"O_EXCL", O_EXCL},
+		{"O_DIRECTORY", O_DIRECTORY}, {"O_SYNC", O_SYNC},
+		{"O_DSYNC", O_DSYNC}, {NULL, 0} };
+	int flags = 0;
+	char *tok, *save;
+	int i;
+
+	for (tok = strtok_r(arg, "|", &save); tok;
+	     tok = strtok_r(NULL, "|", &save))
+		for (i = 0; names[i].name; i++)
+			if (!strcmp(tok, names[i].name))
+				flags |= names[i].flag;
+	return flags;
+}
+
+static struct replay_thread *get_thread(struct replay_trace *rt, unsigned tid)
+{
+	unsigned i;
+
+	for (i = 0; i < rt->num_threads; i++)
+		if (rt->threads[i].tid == tid)
+			return &rt->threads[i];
+
+	rt->threads = ffsb_realloc(rt->threads, sizeof(struct replay_thread) *
+				   (rt->num_threads + 1));
+	memset(&rt->threads[i], 0, sizeof(struct replay_thread));
+	rt->threads[i].tid = tid;
+	rt->num_threads++;
+	return &rt->threads[i];
+}
+
+static void add_rec(struct replay_trace *rt, unsigned tid,
+		    struct replay_rec *rec)
+{
+	struct replay_thread *rth = get_thread(rt, tid);
+
+	if (rth->count == rth->size) {
+		rth->size = rth->size ? rth->size * 2 : 256;
+		rth->recs = ffsb_realloc(rth->recs, sizeof(struct replay_rec) *
+					 rth->size);
+	}
+	rth->recs[rth->count++] = *rec;
+	rt->num_recs++;
+	if (rec->size > rt->max_iosize)
+		rt->max_iosize = rec->size;
+}
+
+/* Turns one complete call into a record, if it's one we replay */
+static void parse_call(struct replay_parser *rp, unsigned tid, uint64_t nsec,
+		       char *call)
+{
+	struct replay_rec rec;
+	struct replay_path *p, *p2;
+	char *args[8];
+	char *paren, *after, *name;
+	long long ret;
+	int argc, at, fd;
+
+	paren = strchr(call, '(');
+	if (!paren)
+		return;
+	*paren = '\0';
+	argc = split_args(paren + 1, args, 8, &after);
+	if (argc < 0 || sscanf(after, " = %lld", &ret) != 1 || ret < 0)
+		return;
+
+	memset(&rec, 0, sizeof(rec));
+	rec.nsec = nsec;
+	rec.fd = rec.path = rec.path2 = -1;
+
+	/* the *at() variants take a dirfd first */
+	at = !strcmp(call, "openat") || !strcmp(call, "unlinkat") ||
+		!strcmp(call, "mkdirat") || !strcmp(call, "renameat") ||
+		!strcmp(call, "renameat2") || !strcmp(call, "newfstatat") ||
+		!strcmp(call, "fstatat64") || !strcmp(call, "statx");
+
+	if (!strcmp(call, "open") || !strcmp(call, "openat") ||
+	    !strcmp(call, "creat")) {
+		if (argc < 1 + at || !(name = get_path(args[at])) ||
+		    !valid_path(name))
+			return;
+		rec.call = REPLAY_OPEN;
+		if (!strcmp(call, "creat"))
+			rec.flags = O_CREAT | O_WRONLY | O_TRUNC;
+		else if (argc > 1 + at)
+			rec.flags = get_open_flags(args[1 + at]);
+		p = path_lookup(rp, name);
+		path_use(p, rec.flags & O_CREAT, rec.flags & O_DIRECTORY);
+		rec.path = p->index;
+		rec.fd = ret;
+		fd_grow(rp, rec.fd);
+		rp->fdpath[rec.fd] = p->index;
+		rp->fdpos[rec.fd] = 0;
+	} else if (!strcmp(call, "close") || !strcmp(call, "read") ||
+		   !strcmp(call, "write") || !strcmp(call, "pread64") ||
+		   !strcmp(call, "pwrite64") || !strcmp(call, "lseek") ||
+		   !strcmp(call, "fsync") || !strcmp(call, "fdatasync")) {
+		if (argc < 1 || sscanf(args[0], "%d", &fd) != 1 ||
+		    fd_path(rp, fd) < 0)
+			return;
+		rec.fd = fd;
+		p = rp->rt->paths[fd_path(rp, fd)];
+
+		if (!strcmp(call, "close")) {
+			rec.call = REPLAY_CLOSE;
+			rp->fdpath[fd] = -1;
+		} else if (!strcmp(call, "fsync")) {
+			rec.call = REPLAY_FSYNC;
+		} else if (!strcmp(call, "fdatasync")) {
+			rec.call = REPLAY_FDATASYNC;
+		} else if (!strcmp(call, "lseek")) {
+			rec.call = REPLAY_LSEEK;
+			rec.offset = ret;
+			rp->fdpos[fd] = ret;
+		} else {
+			int pos = !strcmp(call, "pread64") ||
+				!strcmp(call, "pwrite64");
+			int write = !strcmp(call, "write") ||
+				!strcmp(call, "pwrite64");
+
+			if (pos) {
+				unsigned long long off;
+
+				if (argc < 4 ||
+				    sscanf(args[3], "%llu", &off) != 1)
+					return;
+				rec.offset = off;
+				rec.call = write ? REPLAY_PWRITE :
+					REPLAY_PREAD;
+			} else {
+				rec.offset = rp->fdpos[fd];
+				rp->fdpos[fd] += ret;
+				rec.call = write ? REPLAY_WRITE : REPLAY_READ;
+			}
+			rec.size = ret;
+			if (!write && p->preexist)
+				p->init_size = max(p->init_size,
+						   rec.offset + rec.size);
+		}
+	} else if (!strcmp(call, "unlink") || !strcmp(call, "unlinkat") ||
+		   !strcmp(call, "rmdir") || !strcmp(call, "mkdir") ||
+		   !strcmp(call, "mkdirat") || !strcmp(call, "stat") ||
+		   !strcmp(call, "lstat") || !strcmp(call, "stat64") ||
+		   !strcmp(call, "lstat64") || !strcmp(call, "newfstatat") ||
+		   !strcmp(call, "fstatat64") || !strcmp(call, "statx")) {
+		if (argc < 1 + at || !(name = get_path(args[at])) ||
+		    !*name || !valid_path(name))
+			return;
+		p = path_lookup(rp, name);
+		rec.path = p->index;
+
+		if (!strcmp(call, "rmdir") ||
+		    (!strcmp(call, "unlinkat") && argc > 2 &&
+		     strstr(args[2], "AT_REMOVEDIR"))) {
+			rec.call = REPLAY_RMDIR;
+			path_use(p, 0, 1);
+		} else if (!strncmp(call, "unlink", 6)) {
+			rec.call = REPLAY_UNLINK;
+			path_use(p, 0, 0);
+		} else if (!strncmp(call, "mkdir", 5)) {
+			rec.call = REPLAY_MKDIR;
+			path_use(p, 1, 1);
+		} else {
+			rec.call = REPLAY_STAT;
+			path_use(p, 0, 0);
+		}
+	} else if (!strcmp(call, "rename") || !strcmp(call, "renameat") ||
+		   !strcmp(call, "renameat2")) {
+		int second = at ? 3 : 1;
+
+		if (argc < second + 1 || !(name = get_path(args[at])) ||
+		    !valid_path(name))
+			return;
+		p = path_lookup(rp, name);
+		path_use(p, 0, 0);
+		if (!(name = get_path(args[second])) || !valid_path(name))
+			return;
+		p2 = path_lookup(rp, name);
+		path_use(p2, 1, 0);
+		rec.call = REPLAY_RENAME;
+		rec.path = p->index;
+		rec.path2 = p2->index;
+	} else {
+		return;
+	}
+
+	add_rec(rp->rt, tid, &rec);
+}
+
+/* Seconds since the epoch (-ttt) or midnight (-tt) */
+static int parse_time(char *tok, uint64_t *nsec)
+{
+	unsigned h, m;
+	double s;
+
+	if (sscanf(tok, "%u:%u:%lf", &h, &m, &s) == 3)
+		s += h * 3600.0 + m * 60.0;
+	else if (!strchr(tok, '.') || sscanf(tok, "%lf", &s) != 1)
+		return 0;
+	*nsec = (uint64_t)(s * 1000000000.0);
+	return 1;
+}
+
+static void parse_line(struct replay_parser *rp, char *line)
+{
+	char *p = line, *tok, *end, *call;
+	unsigned tid = 0;
+	uint64_t nsec;
+	char buf[4096];
+	unsigned i;
+
+	/* "[pid N] ", "N " or nothing, then the timestamp */
+	if (sscanf(p, "[pid %u]", &tid) == 1) {
+		p = strchr(p, ']') + 1;
+	} else {
+		while (*p == ' ')
+			p++;
+		tok = p;
+		end = strchr(p, ' ');
+		if (end && !memchr(tok, '.', end - tok) &&
+		    !memchr(tok, ':', end - tok)) {
+			tid = strtoul(tok, NULL, 10);
+			p = end;
+		}
+	}
+	while (*p == ' ')
+		p++;
+	tok = p;
+	p = strchr(p, ' ');
+	if (!p)
+		return;
+	*p++ = '\0';
+	if (!parse_time(tok, &nsec))
+		return;
+	while (*p == ' ')
+		p++;
+	call = p;
+
+	end = strstr(call, " <unfinished ...>");
+	if (end) {
+		*end = '\0';
+		rp->pending = ffsb_realloc(rp->pending, sizeof(*rp->pending) *
+					   (rp->num_pending + 1));
+		rp->pending[rp->num_pending].tid = tid;
+		rp->pending[rp->num_pending].nsec = nsec;
+		rp->pending[rp->num_pending].head = ffsb_strdup(call);
+		rp->num_pending++;
+		return;
+	}
+
+	if (!strncmp(call, "<... ", 5)) {
+		end = strstr(call, " resumed>");
+		if (!end)
+			return;
+		for (i = 0; i < rp->num_pending; i++)
+			if (rp->pending[i].tid == tid)
+				break;
+		if (i == rp->num_pending)
+			return;
+		snprintf(buf, sizeof(buf), "%s%s", rp->pending[i].head,
+			 end + strlen(" resumed>"));
+		nsec = rp->pending[i].nsec;
+		free(rp->pending[i].head);
+		rp->pending[i] = rp->pending[--rp->num_pending];
+		call = buf;
+	}
+
+	if (!rp->have_first) {
+		rp->first_nsec = nsec;
+		rp->have_first = 1;
+	}
+	parse_call(rp, tid, nsec > rp->first_nsec ? nsec - rp->first_nsec : 0,
+		   call);
+}
+
+struct replay_trace *replay_load(char *filename)
+{
+	struct replay_trace *rt = ffsb_malloc(sizeof(struct replay_trace));
+	struct replay_parser rp;
+	char *line = NULL;
+	size_t len = 0;
+	FILE *f;
+	unsigned i;
+
+	memset(rt, 0, sizeof(struct replay_trace));
+	memset(&rp, 0, sizeof(rp));
+	rt->filename = ffsb_strdup(filename);
+	rt->scale = 1.0;
+	pthread_mutex_init(&rt->lock, NULL);
+	rp.rt = rt;
+	rp.hash = ffsb_malloc(sizeof(struct replay_path *) * REPLAY_HASH_SIZE);
+	memset(rp.hash, 0, sizeof(struct replay_path *) * REPLAY_HASH_SIZE);
+
+	f = fopen(filename, "r");
+	if (f == NULL) {
+		perror(filename);
+		exit(1);
+	}
+	while (getline(&line, &len, f) > 0) {
+		line[strcspn(line, "\n")] = '\0';
+		parse_line(&rp, line);
+	}
+	fclose(f);
+	free(line);
+
+	for (i = 0; i < rp.num_pending; i++)
+		free(rp.pending[i].head);
+	free(rp.pending);
+	free(rp.hash);
+	free(rp.fdpath);
+	free(rp.fdpos);
+
+	if (!rt->num_recs) {
+		printf("Error: no replayable calls in trace %s\n", filename);
+		exit(1);
+	}
+
+	/* Traced fds are small, bound the map by the largest one used */
+	for (i = 0; i < rt->num_threads; i++) {
+		unsigned j;
+
+		for (j = 0; j < rt->threads[i].count; j++)
+			rt->num_fds = max(rt->num_fds,
+					  rt->threads[i].recs[j].fd + 1);
+	}
+	rt->fds = ffsb_malloc(sizeof(int) * (rt->num_fds + 1));
+	for (i = 0; i < rt->num_fds; i++)
+		rt->fds[i] = -1;
+
+	return rt;
+}
+
+void replay_free(struct replay_trace *rt)
+{
+	struct replay_trace **pp;
+	unsigned i;
+
+	/* A sweep frees its threadgroups between runs, the fs lives on */
+	if (rt->fs)
+		for (pp = &rt->fs->replays; *pp; pp = &(*pp)->next)
+			if (*pp == rt) {
+				*pp = rt->next;
+				break;
+			}
+	for (i = 0; i < rt->num_threads; i++)
+		free(rt->threads[i].recs);
+	free(rt->threads);
+	for (i = 0; i < rt->num_paths; i++) {
+		free(rt->paths[i]->name);
+		free(rt->paths[i]);
+	}
+	free(rt->paths);
+	if (rt->fds)
+		for (i = 0; i < rt->num_fds; i++)
+			if (rt->fds[i] >= 0)
+				close(rt->fds[i]);
+	free(rt->fds);
+	free(rt->dir);
+	free(rt->filename);
+	free(rt);
+}
+
+void replay_set_timing(struct replay_trace *rt, int mode, double scale)
+{
+	rt->mode = mode;
+	rt->scale = (mode == REPLAY_SCALED) ? scale : 1.0;
+}
+
+unsigned replay_num_threads(struct replay_trace *rt)
+{
+	return rt->num_threads;
+}
+
+uint32_t replay_max_iosize(struct replay_trace *rt)
+{
+	return rt->max_iosize;
+}
+
+void replay_print_config(struct replay_trace *rt)
+{
+	printf("\t replay_trace     = %s\n", rt->filename);
+	printf("\t                    %u threads, %u calls, %u paths\n",
+	       rt->num_threads, rt->num_recs, rt->num_paths);
+	if (rt->mode == REPLAY_FAST)
+		printf("\t replay_timing    = fast\n");
+	else if (rt->mode == REPLAY_SCALED)
+		printf("\t replay_timing    = scaled (x%.2lf)\n", rt->scale);
+	else
+		printf("\t replay_timing    = recorded\n");
+}
+
+void replay_attach(struct replay_trace *rt, ffsb_fs_t *fs, unsigned tg_num)
+{
+	char buf[FILENAME_MAX];
+
+	snprintf(buf, FILENAME_MAX, "%s/replay%u", fs_get_basedir(fs), tg_num);
+	rt->dir = ffsb_strdup(buf);
+	rt->fs = fs;
+	rt->next = fs->replays;
+	fs->replays = rt;
+}
+
+static void replay_name(struct replay_trace *rt, int path, char *buf)
+{
+	snprintf(buf, FILENAME_MAX, "%s/f%d", rt->dir, path);
+}
+
+/* Creates the trace's directory fresh, with every path the trace
+ * expects to already exist
+ */
+static void replay_setup(struct replay_trace *rt, ffsb_fs_t *fs)
+{
+	uint32_t blocksize = fs_get_create_blocksize(fs);
+	char *buf = ffsb_malloc(blocksize);
+	char name[FILENAME_MAX * 3];
+	struct replay_path *p;
+	unsigned i;
+	int fd;
+
+	memset(buf, 0, blocksize);
+	snprintf(name, FILENAME_MAX * 3, "rm -rf %s", rt->dir);
+	if (ffsb_system(name) < 0) {
+		perror(name);
+		exit(1);
+	}
+	ffsb_mkdir(rt->dir);
+
+	for (i = 0; i < rt->num_paths; i++) {
+		p = rt->paths[i];
+		if (!p->preexist)
+			continue;
+		replay_name(rt, i, name);
+		if (p->is_dir) {
+			ffsb_mkdir(name);
+			continue;
+		}
+		fd = open(name, O_CREAT | O_WRONLY | O_TRUNC, 0644);
+		if (fd < 0) {
+			perror(name);
+			exit(1);
+		}
+		if (p->init_size)
+			writefile_helper(fd, p->init_size, blocksize, buf,
+					 NULL, NULL);
+		close(fd);
+	}
+	free(buf);
+}
+
+void replay_bench(ffsb_fs_t *fs, unsigned opnum)
+{
+	struct replay_trace *rt;
+
+	for (rt = fs->replays; rt; rt = rt->next)
+		replay_setup(rt, fs);
+}
+
+static int replay_getfd(struct replay_trace *rt, int fd)
+{
+	int ret;
+
+	pthread_mutex_lock(&rt->lock);
+	ret = rt->fds[fd];
+	pthread_mutex_unlock(&rt->lock);
+	return ret;
+}
+
+static void replay_setfd(struct replay_trace *rt, int fd, int realfd)
+{
+	int old;
+
+	pthread_mutex_lock(&rt->lock);
+	old = rt->fds[fd];
+	rt->fds[fd] = realfd;
+	pthread_mutex_unlock(&rt->lock);
+
+	/* The close was lost to reordering, don't leak it */
+	if (old >= 0 && realfd >= 0)
+		close(old);
+}
+
+/* Issues one call, returns 0 if it failed */
+static int replay_rec(struct replay_trace *rt, struct replay_rec *rec,
+		      ffsb_thread_t *ft, ffsb_fs_t *fs)
+{
+	char name[FILENAME_MAX], name2[FILENAME_MAX];
+	char *buf = ft_getbuf(ft);
+	struct timeval start, end;
+	struct stat st;
+	syscall_t sys;
+	ssize_t ret = 0;
+	int fd = -1;
+
+	if (rec->path >= 0)
+		replay_name(rt, rec->path, name);
+	if (rec->call != REPLAY_OPEN && rec->fd >= 0) {
+		fd = replay_getfd(rt, rec->fd);
+		if (fd < 0)
+			return 0;
+	}
+
+	gettimeofday(&start, NULL);
+	switch (rec->call) {
+	case REPLAY_OPEN:
+		sys = (rec->flags & O_CREAT) ? SYS_CREATE : SYS_OPEN;
+		ret = open(name, rec->flags, 0644);
+		break;
+	case REPLAY_CLOSE:
+		sys = SYS_CLOSE;
+		replay_setfd(rt, rec->fd, -1);
+		ret = close(fd);
+		break;
+	case REPLAY_READ:
+		sys = SYS_READ;
+		ret = read(fd, buf, rec->size);
+		break;
+	case REPLAY_PREAD:
+		sys = SYS_READ;
+		ret = pread(fd, buf, rec->size, rec->offset);
+		break;
+	case REPLAY_WRITE:
+		sys = SYS_WRITE;
+		ret = write(fd, buf, rec->size);
+		break;
+	case REPLAY_PWRITE:
+		sys = SYS_WRITE;
+		ret = pwrite(fd, buf, rec->size, rec->offset);
+		break;
+	case REPLAY_LSEEK:
+		sys = SYS_LSEEK;
+		ret = lseek(fd, rec->offset, SEEK_SET);
+		break;
+	case REPLAY_FSYNC:
+		sys = SYS_FSYNC;
+		ret = fsync(fd);
+		break;
+	case REPLAY_FDATASYNC:
+		sys = SYS_FDATASYNC;
+		ret = fdatasync(fd);
+		break;
+	case REPLAY_UNLINK:
+		sys = SYS_UNLINK;
+		ret = unlink(name);
+		break;
+	case REPLAY_RMDIR:
+		sys = SYS_UNLINK;
+		ret = rmdir(name);
+		break;
+	case REPLAY_RENAME:
+		sys = SYS_RENAME;
+		replay_name(rt, rec->path2, name2);
+		ret = rename(name, name2);
+		break;
+	case REPLAY_MKDIR:
+		sys = SYS_MKDIR;
+		ret = mkdir(name, S_IRWXU);
+		break;
+	default:
+		sys = SYS_STAT;
+		ret = stat(name, &st);
+		break;
+	}
+	gettimeofday(&end, NULL);
+
+	if (ret < 0)
+		return 0;
+	do_stats(&start, &end, ft, fs, sys);
+
+	/* Calls that fail are part of the trace, so they don't go
+	 * through the fh wrappers, but their bytes still count
+	 * against the tg's bandwidth limits
+	 */
+	if (rec->call == REPLAY_OPEN) {
+		replay_setfd(rt, rec->fd, ret);
+	} else if (rec->call == REPLAY_READ || rec->call == REPLAY_PREAD) {
+		ft_add_readbytes(ft, ret);
+		ft_add_io_bytes(ft, 0, ret);
+	} else if (rec->call == REPLAY_WRITE ||
+		   rec->call == REPLAY_PWRITE) {
+		ft_add_writebytes(ft, ret);
+		ft_add_io_bytes(ft, 1, ret);
+	}
+	return 1;
+}
+
+void ffsb_replay(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
+{
+	struct replay_trace *rt = ft_get_replay(ft);
+	struct replay_thread *rth = &rt->threads[ft_get_thread_num(ft)];
+	unsigned *next = ft_get_opdata(ft, opnum);
+	struct replay_rec *rec;
+	uint64_t now;
+
+	if (!next) {
+		next = ffsb_malloc(sizeof(unsigned));
+		*next = 0;
+		ft_set_opdata(ft, next, opnum);
+
+		pthread_mutex_lock(&rt->lock);
+		if (!rt->start)
+			rt->start = ffsb_clock_nsec();
+		pthread_mutex_unlock(&rt->lock);
+	}
+
+	/* Done, idle until the run ends */
+	if (*next >= rth->count) {
+		ffsb_milli_sleep(100);
+		return;
+	}
+
+	rec = &rth->recs[(*next)++];
+	if (rt->mode != REPLAY_FAST)
+		ffsb_sleep_until(rt->start +
+				 (uint64_t)(rec->nsec / rt->scale));
+
+	/* Always the trace's own fs, whichever one we were handed */
+	if (!replay_rec(rt, rec, ft, rt->fs))
+		ft_add_replay_error(ft);
+	ft_incr_op(ft, opnum, 1, rec->size);
+
+	if (*next == rth->count) {
+		now = ffsb_clock_nsec();
+		ft_add_replay_done(ft, (now - rt->start) / 1000);
+	}
+}
+
+void ffsb_replay_print_exl(struct ffsb_op_results *results, double secs,
+			   unsigned op_num)
+{
+	printf("%s: %u calls, %llu failed", op_get_name(op_num),
+	       results->ops[op_num],
+	       (unsigned long long)results->replay_errors);
+	if (results->replay_done)
+		printf(", %u threads finished their trace, the last "
+		       "after %.2lf sec", results->replay_done,
+		       results->replay_done_usec / 1000000.0);
+	printf("\n");
+}
@@ -0,0 +1,68 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef _REPLAYOPS_H_
+#define _REPLAYOPS_H_
+
+#include "ffsb.h"
+#include "fileops.h"
+
+/* The replay op plays back a syscall trace captured from a real
+ * application with "strace -f -ttt" (-tt and -T are accepted too).
+ * open, openat, creat, close, read, write, pread64, pwrite64, lseek,
+ * fsync, fdatasync, unlink, unlinkat, rmdir, rename, renameat,
+ * mkdir, mkdirat and the stat family are replayed, anything else,
+ * failed calls and calls on descriptors the trace didn't open are
+ * dropped.  Each traced thread becomes one ffsb thread, which
+ * replays that thread's calls in order.
+ *
+ * Traced paths are mapped onto flat generated names under
+ * <basedir>/replay<tg>/ on the threadgroup's filesystem.  Paths the
+ * trace uses before creating them are created there at setup, sized
+ * to cover every read the trace makes of them.
+ *
+ * Calls are issued at their recorded time, as fast as possible, or
+ * at their recorded time divided by replay_scale.
+ */
+#define REPLAY_RECORDED 0
+#define REPLAY_FAST     1
+#define REPLAY_SCALED   2
+
+struct replay_trace;
+
+/* Parses a trace, exiting with a message if it can't be read or
+ * contains nothing to replay
+ */
+struct replay_trace *replay_load(char *filename);
+void replay_free(struct replay_trace *);
+
+void replay_set_timing(struct replay_trace *, int mode, double scale);
+unsigned replay_num_threads(struct replay_trace *);
+uint32_t replay_max_iosize(struct replay_trace *);
+void replay_print_config(struct replay_trace *);
+
+/* Replays the trace on fs, in <basedir>/replay<tg_num> */
+void replay_attach(struct replay_trace *, ffsb_fs_t *fs, unsigned tg_num);
+
+void ffsb_replay(struct ffsb_thread *, ffsb_fs_t *, unsigned);
+void ffsb_replay_print_exl(struct ffsb_op_results *, double secs,
+			   unsigned op_num);
+
+/* Creates the namespace of every trace attached to fs */
+void replay_bench(ffsb_fs_t *fs, unsigned opnum);
+
+#endif /* _REPLAYOPS_H_ */
@@ -0,0 +1,395 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#define _LARGEFILE64_SOURCE
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include "ffsb.h"
+#include "scanops.h"
+#include "fh.h"
+#include "util.h"
+
+/* Each walker owns a queue of directories still to be read.  The
+ * owner pushes and pops at the tail, so it goes depth first and stays
+ * in the part of the tree it just read, while idle walkers steal from
+ * the head, which holds the oldest (and usually largest) subtrees.
+ */
+struct scan_queue {
+	pthread_mutex_t lock;
+	char **dirs;
+	unsigned head, tail, size;
+};
+
+struct scan_state;
+
+struct scan_walker {
+	pthread_t ptid;
+	unsigned num;
+	struct scan_state *state;
+	struct scan_queue queue;
+
+	/* Helper of the owning thread, merged back into it once the
+	 * scan is done
+	 */
+	ffsb_thread_t ft;
+
+	uint64_t files;
+	uint64_t dirs;
+};
+
+struct scan_state {
+	ffsb_fs_t *fs;
+	unsigned num_walkers;
+	struct scan_walker *walkers;
+
+	/* Directories queued or being read, zero means we're done.
+	 * Walkers out of work sleep on cond until more directories
+	 * are queued, queued counts all that ever were so they can
+	 * tell.  stopped is set when the run ends under the scan, the
+	 * rest of the pass is abandoned.
+	 */
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	unsigned pending;
+	unsigned queued;
+	unsigned idle;
+	int stopped;
+};
+
+static void queue_push(struct scan_queue *q, char *dir)
+{
+	pthread_mutex_lock(&q->lock);
+	if (q->tail == q->size) {
+		if (q->head) {
+			memmove(q->dirs, q->dirs + q->head,
+				(q->tail - q->head) * sizeof(char *));
+			q->tail -= q->head;
+			q->head = 0;
+		} else {
+			q->size = q->size ? q->size * 2 : 64;
+			q->dirs = realloc(q->dirs, q->size * sizeof(char *));
+			if (q->dirs == NULL) {
+				perror("realloc");
+				exit(1);
+			}
+		}
+	}
+	q->dirs[q->tail++] = dir;
+	pthread_mutex_unlock(&q->lock);
+}
+
+static char *queue_pop(struct scan_queue *q)
+{
+	char *dir = NULL;
+
+	pthread_mutex_lock(&q->lock);
+	if (q->head != q->tail)
+		dir = q->dirs[--q->tail];
+	pthread_mutex_unlock(&q->lock);
+	return dir;
+}
+
+static char *queue_steal(struct scan_queue *q)
+{
+	char *dir = NULL;
+
+	pthread_mutex_lock(&q->lock);
+	if (q->head != q->tail)
+		dir = q->dirs[q->head++];
+	pthread_mutex_unlock(&q->lock);
+	return dir;
+}
+
+/* The directory is pending before it's on the queue, so the scan
+ * can't look done while it's read by another walker
+ */
+static void scan_add_dir(struct scan_walker *w, char *dir)
+{
+	struct scan_state *state = w->state;
+
+	pthread_mutex_lock(&state->lock);
+	state->pending++;
+	pthread_mutex_unlock(&state->lock);
+
+	queue_push(&w->queue, dir);
+
+	pthread_mutex_lock(&state->lock);
+	state->queued++;
+	if (state->idle)
+		pthread_cond_broadcast(&state->cond);
+	pthread_mutex_unlock(&state->lock);
+}
+
+static void scan_dir_done(struct scan_state *state)
+{
+	pthread_mutex_lock(&state->lock);
+	if (--state->pending == 0)
+		pthread_cond_broadcast(&state->cond);
+	pthread_mutex_unlock(&state->lock);
+}
+
+static unsigned scan_get_queued(struct scan_state *state)
+{
+	unsigned ret;
+
+	pthread_mutex_lock(&state->lock);
+	ret = state->queued;
+	pthread_mutex_unlock(&state->lock);
+	return ret;
+}
+
+/* Sleeps until more directories were queued than the seen ones,
+ * returns 0 if the scan is done or stopped instead
+ */
+static int scan_wait(struct scan_state *state, unsigned seen)
+{
+	int ret;
+
+	pthread_mutex_lock(&state->lock);
+	state->idle++;
+	while (state->pending && !state->stopped && state->queued == seen)
+		pthread_cond_wait(&state->cond, &state->lock);
+	state->idle--;
+	ret = (state->pending != 0 && !state->stopped);
+	pthread_mutex_unlock(&state->lock);
+	return ret;
+}
+
+/* A pass over a big tree can go on long after the run is over, so
+ * the walkers give up once the tg is told to stop
+ */
+static int scan_stopped(struct scan_walker *w)
+{
+	return tg_get_flagval(w->ft.tg) == tg_get_stopval(w->ft.tg);
+}
+
+static void scan_stop(struct scan_state *state)
+{
+	pthread_mutex_lock(&state->lock);
+	state->stopped = 1;
+	pthread_cond_broadcast(&state->cond);
+	pthread_mutex_unlock(&state->lock);
+}
+
+/* Files and directories can be removed under us by other
+ * threadgroups, so ENOENT is not an error for any of these.
+ */
+static int scan_stat(char *path, struct stat *st, ffsb_thread_t *ft,
+		     ffsb_fs_t *fs)
+{
+	struct timeval start, end;
+	int ret;
+	int need_stats = ft_needs_stats(ft, SYS_STAT) ||
+		fs_needs_stats(fs, SYS_STAT);
+
+	if (need_stats)
+		gettimeofday(&start, NULL);
+
+	ret = lstat(path, st);
+
+	if (need_stats) {
+		gettimeofday(&end, NULL);
+		do_stats(&start, &end, ft, fs, SYS_STAT);
+	}
+
+	if (ret < 0 && errno != ENOENT) {
+		perror(path);
+		exit(1);
+	}
+	return ret;
+}
+
+static uint64_t scan_readfile(char *path, ffsb_thread_t *ft, ffsb_fs_t *fs)
+{
+	char *buf = ft_getbuf(ft);
+	uint32_t blocksize = ft_get_read_blocksize(ft);
+	uint64_t bytes = 0;
+	uint32_t ret;
+	int fd;
+
+	fd = fhtryopenread(path, ft, fs);
+	if (fd < 0)
+		return 0;
+
+	do {
+		ret = fhreadsome(fd, buf, blocksize, ft, fs);
+		bytes += ret;
+	} while (ret == blocksize);
+
+	fhclose(fd, ft, fs);
+	return bytes;
+}
+
+static void scan_dir(struct scan_walker *w, char *dirname)
+{
+	ffsb_fs_t *fs = w->state->fs;
+	char path[FILENAME_MAX];
+	struct dirent *dent;
+	struct stat st;
+	DIR *dir;
+
+	dir = opendir(dirname);
+	if (dir == NULL) {
+		if (errno == ENOENT)
+			return;
+		perror(dirname);
+		exit(1);
+	}
+	w->dirs++;
+
+	while (!scan_stopped(w) && (dent = readdir(dir)) != NULL) {
+		if (!strcmp(dent->d_name, ".") || !strcmp(dent->d_name, ".."))
+			continue;
+
+		snprintf(path, FILENAME_MAX, "%s/%s", dirname, dent->d_name);
+		if (scan_stat(path, &st, &w->ft, fs) < 0)
+			continue;
+
+		if (S_ISDIR(st.st_mode)) {
+			scan_add_dir(w, ffsb_strdup(path));
+		} else if (S_ISREG(st.st_mode)) {
+			uint64_t bytes = scan_readfile(path, &w->ft, fs);
+			ft_add_readbytes(&w->ft, bytes);
+			w->files++;
+		}
+	}
+	closedir(dir);
+}
+
+static char *scan_get_work(struct scan_walker *w)
+{
+	struct scan_state *state = w->state;
+	char *dir;
+	unsigned i;
+
+	dir = queue_pop(&w->queue);
+	for (i = 1; !dir && i < state->num_walkers; i++)
+		dir = queue_steal(&state->walkers[(w->num + i) %
+						  state->num_walkers].queue);
+	return dir;
+}
+
+static void *scan_walker_run(void *data)
+{
+	struct scan_walker *w = (struct scan_walker *)data;
+	unsigned seen;
+	char *dir;
+
+	while (!scan_stopped(w)) {
+		seen = scan_get_queued(w->state);
+		dir = scan_get_work(w);
+		if (dir == NULL) {
+			if (!scan_wait(w->state, seen))
+				break;
+			continue;
+		}
+		scan_dir(w, dir);
+		free(dir);
+		scan_dir_done(w->state);
+	}
+	if (scan_stopped(w))
+		scan_stop(w->state);
+	return NULL;
+}
+
+void ffsb_scan(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
+{
+	struct scan_state state;
+	struct scan_walker *w;
+	struct timeval start, end;
+	pthread_attr_t attr;
+	uint64_t files = 0, dirs = 0, bytes = 0;
+	unsigned i;
+
+	memset(&state, 0, sizeof(state));
+	state.fs = fs;
+	state.num_walkers = ft_get_scan_threads(ft);
+	state.walkers = ffsb_malloc(state.num_walkers *
+				    sizeof(struct scan_walker));
+	pthread_mutex_init(&state.lock, NULL);
+	pthread_cond_init(&state.cond, NULL);
+
+	for (i = 0; i < state.num_walkers; i++) {
+		w = &state.walkers[i];
+		memset(w, 0, sizeof(*w));
+		w->num = i;
+		w->state = &state;
+		pthread_mutex_init(&w->queue.lock, NULL);
+		ft_init_helper(&w->ft, ft, ft_get_read_blocksize(ft));
+	}
+
+	state.pending = 1;
+	queue_push(&state.walkers[0].queue, ffsb_strdup(fs_get_basedir(fs)));
+
+	pthread_attr_init(&attr);
+	pthread_attr_setscope(&attr, PTHREAD_SCOPE_SYSTEM);
+
+	gettimeofday(&start, NULL);
+
+	/* The calling thread is walker 0 */
+	for (i = 1; i < state.num_walkers; i++) {
+		w = &state.walkers[i];
+		pthread_create(&w->ptid, &attr, scan_walker_run, w);
+	}
+	scan_walker_run(&state.walkers[0]);
+	for (i = 1; i < state.num_walkers; i++)
+		pthread_join(state.walkers[i].ptid, NULL);
+
+	gettimeofday(&end, NULL);
+
+	for (i = 0; i < state.num_walkers; i++) {
+		w = &state.walkers[i];
+		files += w->files;
+		dirs += w->dirs;
+		bytes += w->ft.results.read_bytes;
+
+		ft_merge_helper(ft, &w->ft);
+		/* left over if the scan was stopped */
+		while (w->queue.head != w->queue.tail)
+			free(w->queue.dirs[w->queue.head++]);
+		free(w->queue.dirs);
+		pthread_mutex_destroy(&w->queue.lock);
+	}
+	pthread_cond_destroy(&state.cond);
+	pthread_mutex_destroy(&state.lock);
+	free(state.walkers);
+
+	ft_add_scan(ft, files, dirs, tvdiff_usec(&start, &end));
+	ft_incr_op(ft, opnum, files + dirs, bytes);
+}
+
+void ffsb_scan_print_exl(struct ffsb_op_results *results, double secs,
+			 unsigned op_num)
+{
+	unsigned passes = results->op_weight[op_num];
+
+	printf("%s: %u passes, %llu dirs and %llu files, "
+	       "avg %.2lf sec per pass\n", op_get_name(op_num), passes,
+	       (unsigned long long)results->scan_dirs,
+	       (unsigned long long)results->scan_files,
+	       (double)results->scan_usec / passes / 1000000.0);
+}
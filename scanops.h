@@ -0,0 +1,35 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef _SCANOPS_H_
+#define _SCANOPS_H_
+
+#include "ffsb.h"
+#include "fileops.h"
+
+/* The scan op walks the whole tree under the filesystem's basedir,
+ * stat()ing every entry and reading every file sequentially, the way
+ * a backup or indexing job would.  The walk is split between
+ * scan_threads cooperating walkers which steal directories from each
+ * other's queues when they run out of work.
+ */
+void ffsb_scan(struct ffsb_thread *, ffsb_fs_t *, unsigned);
+
+void ffsb_scan_print_exl(struct ffsb_op_results *, double secs,
+			 unsigned op_num);
+
+#endif /* _SCANOPS_H_ */
@@ -0,0 +1,259 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "schedule.h"
+#include "ffsb_tg.h"
+#include "util.h"
+
+static char *shape_names[] = {
+	"constant",
+	"ramp",
+	"diurnal",
+	NULL
+};
+
+int schedule_shape(char *name)
+{
+	int i;
+
+	for (i = 0; shape_names[i]; i++)
+		if (!strcmp(name, shape_names[i]))
+			return i;
+	return -1;
+}
+
+struct schedule *schedule_alloc(unsigned interval, int repeat)
+{
+	struct schedule *s = ffsb_malloc(sizeof(*s));
+
+	memset(s, 0, sizeof(*s));
+	s->interval = interval;
+	s->repeat = repeat;
+	return s;
+}
+
+void schedule_add(struct schedule *s, struct sched_seg *seg)
+{
+	s->segs = ffsb_realloc(s->segs, (s->num_segs + 1) * sizeof(*seg));
+	s->segs[s->num_segs++] = *seg;
+}
+
+void schedule_free(struct schedule *s)
+{
+	unsigned i;
+
+	for (i = 0; i < s->num_segs; i++)
+		free(s->segs[i].weights);
+	free(s->segs);
+	free(s);
+}
+
+void schedule_print_config(struct schedule *s)
+{
+	struct sched_seg *seg;
+	unsigned i, j, start = 0;
+
+	printf("\t schedule%s, reporting every %u sec\n",
+	       s->repeat ? " (repeating)" : "", s->interval);
+	for (i = 0; i < s->num_segs; i++) {
+		seg = &s->segs[i];
+		printf("\t   %5u-%-5u sec %-8s", start, start + seg->duration,
+		       shape_names[seg->shape]);
+		if (seg->rate == seg->rate_end && seg->rate)
+			printf(" rate %.2lf/sec", seg->rate);
+		else if (seg->rate)
+			printf(" rate %.2lf->%.2lf/sec", seg->rate,
+			       seg->rate_end);
+		if (seg->threads == seg->threads_end && seg->threads)
+			printf(" threads %u", seg->threads);
+		else if (seg->threads)
+			printf(" threads %u->%u", seg->threads,
+			       seg->threads_end);
+		if (seg->shape == SCHED_DIURNAL)
+			printf(" period %u sec", seg->period);
+		if (seg->weights) {
+			printf(" weights");
+			for (j = 0; j < FFSB_NUMOPS; j++)
+				if (seg->weights->weights[j])
+					printf(" %s:%u", op_get_name(j),
+					       seg->weights->weights[j]);
+		}
+		printf("\n");
+		start += seg->duration;
+	}
+}
+
+/* Where a segment's values are, frac of the way through it, secs
+ * into it
+ */
+static double seg_value(struct sched_seg *seg, double from, double to,
+			double frac, double secs)
+{
+	switch (seg->shape) {
+	case SCHED_RAMP:
+		return from + (to - from) * frac;
+	case SCHED_DIURNAL:
+		return from + (to - from) *
+			(1.0 - cos(2.0 * M_PI * secs / seg->period)) / 2.0;
+	}
+	return from;
+}
+
+static struct sched_seg *find_seg(struct schedule *s, double secs,
+				  double *into)
+{
+	double total = 0;
+	unsigned i;
+
+	for (i = 0; i < s->num_segs; i++)
+		total += s->segs[i].duration;
+	if (s->repeat)
+		secs = fmod(secs, total);
+
+	for (i = 0; i < s->num_segs; i++) {
+		if (secs < s->segs[i].duration || i == s->num_segs - 1)
+			break;
+		secs -= s->segs[i].duration;
+	}
+	*into = min(secs, (double)s->segs[i].duration);
+	return &s->segs[i];
+}
+
+static void schedule_apply(struct schedule *s, double secs)
+{
+	ffsb_tg_t *tg = s->tg;
+	struct sched_seg *seg;
+	double into, frac;
+
+	seg = find_seg(s, secs, &into);
+	frac = into / seg->duration;
+
+	if (seg->rate)
+		tg_set_sched_rate(tg, seg_value(seg, seg->rate, seg->rate_end,
+						frac, into));
+	else
+		tg_set_sched_rate(tg, s->base_rate);
+
+	if (seg->threads)
+		tg_set_active_threads(tg, seg_value(seg, seg->threads,
+						    seg->threads_end,
+						    frac, into) + 0.5);
+	else
+		tg_set_active_threads(tg, tg_get_numthreads(tg));
+
+	tg_set_sched_weights(tg, seg->weights);
+}
+
+static uint64_t results_ops(ffsb_op_results_t *r, uint64_t *trans)
+{
+	uint64_t ops = 0;
+	int i;
+
+	*trans = 0;
+	for (i = 0; i < FFSB_NUMOPS; i++) {
+		ops += r->op_weight[i];
+		*trans += r->ops[i];
+	}
+	return ops;
+}
+
+/* Counters go back to zero when the warmup ends */
+static uint64_t since(uint64_t cur, uint64_t last)
+{
+	return (cur >= last) ? cur - last : cur;
+}
+
+static void schedule_report(struct schedule *s, double secs,
+			    ffsb_op_results_t *last, ffsb_op_results_t *cur)
+{
+	uint64_t ops, trans, last_ops, last_trans;
+	char buf[256], buf2[256];
+
+	init_ffsb_op_results(cur);
+	tg_collect_results(s->tg, cur);
+
+	ops = results_ops(cur, &trans);
+	last_ops = results_ops(last, &last_trans);
+
+	printf("tg %u %7.1f sec: %3u threads, rate ", tg_get_tgnum(s->tg),
+	       secs, tg_get_active_threads(s->tg));
+	if (tg_get_sched_rate(s->tg))
+		printf("%.1lf/sec", tg_get_sched_rate(s->tg));
+	else
+		printf("unlimited");
+	printf(", %.1lf ops/sec, %.1lf trans/sec, read %s/sec, "
+	       "write %s/sec\n",
+	       (double)since(ops, last_ops) / s->interval,
+	       (double)since(trans, last_trans) / s->interval,
+	       ffsb_printsize(buf, (double)since(cur->read_bytes,
+					 last->read_bytes) / s->interval, 256),
+	       ffsb_printsize(buf2, (double)since(cur->write_bytes,
+					  last->write_bytes) / s->interval,
+			      256));
+	fflush(stdout);
+}
+
+static void *schedule_run(void *data)
+{
+	struct schedule *s = data;
+	ffsb_tg_t *tg = s->tg;
+	ffsb_op_results_t *last, *cur, *tmp;
+	uint64_t start = ffsb_clock_nsec();
+	uint64_t report = start + s->interval * 1000000000ULL;
+	uint64_t now;
+
+	last = ffsb_malloc(sizeof(*last));
+	cur = ffsb_malloc(sizeof(*cur));
+	init_ffsb_op_results(last);
+
+	while (tg_get_flagval(tg) != tg_get_stopval(tg)) {
+		now = ffsb_clock_nsec();
+		if (now >= report) {
+			schedule_report(s, (report - start) / 1000000000.0,
+					last, cur);
+			tmp = last;
+			last = cur;
+			cur = tmp;
+			report += s->interval * 1000000000ULL;
+		}
+		schedule_apply(s, (now - start) / 1000000000.0);
+		ffsb_sleep_until(now + SCHED_TICK_NSEC);
+	}
+
+	free(last);
+	free(cur);
+	return NULL;
+}
+
+void schedule_start(struct schedule *s, ffsb_tg_t *tg)
+{
+	s->tg = tg;
+	s->base_rate = tg_get_sched_rate(tg);
+	schedule_apply(s, 0);
+	pthread_create(&s->thread, NULL, schedule_run, s);
+}
+
+void schedule_stop(struct schedule *s)
+{
+	pthread_join(s->thread, NULL);
+	tg_set_sched_weights(s->tg, NULL);
+}
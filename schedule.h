@@ -0,0 +1,84 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef _SCHEDULE_H_
+#define _SCHEDULE_H_
+
+#include <pthread.h>
+
+#include "ffsb_op.h"
+
+struct ffsb_tg;
+
+/* A threadgroup's load can follow a schedule, a list of segments
+ * from [schedule] sections, run in order.  Over each one the rate
+ * (arrival_rate in open loop, otherwise ops_limit) and the number of
+ * active threads are held constant, ramped linearly from their start
+ * to their end values, or follow a diurnal curve between them:
+ * starting at the first, peaking at the second halfway through each
+ * period.  A segment may also reweight the tg's ops.  Anything a
+ * segment doesn't set is the tg's own value.
+ *
+ * A controller thread applies it every SCHED_TICK_NSEC and prints
+ * the tg's results for every interval.
+ */
+#define SCHED_CONSTANT	0
+#define SCHED_RAMP	1
+#define SCHED_DIURNAL	2
+
+#define SCHED_TICK_NSEC	100000000ULL
+
+struct sched_weights {
+	unsigned weights[FFSB_NUMOPS];
+	unsigned sum;
+};
+
+struct sched_seg {
+	unsigned duration;		/* secs */
+	int shape;
+	double rate;			/* 0 is the tg's own */
+	double rate_end;
+	unsigned threads;		/* 0 is all of them */
+	unsigned threads_end;
+	unsigned period;		/* secs, diurnal */
+	struct sched_weights *weights;	/* NULL is the tg's own */
+};
+
+struct schedule {
+	struct sched_seg *segs;
+	unsigned num_segs;
+	unsigned interval;		/* secs between reports */
+	int repeat;
+
+	struct ffsb_tg *tg;
+	double base_rate;
+	pthread_t thread;
+};
+
+int schedule_shape(char *name);
+struct schedule *schedule_alloc(unsigned interval, int repeat);
+void schedule_add(struct schedule *, struct sched_seg *);
+void schedule_free(struct schedule *);
+void schedule_print_config(struct schedule *);
+
+/* Called by tg_run() once its threads are going, and after they've
+ * been told to stop
+ */
+void schedule_start(struct schedule *, struct ffsb_tg *);
+void schedule_stop(struct schedule *);
+
+#endif /* _SCHEDULE_H_ */
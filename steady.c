@@ -0,0 +1,123 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "steady.h"
+#include "ffsb.h"
+#include "ffsb_tg.h"
+#include "util.h"
+
+void steady_print_config(ffsb_steady_t *st)
+{
+	if (!st->window)
+		return;
+	printf("wait for steady state, %u to %u rounds of %u sec, "
+	       "excursion %g%%, slope %g%%\n", st->rounds,
+	       st->max_rounds, st->window, st->excursion, st->slope);
+}
+
+/* How far the last n values stray from their average (max - min),
+ * and how much the least squares line through them moves from the
+ * first to the last, both in percent of the average
+ */
+static void steady_check(double *vals, unsigned n, double *range,
+			 double *slope)
+{
+	double avg = 0.0, lo = vals[0], hi = vals[0];
+	double xmean = (n - 1) / 2.0, num = 0.0, den = 0.0;
+	unsigned i;
+
+	for (i = 0; i < n; i++) {
+		avg += vals[i];
+		lo = min(lo, vals[i]);
+		hi = max(hi, vals[i]);
+	}
+	avg /= n;
+	for (i = 0; i < n; i++) {
+		num += (i - xmean) * (vals[i] - avg);
+		den += (i - xmean) * (i - xmean);
+	}
+	if (avg <= 0.0) {
+		*range = *slope = 100.0;
+		return;
+	}
+	*range = 100.0 * (hi - lo) / avg;
+	*slope = 100.0 * fabs(num / den * (n - 1)) / avg;
+}
+
+static void steady_sample(struct ffsb_config *fc, uint64_t *ops,
+			  uint64_t *nsec)
+{
+	unsigned i;
+
+	*ops = *nsec = 0;
+	for (i = 0; i < fc->num_threadgroups; i++)
+		tg_add_done(&fc->groups[i], ops, nsec);
+}
+
+unsigned steady_wait(ffsb_steady_t *st, struct ffsb_config *fc,
+		     uint64_t start)
+{
+	double *tput = ffsb_malloc(sizeof(double) * st->max_rounds);
+	double *lat = ffsb_malloc(sizeof(double) * st->max_rounds);
+	double tput_range, tput_slope, lat_range, lat_slope;
+	uint64_t ops, nsec, last_ops, last_nsec;
+	unsigned round, first, ret = 0;
+
+	steady_sample(fc, &last_ops, &last_nsec);
+	for (round = 0; round < st->max_rounds; round++) {
+		start += st->window * 1000000000ULL;
+		ffsb_sleep_until(start);
+		steady_sample(fc, &ops, &nsec);
+
+		tput[round] = (double)(ops - last_ops) / st->window;
+		lat[round] = ops > last_ops ?
+			(nsec - last_nsec) / 1000000.0 / (ops - last_ops) : 0;
+		last_ops = ops;
+		last_nsec = nsec;
+		printf("Steady state round %u: %.2lf ops/sec, %.3lf msec "
+		       "avg latency\n", round + 1, tput[round], lat[round]);
+
+		if (round + 1 < st->rounds)
+			continue;
+		first = round + 1 - st->rounds;
+		steady_check(tput + first, st->rounds, &tput_range,
+			     &tput_slope);
+		steady_check(lat + first, st->rounds, &lat_range, &lat_slope);
+		if (tput_range <= st->excursion && tput_slope <= st->slope &&
+		    lat_range <= st->excursion && lat_slope <= st->slope) {
+			printf("Steady state reached after %u rounds: "
+			       "ops/sec within %.1lf%% (slope %.1lf%%), "
+			       "latency within %.1lf%% (slope %.1lf%%)\n",
+			       round + 1, tput_range, tput_slope, lat_range,
+			       lat_slope);
+			ret = round + 1;
+			break;
+		}
+	}
+	if (!ret)
+		printf("Steady state not reached in %u rounds, measuring "
+		       "anyway\n", st->max_rounds);
+	fflush(stdout);
+	free(tput);
+	free(lat);
+	return ret;
+}
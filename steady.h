@@ -0,0 +1,54 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef _STEADY_H_
+#define _STEADY_H_
+
+#include <inttypes.h>
+
+struct ffsb_config;
+
+/* Instead of a fixed warmup a run can wait for steady state, in the
+ * style of the SNIA PTS: throughput and mean op latency are sampled
+ * over rounds of window secs, and once the last "rounds" of them all
+ * lie within excursion percent of their average (max - min), with
+ * the least squares line through them moving less than slope percent
+ * of the average across the rounds, the measurement starts.  If it
+ * hasn't happened after max_rounds it starts anyway.
+ */
+#define STEADY_ROUNDS		5
+#define STEADY_MAX_ROUNDS	25
+#define STEADY_EXCURSION	20.0
+#define STEADY_SLOPE		10.0
+
+typedef struct ffsb_steady {
+	unsigned window;		/* secs, 0 is off */
+	unsigned rounds;
+	unsigned max_rounds;
+	double excursion;		/* percent of the average */
+	double slope;
+} ffsb_steady_t;
+
+void steady_print_config(ffsb_steady_t *);
+
+/* Called by the main thread once the threads are going, from start
+ * (nsecs) on.  Returns the number of rounds it took, or 0 if steady
+ * state wasn't reached in max_rounds.
+ */
+unsigned steady_wait(ffsb_steady_t *, struct ffsb_config *, uint64_t start);
+
+#endif /* _STEADY_H_ */
@@ -0,0 +1,177 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#define _LARGEFILE64_SOURCE
+#include <unistd.h>
+#include <sys/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ffsb.h"
+#include "streamops.h"
+#include "fh.h"
+#include "util.h"
+
+/* A thread's open stream, kept across ops in the thread's op data */
+struct stream {
+	struct ffsb_file *file;
+	ffsb_fs_t *fs;
+	int fd;
+	int write;
+	uint64_t offset;
+	uint64_t size;
+	uint64_t start;		/* nsecs, ffsb_clock_nsec() */
+};
+
+static struct stream *stream_get(ffsb_thread_t *ft, unsigned opnum)
+{
+	struct stream *s = ft_get_opdata(ft, opnum);
+
+	if (!s) {
+		s = ffsb_malloc(sizeof(struct stream));
+		s->file = NULL;
+		ft_set_opdata(ft, s, opnum);
+	}
+	return s;
+}
+
+static void stream_open(struct stream *s, ffsb_thread_t *ft, ffsb_fs_t *fs,
+			unsigned opnum, int write)
+{
+	struct benchfiles *bf = (struct benchfiles *)fs_get_opdata(fs, opnum);
+	randdata_t *rd = ft_get_randdata(ft);
+
+	if (write) {
+		s->size = choose_create_size(fs, rd);
+		s->file = add_file(bf, s->size, rd);
+		s->fd = fhopencreate(s->file->name, ft, fs);
+	} else {
+		s->file = choose_file_reader(bf, rd);
+		s->size = s->file->size;
+		s->fd = fhopenread(s->file->name, ft, fs);
+	}
+	s->fs = fs;
+	s->write = write;
+	s->offset = 0;
+	s->start = ffsb_clock_nsec();
+}
+
+static void stream_close(struct stream *s, ffsb_thread_t *ft)
+{
+	fhclose(s->fd, ft, s->fs);
+	if (s->write) {
+		s->file->size = s->offset;
+		unlock_file_writer(s->file);
+	} else {
+		unlock_file_reader(s->file);
+	}
+	s->file = NULL;
+}
+
+/* Nanoseconds into the stream at which byte offset is due */
+static uint64_t stream_due(uint64_t offset, uint64_t rate)
+{
+	return (uint64_t)((double)offset * 1000000000.0 / rate);
+}
+
+static void ffsb_stream_core(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum,
+			     int write)
+{
+	struct stream *s = stream_get(ft, opnum);
+	uint64_t rate = ft_get_stream_rate(ft);
+	uint64_t deadline, now;
+	uint32_t blocksize;
+	uint32_t len;
+	char *buf = ft_getbuf(ft);
+
+	if (!s->file)
+		stream_open(s, ft, fs, opnum, write);
+
+	if (s->offset >= s->size) {
+		stream_close(s, ft);
+		return;
+	}
+
+	blocksize = write ? ft_get_write_blocksize(ft) :
+		ft_get_read_blocksize(ft);
+	len = min(blocksize, s->size - s->offset);
+	deadline = s->start + stream_due(s->offset + len, rate);
+
+	ffsb_sleep_until(s->start + stream_due(s->offset, rate));
+
+	if (write)
+		fhwrite(s->fd, buf, len, ft, fs);
+	else
+		fhread(s->fd, buf, len, ft, fs);
+
+	now = ffsb_clock_nsec();
+	if (now > deadline)
+		ft_add_stream_late(ft, write, (now - deadline) / 1000);
+
+	s->offset += len;
+	ft_incr_op(ft, opnum, 1, len);
+	if (write)
+		ft_add_writebytes(ft, len);
+	else
+		ft_add_readbytes(ft, len);
+
+	if (s->offset >= s->size)
+		stream_close(s, ft);
+}
+
+void ffsb_stream_read(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
+{
+	ffsb_stream_core(ft, fs, opnum, 0);
+}
+
+void ffsb_stream_write(ffsb_thread_t *ft, ffsb_fs_t *fs, unsigned opnum)
+{
+	ffsb_stream_core(ft, fs, opnum, 1);
+}
+
+void ffsb_stream_print_exl(struct ffsb_op_results *results, double secs,
+			   unsigned op_num)
+{
+	int write = (op_num == ops_find_op("stream_write"));
+	ffsb_hist_t *h = &results->stream_late[write];
+	unsigned chunks = results->ops[op_num];
+
+	if (!chunks)
+		return;
+
+	printf("%s: %u chunks, %llu missed deadline (%.2lf%%)",
+	       op_get_name(op_num), chunks, (unsigned long long)h->count,
+	       100.0 * h->count / chunks);
+	if (h->count)
+		printf(", late avg %.3lf p99 %.3lf max %.3lf msec",
+		       ffsb_hist_mean(h) / 1000.0,
+		       ffsb_hist_percentile(h, 99.0) / 1000.0,
+		       h->max / 1000.0);
+	printf("\n");
+}
+
+void stream_finish(ffsb_thread_t *ft)
+{
+	struct stream *s;
+
+	s = ft_get_opdata(ft, ops_find_op("stream_read"));
+	if (s && s->file)
+		stream_close(s, ft);
+	s = ft_get_opdata(ft, ops_find_op("stream_write"));
+	if (s && s->file)
+		stream_close(s, ft);
+}
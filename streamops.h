@@ -0,0 +1,48 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef _STREAMOPS_H_
+#define _STREAMOPS_H_
+
+#include "ffsb.h"
+#include "fileops.h"
+
+/* The stream ops model media-style readers and writers.  Each thread
+ * owns one file at a time and moves through it sequentially, one
+ * read_blocksize (or write_blocksize) chunk per op, paced at
+ * stream_rate bytes/sec.  Chunk n of a stream is released at
+ * start + offset/stream_rate and is due when the next one is
+ * released; the clock is absolute, so a slow chunk doesn't push the
+ * rest of the stream back.  Chunks finishing after their deadline are
+ * counted as misses along with how late they were.
+ *
+ * stream_read plays back an existing file from the data fileset,
+ * stream_write records a new one.  op_delay is applied on top of the
+ * pacing and should normally be left at 0.
+ */
+void ffsb_stream_read(struct ffsb_thread *, ffsb_fs_t *, unsigned);
+void ffsb_stream_write(struct ffsb_thread *, ffsb_fs_t *, unsigned);
+
+void ffsb_stream_print_exl(struct ffsb_op_results *, double secs,
+			   unsigned op_num);
+
+/* Closes any stream the thread left open when the run ended, so a
+ * partly recorded file keeps only the bytes actually written
+ */
+void stream_finish(struct ffsb_thread *);
+
+#endif /* _STREAMOPS_H_ */
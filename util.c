@@ -29,6 +29,7 @@
 #include <limits.h>
 #include <errno.h>
 #include <pthread.h>
+#include <time.h>
 
 #include "config.h"
 #include "fh.h"
@@ -154,6 +155,14 @@ struct timeval tvadd(struct timeval t1, struct timeval t0)
 	return tdiff;
 }
 
+uint64_t tvdiff_usec(struct timeval *start, struct timeval *end)
+{
+	struct timeval diff;
+
+	timersub(end, start, &diff);
+	return 1000000ULL * diff.tv_sec + diff.tv_usec;
+}
+
 double tvtodouble(struct timeval *t)
 {
 	return ((double)t->tv_sec*(1000000.0f) + (double)t->tv_usec) /
@@ -249,6 +258,22 @@ void ffsb_sync()
 	printf("%ld sec\n", difftime.tv_sec);
 }
 
+/* Needs root, otherwise it says so and carries on */
+void ffsb_drop_caches(void)
+{
+	FILE *f;
+
+	ffsb_sync();
+	f = fopen("/proc/sys/vm/drop_caches", "w");
+	if (f == NULL) {
+		perror("/proc/sys/vm/drop_caches");
+		return;
+	}
+	fputs("3\n", f);
+	if (fclose(f) == EOF)
+		perror("/proc/sys/vm/drop_caches");
+}
+
 void ffsb_getrusage(struct rusage *ru_self, struct rusage *ru_children)
 {
 	int ret = 0;
@@ -283,6 +308,25 @@ void ffsb_micro_sleep(unsigned time)
 	select(0, NULL, NULL, NULL, &tv);
 }
 
+uint64_t ffsb_clock_nsec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void ffsb_sleep_until(uint64_t nsec)
+{
+	struct timespec ts;
+
+	ts.tv_sec = nsec / 1000000000ULL;
+	ts.tv_nsec = nsec % 1000000000ULL;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)
+	       == EINTR)
+		;
+}
+
 
 void ffsb_barrier_init(ffsb_barrier_t *fb, unsigned count)
 {
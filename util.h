@@ -43,12 +43,19 @@ size_t ffsb_strnlen(const char *str, size_t maxlen);
 void ffsb_mkdir(char *dirname);
 void ffsb_getrusage(struct rusage *ru_self, struct rusage *ru_children);
 void ffsb_sync(void);
+void ffsb_drop_caches(void);
 void *ffsb_align_4k(void *ptr);
 char *ffsb_printsize(char *buf, double size, int bufsize);
 
 int ffsb_system(char *command);
 void ffsb_milli_sleep(unsigned time);
 void ffsb_micro_sleep(unsigned time);
+
+/* Monotonic clock in nsecs, and an absolute sleep against it, so
+ * time spent between calls doesn't push later wakeups back
+ */
+uint64_t ffsb_clock_nsec(void);
+void ffsb_sleep_until(uint64_t nsec);
 void ffsb_unbuffer_stdout(void);
 void ffsb_bench_gettimeofday(void);
 void ffsb_bench_getpid(void);
@@ -74,9 +81,11 @@ uint64_t getfsutil_size(char *dirname);
 struct timeval tvsub(struct timeval t1, struct timeval t0);
 struct timeval tvadd(struct timeval t1, struct timeval t0);
 double tvtodouble(struct timeval *t);
+uint64_t tvdiff_usec(struct timeval *start, struct timeval *end);
 
 
 #define max(a, b) (((a) > (b)) ? (a) : (b))
+#define min(a, b) (((a) < (b)) ? (a) : (b))
 
 #ifndef timersub
 #define timersub(a, b, result)                                          \
@@ -0,0 +1,238 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "verify.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_CRC32C_SSE42
+#include <nmmintrin.h>
+#endif
+
+#define CRC32C_POLY 0x82F63B78	/* reflected Castagnoli polynomial */
+
+static uint32_t crc32c_table[8][256];
+static int crc32c_have_sse42;
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+/* Tables for the slicing-by-8 fallback, crc32c_table[0] is the plain
+ * bytewise table and each following one advances a byte further.
+ */
+static void crc32c_init(void)
+{
+	uint32_t crc;
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		crc = i;
+		for (j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
+		crc32c_table[0][i] = crc;
+	}
+	for (i = 0; i < 256; i++) {
+		crc = crc32c_table[0][i];
+		for (j = 1; j < 8; j++) {
+			crc = crc32c_table[0][crc & 0xff] ^ (crc >> 8);
+			crc32c_table[j][i] = crc;
+		}
+	}
+
+#ifdef HAVE_CRC32C_SSE42
+	__builtin_cpu_init();
+	crc32c_have_sse42 = __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+static uint32_t crc32c_sw(uint32_t crc, const unsigned char *p, size_t len)
+{
+	uint64_t word;
+
+	while (len && ((uintptr_t)p & 7)) {
+		crc = crc32c_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+		len--;
+	}
+	while (len >= 8) {
+		memcpy(&word, p, 8);
+		word ^= crc;
+		crc = crc32c_table[7][word & 0xff] ^
+			crc32c_table[6][(word >> 8) & 0xff] ^
+			crc32c_table[5][(word >> 16) & 0xff] ^
+			crc32c_table[4][(word >> 24) & 0xff] ^
+			crc32c_table[3][(word >> 32) & 0xff] ^
+			crc32c_table[2][(word >> 40) & 0xff] ^
+			crc32c_table[1][(word >> 48) & 0xff] ^
+			crc32c_table[0][word >> 56];
+		p += 8;
+		len -= 8;
+	}
+	while (len--)
+		crc = crc32c_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	return crc;
+}
+
+#ifdef HAVE_CRC32C_SSE42
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hw(uint32_t crc, const unsigned char *p, size_t len)
+{
+	while (len && ((uintptr_t)p & 7)) {
+		crc = _mm_crc32_u8(crc, *p++);
+		len--;
+	}
+#ifdef __x86_64__
+	{
+		uint64_t crc64 = crc;
+
+		while (len >= 8) {
+			crc64 = _mm_crc32_u64(crc64, *(const uint64_t *)p);
+			p += 8;
+			len -= 8;
+		}
+		crc = (uint32_t)crc64;
+	}
+#endif
+	while (len >= 4) {
+		crc = _mm_crc32_u32(crc, *(const uint32_t *)p);
+		p += 4;
+		len -= 4;
+	}
+	while (len--)
+		crc = _mm_crc32_u8(crc, *p++);
+	return crc;
+}
+#endif
+
+uint32_t ffsb_crc32c(uint32_t crc, const void *buf, size_t len)
+{
+	pthread_once(&crc32c_once, crc32c_init);
+
+	crc = ~crc;
+#ifdef HAVE_CRC32C_SSE42
+	if (crc32c_have_sse42)
+		return ~crc32c_hw(crc, buf, len);
+#endif
+	return ~crc32c_sw(crc, buf, len);
+}
+
+/* The part of the block covered by the crc */
+#define VERIFY_CRC_START offsetof(struct verify_header, filenum)
+
+static void verify_stamp_block(char *block, uint64_t offset, uint32_t filenum,
+			       uint32_t generation)
+{
+	struct verify_header hdr;
+	uint64_t pattern, *p;
+	unsigned i;
+
+	hdr.magic = VERIFY_MAGIC;
+	hdr.crc = 0;
+	hdr.filenum = filenum;
+	hdr.len = VERIFY_BLOCKSIZE;
+	hdr.offset = offset;
+	hdr.generation = generation;
+	hdr.seed = generation * 0x9E3779B1 ^ (uint32_t)(offset >> 12);
+
+	/* xorshift64 pattern, so the payload isn't all zeroes and
+	 * doesn't compress or dedup
+	 */
+	pattern = ((uint64_t)hdr.seed << 32) | filenum | 1;
+	p = (uint64_t *)(block + sizeof(hdr));
+	for (i = 0; i < (VERIFY_BLOCKSIZE - sizeof(hdr)) / 8; i++) {
+		pattern ^= pattern << 13;
+		pattern ^= pattern >> 7;
+		pattern ^= pattern << 17;
+		p[i] = pattern;
+	}
+
+	memcpy(block, &hdr, sizeof(hdr));
+	hdr.crc = ffsb_crc32c(0, block + VERIFY_CRC_START,
+			      VERIFY_BLOCKSIZE - VERIFY_CRC_START);
+	memcpy(block, &hdr, sizeof(hdr));
+}
+
+/* Blocks stamped so far by this thread, used as the generation.
+ * It only tells writes apart when debugging, so threads needn't
+ * agree on it.
+ */
+static __thread uint32_t verify_generation;
+
+void verify_stamp(void *buf, uint32_t size, uint64_t offset,
+		  uint32_t filenum)
+{
+	uint64_t block = (offset + VERIFY_BLOCKSIZE - 1) &
+		~(uint64_t)(VERIFY_BLOCKSIZE - 1);
+	uint32_t generation;
+
+	for (; block + VERIFY_BLOCKSIZE <= offset + size;
+	     block += VERIFY_BLOCKSIZE) {
+		generation = ++verify_generation;
+		verify_stamp_block((char *)buf + (block - offset), block,
+				   filenum, generation);
+	}
+}
+
+/* Only report the first few bad blocks, they tend to come in bunches */
+#define VERIFY_MAX_REPORTS 16
+static unsigned verify_reports;
+
+static void verify_report(uint32_t filenum, uint64_t offset, char *why)
+{
+	unsigned num = __sync_add_and_fetch(&verify_reports, 1);
+
+	if (num <= VERIFY_MAX_REPORTS)
+		fprintf(stderr, "verify: inode %u offset %llu: %s\n",
+			filenum, (unsigned long long)offset, why);
+	if (num == VERIFY_MAX_REPORTS)
+		fprintf(stderr, "verify: not reporting further errors\n");
+}
+
+unsigned verify_check(void *buf, uint32_t size, uint64_t offset,
+		      uint32_t filenum, unsigned *checked)
+{
+	uint64_t block = (offset + VERIFY_BLOCKSIZE - 1) &
+		~(uint64_t)(VERIFY_BLOCKSIZE - 1);
+	struct verify_header hdr;
+	unsigned errors = 0;
+	char *p;
+
+	*checked = 0;
+	for (; block + VERIFY_BLOCKSIZE <= offset + size;
+	     block += VERIFY_BLOCKSIZE) {
+		p = (char *)buf + (block - offset);
+		memcpy(&hdr, p, sizeof(hdr));
+		(*checked)++;
+
+		if (hdr.magic != VERIFY_MAGIC) {
+			verify_report(filenum, block, "bad magic");
+			errors++;
+		} else if (hdr.crc != ffsb_crc32c(0, p + VERIFY_CRC_START,
+					VERIFY_BLOCKSIZE - VERIFY_CRC_START)) {
+			verify_report(filenum, block, "crc mismatch");
+			errors++;
+		} else if (hdr.offset != block) {
+			verify_report(filenum, block, "misplaced block");
+			errors++;
+		} else if (hdr.filenum != filenum) {
+			verify_report(filenum, block,
+				      "block belongs to another file");
+			errors++;
+		}
+	}
+	return errors;
+}
@@ -0,0 +1,63 @@
+/*
+ *   Copyright (c) International Business Machines Corp., 2001-2004
+ *
+ *   This program is free software;  you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY;  without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ *   the GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program;  if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+#ifndef _VERIFY_H_
+#define _VERIFY_H_
+
+#include <inttypes.h>
+#include <stddef.h>
+
+/* Data verification
+ *
+ * When verify is enabled every 4k block written carries a small
+ * header identifying where it belongs and a CRC32C of the rest of
+ * the block, and every block read back is checked against it.
+ * This needs all i/o to be done in whole, 4k aligned blocks.
+ */
+
+#define VERIFY_BLOCKSIZE 4096
+#define VERIFY_MAGIC     0x46465342	/* "FFSB" */
+
+struct verify_header {
+	uint32_t magic;
+	uint32_t crc;		/* covers the block from filenum onwards */
+	uint32_t filenum;	/* inode number of the file */
+	uint32_t len;		/* bytes covered, always VERIFY_BLOCKSIZE */
+	uint64_t offset;	/* offset of the block in the file */
+	uint32_t generation;	/* per thread stamp count, for debugging */
+	uint32_t seed;		/* seed of the payload pattern */
+};
+
+/* Standard (Castagnoli) CRC32C, uses the SSE4.2 crc32 instruction if
+ * the cpu has it.  Pass 0 as the initial crc.
+ */
+uint32_t ffsb_crc32c(uint32_t crc, const void *buf, size_t len);
+
+/* Fill every whole block in buf with a header and pattern for a write
+ * of size bytes at offset in file filenum.
+ */
+void verify_stamp(void *buf, uint32_t size, uint64_t offset,
+		  uint32_t filenum);
+
+/* Check every whole, block aligned block in buf, which was read from
+ * offset in file filenum.  Returns the number of bad blocks, and the
+ * number of checked blocks in *checked.
+ */
+unsigned verify_check(void *buf, uint32_t size, uint64_t offset,
+		      uint32_t filenum, unsigned *checked);
+
+#endif /* _VERIFY_H_ */